@@ -0,0 +1,54 @@
+#ifndef APP_USBD_H__
+#define APP_USBD_H__
+
+#include "nrfx.h"
+#include "app_usbd_class_base.h"
+
+typedef enum {
+    APP_USBD_EVT_DRV_SOF,
+    APP_USBD_EVT_DRV_RESET,
+    APP_USBD_EVT_DRV_SUSPEND,
+    APP_USBD_EVT_DRV_RESUME,
+    APP_USBD_EVT_DRV_WUREQ,
+    APP_USBD_EVT_DRV_SETUP,
+    APP_USBD_EVT_DRV_EPTRANSFER,
+    APP_USBD_EVT_FIRST_POWER,
+    APP_USBD_EVT_INST_APPEND,
+    APP_USBD_EVT_INST_REMOVE,
+    APP_USBD_EVT_STARTREQ,
+    APP_USBD_EVT_STOPREQ,
+    APP_USBD_EVT_SUSPEND_REQ,
+    APP_USBD_EVT_WAKEUP_REQ,
+    APP_USBD_EVT_SETUP_SETADDRESS,
+    APP_USBD_EVT_STARTED,
+    APP_USBD_EVT_STOPPED,
+    APP_USBD_EVT_POWER_DETECTED,
+    APP_USBD_EVT_POWER_REMOVED,
+    APP_USBD_EVT_POWER_READY,
+    APP_USBD_EVT_STATE_CHANGED,
+} app_usbd_event_type_t;
+
+typedef void (*app_usbd_ev_state_proc_t)(app_usbd_event_type_t event);
+
+typedef struct {
+    app_usbd_ev_state_proc_t ev_state_proc;
+} app_usbd_config_t;
+
+ret_code_t app_usbd_init(app_usbd_config_t const * p_config);
+ret_code_t app_usbd_uninit(void);
+void app_usbd_enable(void);
+void app_usbd_disable(void);
+void app_usbd_start(void);
+void app_usbd_stop(void);
+ret_code_t app_usbd_class_append(app_usbd_class_inst_t const * p_cinst);
+ret_code_t app_usbd_power_events_enable(void);
+bool app_usbd_event_queue_process(void);
+
+bool nrf_drv_usbd_is_enabled(void);
+
+#define NRF_DRV_USBD_EPIN1   0x81
+#define NRF_DRV_USBD_EPIN2   0x82
+#define NRF_DRV_USBD_EPOUT1  0x01
+#define NRF_DRV_USBD_EPSIZE  64
+
+#endif
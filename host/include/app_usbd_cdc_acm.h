@@ -0,0 +1,69 @@
+#ifndef APP_USBD_CDC_ACM_H__
+#define APP_USBD_CDC_ACM_H__
+
+#include "app_usbd.h"
+
+typedef enum {
+    APP_USBD_CDC_COMM_PROTOCOL_NONE    = 0x00,
+    APP_USBD_CDC_COMM_PROTOCOL_AT_V250 = 0x01,
+} app_usbd_cdc_comm_protocol_t;
+
+typedef enum {
+    APP_USBD_CDC_ACM_USER_EVT_RX_DONE,
+    APP_USBD_CDC_ACM_USER_EVT_TX_DONE,
+    APP_USBD_CDC_ACM_USER_EVT_PORT_OPEN,
+    APP_USBD_CDC_ACM_USER_EVT_PORT_CLOSE,
+} app_usbd_cdc_acm_user_event_t;
+
+typedef enum {
+    APP_USBD_CDC_ACM_LINE_STATE_DTR = 0,
+    APP_USBD_CDC_ACM_LINE_STATE_RTS,
+    APP_USBD_CDC_ACM_LINE_STATE_DCD,
+    APP_USBD_CDC_ACM_LINE_STATE_DSR,
+    APP_USBD_CDC_ACM_LINE_STATE_BRK,
+    APP_USBD_CDC_ACM_LINE_STATE_RI,
+} app_usbd_cdc_line_t;
+
+typedef void (*app_usbd_cdc_acm_user_ev_handler_t)(app_usbd_class_inst_t const * p_inst,
+                                                   app_usbd_cdc_acm_user_event_t event);
+
+typedef struct {
+    app_usbd_class_inst_t              base;
+    app_usbd_cdc_acm_user_ev_handler_t user_ev_handler;
+} app_usbd_cdc_acm_t;
+
+#define APP_USBD_CDC_ACM_GLOBAL_DEF(instance_name,                \
+                                    user_event_handler,           \
+                                    comm_ifc,                     \
+                                    data_ifc,                     \
+                                    comm_ein,                     \
+                                    data_ein,                     \
+                                    data_eout,                    \
+                                    cdc_protocol)                 \
+    static app_usbd_cdc_acm_t const instance_name = {             \
+        .base = { .class_id = APP_USBD_HOST_CLASS_CDC_ACM },      \
+        .user_ev_handler = user_event_handler,                    \
+    }
+
+static inline app_usbd_class_inst_t const *
+app_usbd_cdc_acm_class_inst_get(app_usbd_cdc_acm_t const * p_cdc_acm)
+{
+    return &p_cdc_acm->base;
+}
+
+ret_code_t app_usbd_cdc_acm_write(app_usbd_cdc_acm_t const * p_cdc_acm,
+                                  void const * p_buf,
+                                  size_t length);
+ret_code_t app_usbd_cdc_acm_read(app_usbd_cdc_acm_t const * p_cdc_acm,
+                                 void * p_buf,
+                                 size_t length);
+ret_code_t app_usbd_cdc_acm_read_any(app_usbd_cdc_acm_t const * p_cdc_acm,
+                                     void * p_buf,
+                                     size_t length);
+size_t app_usbd_cdc_acm_rx_size(app_usbd_cdc_acm_t const * p_cdc_acm);
+size_t app_usbd_cdc_acm_bytes_stored(app_usbd_cdc_acm_t const * p_cdc_acm);
+ret_code_t app_usbd_cdc_acm_line_state_get(app_usbd_cdc_acm_t const * p_cdc_acm,
+                                           app_usbd_cdc_line_t line,
+                                           uint32_t * value);
+
+#endif
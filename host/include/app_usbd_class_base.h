@@ -0,0 +1,12 @@
+#ifndef APP_USBD_CLASS_BASE_H__
+#define APP_USBD_CLASS_BASE_H__
+
+#include "nrfx.h"
+
+typedef struct app_usbd_class_inst_s {
+    uint8_t class_id;
+} app_usbd_class_inst_t;
+
+#define APP_USBD_HOST_CLASS_CDC_ACM  1
+
+#endif
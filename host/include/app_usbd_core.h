@@ -0,0 +1,6 @@
+#ifndef APP_USBD_CORE_H__
+#define APP_USBD_CORE_H__
+
+#include "app_usbd.h"
+
+#endif
@@ -0,0 +1,6 @@
+#ifndef APP_USBD_SERIAL_NUM_H__
+#define APP_USBD_SERIAL_NUM_H__
+
+void app_usbd_serial_num_generate(void);
+
+#endif
@@ -0,0 +1,81 @@
+#ifndef HOST_HAL_H
+#define HOST_HAL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define HOST_GPIO_PIN_COUNT   48
+#define HOST_PWM_COUNT        4
+#define HOST_FLASH_BASE       0x00010000
+#define HOST_FLASH_END        0x00100000
+#define HOST_FLASH_PAGE_SIZE  0x1000
+
+/* Host time in microseconds since start. With HOST_VIRTUAL_TIME=1 in the
+ * environment time only moves when the firmware sleeps or delays, so long
+ * stretches of device time can be simulated instantly. */
+uint64_t host_time_us(void);
+bool host_time_is_virtual(void);
+void host_time_advance_to(uint64_t time_us);
+
+/* Overrides HOST_VIRTUAL_TIME before the firmware starts, for tests that
+ * time the firmware against a real peer and need it to sleep while it
+ * waits. Time restarts from zero. */
+void host_time_set_virtual(bool enable);
+
+/* Ends the process with exit(0) when virtual time would pass time_us, so a
+ * test can run the firmware loop for a stretch of device time and check the
+ * outcome from an atexit() handler. */
+void host_time_set_limit(uint64_t time_us);
+
+/* Runs the handlers of every emulated interrupt that is due. Returns true if
+ * at least one fired. */
+bool host_irq_dispatch(void);
+uint32_t host_wfe_count(void);
+
+/* Per-peripheral hooks used by host_irq_dispatch() and __WFE(). */
+bool host_rtc_dispatch(void);
+uint64_t host_rtc_next_event_us(void);
+bool host_usbd_irq_pending(void);
+int host_usbd_wait_fd(void);
+bool host_pwm_dispatch(void);
+uint64_t host_pwm_next_event_us(void);
+
+/* Drives an input pin as if from outside and fires the GPIOTE handler on a matching edge. */
+void host_gpio_set_input(uint32_t pin, bool level);
+
+/* Values the PWM instance is playing in the current period. */
+bool host_pwm_get_values(uint8_t instance, uint16_t values[4]);
+
+/* PWM periods are emulated one by one against host time. Each finished
+ * period is logged with the values that played in it; modified is set if the
+ * buffer the period was fetched from changed before the period ended, i.e.
+ * the firmware wrote memory that EasyDMA owned. The log keeps the last
+ * 1024 periods; index counts from the first period after playback start. */
+typedef struct {
+    uint64_t start_us;
+    uint16_t values[4];
+    uint8_t  seq_index;
+    bool     modified;
+} host_pwm_period_t;
+
+uint32_t host_pwm_period_count(uint8_t instance);
+/* Total time a PWM instance has been running since boot. */
+uint64_t host_pwm_on_time_us(uint8_t instance);
+/* Outstanding nrf_drv_clock HFCLK requests. */
+uint32_t host_hfclk_request_count(void);
+bool host_pwm_period_get(uint8_t instance, uint32_t index, host_pwm_period_t *p_period);
+
+uint32_t host_nvmc_erase_count(void);
+uint32_t host_nvmc_write_count(void);
+
+/* Bytes the firmware has written to the CDC ACM data endpoint. */
+uint64_t host_usbd_tx_bytes(void);
+
+/* Link conditions: a host that never drains the IN endpoint (every write
+ * returns NRF_ERROR_BUSY), the terminal dropping DTR, and bus suspend. */
+void host_usbd_set_tx_busy(bool busy);
+void host_usbd_set_port_open(bool open);
+void host_usbd_set_suspended(bool suspended);
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef NRF_H
+#define NRF_H
+
+#include <stdint.h>
+
+/* Core intrinsics. Sleeping is emulated by waiting for the next host side
+ * interrupt source (fake RTC deadline or CDC input). */
+void __WFE(void);
+void __WFI(void);
+void __SEV(void);
+
+static inline void __DMB(void)
+{
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+extern uint32_t SystemCoreClock;
+
+typedef struct {
+    volatile uint32_t DEMCR;
+} CoreDebug_Type;
+
+typedef struct {
+    volatile uint32_t CTRL;
+    volatile uint32_t CYCCNT;
+} DWT_Type;
+
+#define CoreDebug_DEMCR_TRCENA_Msk  (1UL << 24)
+#define DWT_CTRL_CYCCNTENA_Msk      (1UL << 0)
+
+extern CoreDebug_Type host_core_debug;
+
+/* Every DWT access refreshes CYCCNT from the host clock scaled to
+ * SystemCoreClock, so cycle measurements reflect host execution time. */
+DWT_Type *host_dwt_sample(void);
+
+#define CoreDebug (&host_core_debug)
+#define DWT       (host_dwt_sample())
+
+#endif
@@ -0,0 +1,9 @@
+#ifndef NRF_DELAY_H
+#define NRF_DELAY_H
+
+#include <stdint.h>
+
+void nrf_delay_us(uint32_t us_time);
+void nrf_delay_ms(uint32_t ms_time);
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef NRF_DRV_CLOCK_H__
+#define NRF_DRV_CLOCK_H__
+
+#include "nrfx.h"
+
+typedef enum {
+    NRF_DRV_CLOCK_EVT_HFCLK_STARTED,
+    NRF_DRV_CLOCK_EVT_LFCLK_STARTED,
+    NRF_DRV_CLOCK_EVT_CAL_DONE,
+    NRF_DRV_CLOCK_EVT_CAL_ABORTED,
+} nrf_drv_clock_evt_type_t;
+
+typedef void (*nrf_drv_clock_event_handler_t)(nrf_drv_clock_evt_type_t event);
+
+typedef struct nrf_drv_clock_handler_item_s nrf_drv_clock_handler_item_t;
+struct nrf_drv_clock_handler_item_s {
+    nrf_drv_clock_handler_item_t * p_next;
+    nrf_drv_clock_event_handler_t  event_handler;
+};
+
+ret_code_t nrf_drv_clock_init(void);
+void nrf_drv_clock_lfclk_request(nrf_drv_clock_handler_item_t * p_handler_item);
+void nrf_drv_clock_lfclk_release(void);
+bool nrf_drv_clock_lfclk_is_running(void);
+void nrf_drv_clock_hfclk_request(nrf_drv_clock_handler_item_t * p_handler_item);
+void nrf_drv_clock_hfclk_release(void);
+bool nrf_drv_clock_hfclk_is_running(void);
+
+#endif
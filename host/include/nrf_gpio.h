@@ -0,0 +1,21 @@
+#ifndef NRF_GPIO_H__
+#define NRF_GPIO_H__
+
+#include "nrfx.h"
+
+#define NRF_GPIO_PIN_MAP(port, pin) (((port) << 5) | ((pin) & 0x1F))
+
+typedef enum {
+    NRF_GPIO_PIN_NOPULL   = 0,
+    NRF_GPIO_PIN_PULLDOWN = 1,
+    NRF_GPIO_PIN_PULLUP   = 3,
+} nrf_gpio_pin_pull_t;
+
+void nrf_gpio_cfg_input(uint32_t pin_number, nrf_gpio_pin_pull_t pull_config);
+void nrf_gpio_cfg_output(uint32_t pin_number);
+uint32_t nrf_gpio_pin_read(uint32_t pin_number);
+void nrf_gpio_pin_write(uint32_t pin_number, uint32_t value);
+void nrf_gpio_pin_set(uint32_t pin_number);
+void nrf_gpio_pin_clear(uint32_t pin_number);
+
+#endif
@@ -0,0 +1,30 @@
+#ifndef NRF_RTC_H__
+#define NRF_RTC_H__
+
+#include "nrfx.h"
+
+#define RTC_INPUT_FREQ          32768
+#define RTC_COUNTER_COUNTER_Msk 0xFFFFFF
+
+typedef struct {
+    uint32_t instance_id;
+} NRF_RTC_Type;
+
+extern NRF_RTC_Type host_rtc_registers[];
+
+#define NRF_RTC0 (&host_rtc_registers[0])
+#define NRF_RTC1 (&host_rtc_registers[1])
+#define NRF_RTC2 (&host_rtc_registers[2])
+
+typedef enum {
+    NRF_RTC_EVENT_TICK       = 0x100,
+    NRF_RTC_EVENT_OVERFLOW   = 0x104,
+    NRF_RTC_EVENT_COMPARE_0  = 0x140,
+    NRF_RTC_EVENT_COMPARE_1  = 0x144,
+    NRF_RTC_EVENT_COMPARE_2  = 0x148,
+    NRF_RTC_EVENT_COMPARE_3  = 0x14C,
+} nrf_rtc_event_t;
+
+bool nrf_rtc_event_check(NRF_RTC_Type * p_reg, nrf_rtc_event_t event);
+
+#endif
@@ -0,0 +1,33 @@
+#ifndef NRFX_H
+#define NRFX_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "sdk_errors.h"
+
+typedef enum {
+    NRFX_SUCCESS                = 0x0BAD0000,
+    NRFX_ERROR_INTERNAL         = 0x0BAD0001,
+    NRFX_ERROR_NO_MEM           = 0x0BAD0002,
+    NRFX_ERROR_NOT_SUPPORTED    = 0x0BAD0003,
+    NRFX_ERROR_INVALID_PARAM    = 0x0BAD0004,
+    NRFX_ERROR_INVALID_STATE    = 0x0BAD0005,
+    NRFX_ERROR_INVALID_LENGTH   = 0x0BAD0006,
+    NRFX_ERROR_TIMEOUT          = 0x0BAD0007,
+    NRFX_ERROR_FORBIDDEN        = 0x0BAD0008,
+    NRFX_ERROR_NULL             = 0x0BAD0009,
+    NRFX_ERROR_INVALID_ADDR     = 0x0BAD000A,
+    NRFX_ERROR_BUSY             = 0x0BAD000B,
+    NRFX_ERROR_ALREADY_INITIALIZED = 0x0BAD000C,
+} nrfx_err_t;
+
+#ifndef MAX
+#define MAX(a, b) ((a) < (b) ? (b) : (a))
+#endif
+
+#ifndef MIN
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+#endif
+
+#endif
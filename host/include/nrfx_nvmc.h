@@ -0,0 +1,13 @@
+#ifndef NRFX_NVMC_H__
+#define NRFX_NVMC_H__
+
+#include "nrfx.h"
+
+nrfx_err_t nrfx_nvmc_page_erase(uint32_t address);
+void nrfx_nvmc_words_write(uint32_t address, void const * src, uint32_t num_words);
+void nrfx_nvmc_word_write(uint32_t address, uint32_t value);
+bool nrfx_nvmc_write_done_check(void);
+nrfx_err_t nrfx_nvmc_page_partial_erase_init(uint32_t address, uint32_t duration_ms);
+bool nrfx_nvmc_page_partial_erase_continue(void);
+
+#endif
@@ -0,0 +1,13 @@
+#ifndef NRFX_POWER_H__
+#define NRFX_POWER_H__
+
+#include "nrfx.h"
+
+typedef struct {
+    bool dcdcen   : 1;
+    bool dcdcenhv : 1;
+} nrfx_power_config_t;
+
+nrfx_err_t nrfx_power_init(nrfx_power_config_t const * p_config);
+
+#endif
@@ -0,0 +1,188 @@
+#ifndef NRFX_PWM_H__
+#define NRFX_PWM_H__
+
+#include "nrfx.h"
+
+#define NRF_PWM_CHANNEL_COUNT   4
+#define NRFX_PWM_PIN_NOT_USED   0xFF
+#define NRFX_PWM_PIN_INVERTED   0x80
+
+typedef enum {
+    NRF_PWM_CLK_16MHz  = 0,
+    NRF_PWM_CLK_8MHz   = 1,
+    NRF_PWM_CLK_4MHz   = 2,
+    NRF_PWM_CLK_2MHz   = 3,
+    NRF_PWM_CLK_1MHz   = 4,
+    NRF_PWM_CLK_500kHz = 5,
+    NRF_PWM_CLK_250kHz = 6,
+    NRF_PWM_CLK_125kHz = 7,
+} nrf_pwm_clk_t;
+
+typedef enum {
+    NRF_PWM_MODE_UP          = 0,
+    NRF_PWM_MODE_UP_AND_DOWN = 1,
+} nrf_pwm_mode_t;
+
+typedef enum {
+    NRF_PWM_LOAD_COMMON     = 0,
+    NRF_PWM_LOAD_GROUPED    = 1,
+    NRF_PWM_LOAD_INDIVIDUAL = 2,
+    NRF_PWM_LOAD_WAVE_FORM  = 3,
+} nrf_pwm_dec_load_t;
+
+typedef enum {
+    NRF_PWM_STEP_AUTO      = 0,
+    NRF_PWM_STEP_TRIGGERED = 1,
+} nrf_pwm_dec_step_t;
+
+typedef uint16_t nrf_pwm_values_common_t;
+
+typedef struct {
+    uint16_t group_0;
+    uint16_t group_1;
+} nrf_pwm_values_grouped_t;
+
+typedef struct {
+    uint16_t channel_0;
+    uint16_t channel_1;
+    uint16_t channel_2;
+    uint16_t channel_3;
+} nrf_pwm_values_individual_t;
+
+typedef struct {
+    uint16_t channel_0;
+    uint16_t channel_1;
+    uint16_t channel_2;
+    uint16_t counter_top;
+} nrf_pwm_values_wave_form_t;
+
+typedef union {
+    nrf_pwm_values_common_t     const * p_common;
+    nrf_pwm_values_grouped_t    const * p_grouped;
+    nrf_pwm_values_individual_t const * p_individual;
+    nrf_pwm_values_wave_form_t  const * p_wave_form;
+    uint16_t                    const * p_raw;
+} nrf_pwm_values_t;
+
+typedef struct {
+    nrf_pwm_values_t values;
+    uint16_t         length;
+    uint32_t         repeats;
+    uint32_t         end_delay;
+} nrf_pwm_sequence_t;
+
+#define NRF_PWM_VALUES_LENGTH(array)  (sizeof(array) / sizeof(uint16_t))
+
+typedef struct {
+    uint32_t events_seqend[2];
+    uint32_t inten;
+} NRF_PWM_Type;
+
+typedef enum {
+    NRF_PWM_EVENT_SEQEND0,
+    NRF_PWM_EVENT_SEQEND1,
+} nrf_pwm_event_t;
+
+typedef enum {
+    NRF_PWM_INT_SEQEND0_MASK = 1u << 4,
+    NRF_PWM_INT_SEQEND1_MASK = 1u << 5,
+} nrf_pwm_int_mask_t;
+
+static inline void nrf_pwm_event_clear(NRF_PWM_Type * p_reg, nrf_pwm_event_t event)
+{
+    p_reg->events_seqend[event] = 0;
+}
+
+static inline bool nrf_pwm_event_check(NRF_PWM_Type const * p_reg, nrf_pwm_event_t event)
+{
+    return p_reg->events_seqend[event] != 0;
+}
+
+static inline void nrf_pwm_int_enable(NRF_PWM_Type * p_reg, uint32_t mask)
+{
+    p_reg->inten |= mask;
+}
+
+static inline void nrf_pwm_int_disable(NRF_PWM_Type * p_reg, uint32_t mask)
+{
+    p_reg->inten &= ~mask;
+}
+
+static inline bool nrf_pwm_int_enable_check(NRF_PWM_Type const * p_reg, uint32_t mask)
+{
+    return (p_reg->inten & mask) != 0;
+}
+
+typedef struct {
+    NRF_PWM_Type * p_registers;
+    uint8_t        drv_inst_idx;
+} nrfx_pwm_t;
+
+extern NRF_PWM_Type host_pwm_registers[];
+
+#define NRFX_PWM_INSTANCE(id)                      \
+{                                                  \
+    .p_registers  = &host_pwm_registers[id],       \
+    .drv_inst_idx = id,                            \
+}
+
+typedef struct {
+    uint8_t            output_pins[NRF_PWM_CHANNEL_COUNT];
+    uint8_t            irq_priority;
+    nrf_pwm_clk_t      base_clock;
+    nrf_pwm_mode_t     count_mode;
+    uint16_t           top_value;
+    nrf_pwm_dec_load_t load_mode;
+    nrf_pwm_dec_step_t step_mode;
+} nrfx_pwm_config_t;
+
+#define NRFX_PWM_DEFAULT_CONFIG                                   \
+{                                                                 \
+    .output_pins  = { NRFX_PWM_PIN_NOT_USED, NRFX_PWM_PIN_NOT_USED, \
+                      NRFX_PWM_PIN_NOT_USED, NRFX_PWM_PIN_NOT_USED }, \
+    .irq_priority = 6,                                            \
+    .base_clock   = NRF_PWM_CLK_1MHz,                             \
+    .count_mode   = NRF_PWM_MODE_UP,                              \
+    .top_value    = 1000,                                         \
+    .load_mode    = NRF_PWM_LOAD_COMMON,                          \
+    .step_mode    = NRF_PWM_STEP_AUTO,                            \
+}
+
+typedef enum {
+    NRFX_PWM_FLAG_STOP            = 0x01,
+    NRFX_PWM_FLAG_LOOP            = 0x02,
+    NRFX_PWM_FLAG_SIGNAL_END_SEQ0 = 0x04,
+    NRFX_PWM_FLAG_SIGNAL_END_SEQ1 = 0x08,
+    NRFX_PWM_FLAG_NO_EVT_FINISHED = 0x10,
+    NRFX_PWM_FLAG_START_VIA_TASK  = 0x80,
+} nrfx_pwm_flag_t;
+
+typedef enum {
+    NRFX_PWM_EVT_FINISHED,
+    NRFX_PWM_EVT_END_SEQ0,
+    NRFX_PWM_EVT_END_SEQ1,
+    NRFX_PWM_EVT_STOPPED,
+} nrfx_pwm_evt_type_t;
+
+typedef void (*nrfx_pwm_handler_t)(nrfx_pwm_evt_type_t event_type);
+
+nrfx_err_t nrfx_pwm_init(nrfx_pwm_t const * p_instance,
+                         nrfx_pwm_config_t const * p_config,
+                         nrfx_pwm_handler_t handler);
+void nrfx_pwm_uninit(nrfx_pwm_t const * p_instance);
+uint32_t nrfx_pwm_simple_playback(nrfx_pwm_t const * p_instance,
+                                  nrf_pwm_sequence_t const * p_sequence,
+                                  uint16_t playback_count,
+                                  uint32_t flags);
+uint32_t nrfx_pwm_complex_playback(nrfx_pwm_t const * p_instance,
+                                   nrf_pwm_sequence_t const * p_sequence_0,
+                                   nrf_pwm_sequence_t const * p_sequence_1,
+                                   uint16_t playback_count,
+                                   uint32_t flags);
+void nrfx_pwm_sequence_update(nrfx_pwm_t const * p_instance,
+                              uint8_t seq_id,
+                              nrf_pwm_sequence_t const * p_sequence);
+bool nrfx_pwm_stop(nrfx_pwm_t const * p_instance, bool wait_until_stopped);
+bool nrfx_pwm_is_stopped(nrfx_pwm_t const * p_instance);
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef NRFX_RTC_H__
+#define NRFX_RTC_H__
+
+#include "nrfx.h"
+#include "nrf_rtc.h"
+
+#define NRFX_RTC_CC_CHANNEL_COUNT 4
+
+#define RTC_FREQ_TO_PRESCALER(FREQ) (uint16_t)(((RTC_INPUT_FREQ) / (FREQ)) - 1)
+
+typedef enum {
+    NRFX_RTC_INT_COMPARE0 = 0,
+    NRFX_RTC_INT_COMPARE1 = 1,
+    NRFX_RTC_INT_COMPARE2 = 2,
+    NRFX_RTC_INT_COMPARE3 = 3,
+    NRFX_RTC_INT_TICK     = 4,
+    NRFX_RTC_INT_OVERFLOW = 5,
+} nrfx_rtc_int_type_t;
+
+typedef struct {
+    NRF_RTC_Type * p_reg;
+    uint8_t        instance_id;
+    uint8_t        cc_channel_count;
+} nrfx_rtc_t;
+
+#define NRFX_RTC_INSTANCE(id)                           \
+{                                                       \
+    .p_reg            = NRF_RTC##id,                    \
+    .instance_id      = id,                             \
+    .cc_channel_count = NRFX_RTC_CC_CHANNEL_COUNT,      \
+}
+
+typedef struct {
+    uint16_t prescaler;
+    uint8_t  interrupt_priority;
+    uint8_t  tick_latency;
+    bool     reliable;
+} nrfx_rtc_config_t;
+
+#define NRFX_RTC_DEFAULT_CONFIG                         \
+{                                                       \
+    .prescaler          = RTC_FREQ_TO_PRESCALER(32768), \
+    .interrupt_priority = 6,                            \
+    .tick_latency       = 66,                           \
+    .reliable           = false,                        \
+}
+
+typedef void (*nrfx_rtc_handler_t)(nrfx_rtc_int_type_t int_type);
+
+nrfx_err_t nrfx_rtc_init(nrfx_rtc_t const * p_instance,
+                         nrfx_rtc_config_t const * p_config,
+                         nrfx_rtc_handler_t handler);
+void nrfx_rtc_uninit(nrfx_rtc_t const * p_instance);
+void nrfx_rtc_enable(nrfx_rtc_t const * p_instance);
+void nrfx_rtc_disable(nrfx_rtc_t const * p_instance);
+nrfx_err_t nrfx_rtc_cc_set(nrfx_rtc_t const * p_instance,
+                           uint32_t channel,
+                           uint32_t val,
+                           bool enable_irq);
+nrfx_err_t nrfx_rtc_cc_disable(nrfx_rtc_t const * p_instance, uint32_t channel);
+void nrfx_rtc_overflow_enable(nrfx_rtc_t const * p_instance, bool enable_irq);
+void nrfx_rtc_overflow_disable(nrfx_rtc_t const * p_instance);
+uint32_t nrfx_rtc_counter_get(nrfx_rtc_t const * p_instance);
+uint32_t nrfx_rtc_max_ticks_get(nrfx_rtc_t const * p_instance);
+
+#endif
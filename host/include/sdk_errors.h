@@ -0,0 +1,17 @@
+#ifndef SDK_ERRORS_H
+#define SDK_ERRORS_H
+
+#include <stdint.h>
+
+typedef uint32_t ret_code_t;
+
+#define NRF_SUCCESS             0
+#define NRF_ERROR_INTERNAL      3
+#define NRF_ERROR_NO_MEM        4
+#define NRF_ERROR_NOT_FOUND     5
+#define NRF_ERROR_INVALID_STATE 8
+#define NRF_ERROR_INVALID_LENGTH 9
+#define NRF_ERROR_BUSY          17
+#define NRF_ERROR_IO_PENDING    (0x8000 + 0x0001)
+
+#endif
@@ -0,0 +1,83 @@
+#include "nrf_delay.h"
+#include "nrf_drv_clock.h"
+#include "nrfx_power.h"
+#include "host_hal.h"
+
+#include <time.h>
+
+static bool m_lfclk_running;
+static uint32_t m_hfclk_requests;
+
+ret_code_t nrf_drv_clock_init(void)
+{
+    return NRFX_SUCCESS;
+}
+
+void nrf_drv_clock_lfclk_request(nrf_drv_clock_handler_item_t * p_handler_item)
+{
+    m_lfclk_running = true;
+    if (p_handler_item != NULL && p_handler_item->event_handler != NULL) {
+        p_handler_item->event_handler(NRF_DRV_CLOCK_EVT_LFCLK_STARTED);
+    }
+}
+
+void nrf_drv_clock_lfclk_release(void)
+{
+    m_lfclk_running = false;
+}
+
+bool nrf_drv_clock_lfclk_is_running(void)
+{
+    return m_lfclk_running;
+}
+
+/* Requests are counted like in the SDK driver: the clock runs while at least
+ * one user holds it. */
+void nrf_drv_clock_hfclk_request(nrf_drv_clock_handler_item_t * p_handler_item)
+{
+    m_hfclk_requests++;
+    if (p_handler_item != NULL && p_handler_item->event_handler != NULL) {
+        p_handler_item->event_handler(NRF_DRV_CLOCK_EVT_HFCLK_STARTED);
+    }
+}
+
+void nrf_drv_clock_hfclk_release(void)
+{
+    if (m_hfclk_requests > 0) {
+        m_hfclk_requests--;
+    }
+}
+
+bool nrf_drv_clock_hfclk_is_running(void)
+{
+    return m_hfclk_requests > 0;
+}
+
+uint32_t host_hfclk_request_count(void)
+{
+    return m_hfclk_requests;
+}
+
+nrfx_err_t nrfx_power_init(nrfx_power_config_t const * p_config)
+{
+    return NRFX_SUCCESS;
+}
+
+void nrf_delay_us(uint32_t us_time)
+{
+    if (host_time_is_virtual()) {
+        host_time_advance_to(host_time_us() + us_time);
+    } else {
+        struct timespec ts = {
+            .tv_sec = us_time / 1000000,
+            .tv_nsec = (long)(us_time % 1000000) * 1000
+        };
+        nanosleep(&ts, NULL);
+    }
+    host_irq_dispatch();
+}
+
+void nrf_delay_ms(uint32_t ms_time)
+{
+    nrf_delay_us(ms_time * 1000);
+}
@@ -0,0 +1,159 @@
+#include "nrf.h"
+#include "host_hal.h"
+
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+uint32_t SystemCoreClock = 64000000;
+CoreDebug_Type host_core_debug;
+
+static DWT_Type m_dwt;
+static bool m_virtual_time;
+static uint64_t m_virtual_us;
+static uint64_t m_boot_us;
+static uint64_t m_limit_us = UINT64_MAX;
+static bool m_event;
+static bool m_in_irq;
+static uint32_t m_wfe_count;
+
+static uint64_t monotonic_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u;
+}
+
+__attribute__((constructor))
+static void host_time_init(void)
+{
+    const char *p_env = getenv("HOST_VIRTUAL_TIME");
+    m_virtual_time = (p_env != NULL && p_env[0] == '1');
+    m_boot_us = monotonic_us();
+}
+
+uint64_t host_time_us(void)
+{
+    if (m_virtual_time) {
+        return m_virtual_us;
+    }
+    return monotonic_us() - m_boot_us;
+}
+
+bool host_time_is_virtual(void)
+{
+    return m_virtual_time;
+}
+
+void host_time_set_virtual(bool enable)
+{
+    m_virtual_time = enable;
+    m_virtual_us = 0;
+    m_boot_us = monotonic_us();
+}
+
+void host_time_advance_to(uint64_t time_us)
+{
+    if (m_virtual_time && time_us > m_virtual_us) {
+        if (time_us > m_limit_us) {
+            m_virtual_us = m_limit_us;
+            exit(0);
+        }
+        m_virtual_us = time_us;
+    }
+}
+
+void host_time_set_limit(uint64_t time_us)
+{
+    m_limit_us = time_us;
+}
+
+DWT_Type *host_dwt_sample(void)
+{
+    if (m_dwt.CTRL & DWT_CTRL_CYCCNTENA_Msk) {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        uint64_t ns = (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+        m_dwt.CYCCNT = (uint32_t)(ns * (SystemCoreClock / 1000000) / 1000);
+    }
+    return &m_dwt;
+}
+
+bool host_irq_dispatch(void)
+{
+    if (m_in_irq) {
+        return false;
+    }
+
+    m_in_irq = true;
+    bool fired = host_rtc_dispatch();
+    fired |= host_pwm_dispatch();
+    m_in_irq = false;
+
+    return fired || host_usbd_irq_pending();
+}
+
+/* Blocks until the next emulated interrupt source may become active: the
+ * earliest RTC or PWM event, or readable CDC input. */
+static void wait_for_interrupt_source(void)
+{
+    uint64_t deadline = host_rtc_next_event_us();
+    uint64_t pwm_deadline = host_pwm_next_event_us();
+    if (pwm_deadline < deadline) {
+        deadline = pwm_deadline;
+    }
+    int fd = host_usbd_wait_fd();
+
+    if (m_virtual_time) {
+        if (deadline != UINT64_MAX) {
+            host_time_advance_to(deadline);
+            return;
+        }
+        if (m_limit_us != UINT64_MAX) {
+            /* Input is instant in virtual time, so none now means none
+             * before the end of the run. */
+            host_time_advance_to(m_limit_us + 1);
+        }
+        if (fd < 0) {
+            fprintf(stderr, "host: sleeping with no wake-up source\n");
+            exit(1);
+        }
+    }
+
+    int timeout_ms = -1;
+    if (deadline != UINT64_MAX) {
+        uint64_t now = host_time_us();
+        timeout_ms = (deadline > now) ? (int)((deadline - now + 999) / 1000) : 0;
+    }
+
+    struct pollfd pfd = { .fd = fd, .events = POLLIN };
+    poll(&pfd, fd >= 0 ? 1 : 0, timeout_ms);
+}
+
+void __WFI(void)
+{
+    m_wfe_count++;
+    while (!host_irq_dispatch()) {
+        wait_for_interrupt_source();
+    }
+}
+
+void __WFE(void)
+{
+    if (m_event) {
+        m_event = false;
+        return;
+    }
+    __WFI();
+}
+
+void __SEV(void)
+{
+    m_event = true;
+}
+
+uint32_t host_wfe_count(void)
+{
+    return m_wfe_count;
+}
@@ -0,0 +1,130 @@
+#include "nrf_gpio.h"
+#include "nrfx_gpiote.h"
+#include "host_hal.h"
+
+typedef struct {
+    nrfx_gpiote_evt_handler_t handler;
+    nrf_gpiote_polarity_t     sense;
+    bool                      enabled;
+} gpiote_in_t;
+
+static bool m_pin_level[HOST_GPIO_PIN_COUNT];
+static bool m_pin_output[HOST_GPIO_PIN_COUNT];
+static gpiote_in_t m_gpiote_in[HOST_GPIO_PIN_COUNT];
+static bool m_gpiote_init = false;
+
+void nrf_gpio_cfg_input(uint32_t pin_number, nrf_gpio_pin_pull_t pull_config)
+{
+    if (pin_number >= HOST_GPIO_PIN_COUNT) return;
+
+    m_pin_output[pin_number] = false;
+    m_pin_level[pin_number] = (pull_config != NRF_GPIO_PIN_PULLDOWN);
+}
+
+void nrf_gpio_cfg_output(uint32_t pin_number)
+{
+    if (pin_number >= HOST_GPIO_PIN_COUNT) return;
+
+    m_pin_output[pin_number] = true;
+}
+
+uint32_t nrf_gpio_pin_read(uint32_t pin_number)
+{
+    if (pin_number >= HOST_GPIO_PIN_COUNT) return 0;
+
+    return m_pin_level[pin_number] ? 1 : 0;
+}
+
+void nrf_gpio_pin_write(uint32_t pin_number, uint32_t value)
+{
+    if (pin_number >= HOST_GPIO_PIN_COUNT || !m_pin_output[pin_number]) return;
+
+    m_pin_level[pin_number] = (value != 0);
+}
+
+void nrf_gpio_pin_set(uint32_t pin_number)
+{
+    nrf_gpio_pin_write(pin_number, 1);
+}
+
+void nrf_gpio_pin_clear(uint32_t pin_number)
+{
+    nrf_gpio_pin_write(pin_number, 0);
+}
+
+nrfx_err_t nrfx_gpiote_init(void)
+{
+    if (m_gpiote_init) {
+        return NRFX_ERROR_INVALID_STATE;
+    }
+    m_gpiote_init = true;
+    return NRFX_SUCCESS;
+}
+
+bool nrfx_gpiote_is_init(void)
+{
+    return m_gpiote_init;
+}
+
+nrfx_err_t nrfx_gpiote_in_init(nrfx_gpiote_pin_t pin,
+                               nrfx_gpiote_in_config_t const * p_config,
+                               nrfx_gpiote_evt_handler_t evt_handler)
+{
+    if (pin >= HOST_GPIO_PIN_COUNT) {
+        return NRFX_ERROR_INVALID_PARAM;
+    }
+    if (m_gpiote_in[pin].handler != NULL) {
+        return NRFX_ERROR_INVALID_STATE;
+    }
+
+    if (!p_config->skip_gpio_setup) {
+        nrf_gpio_cfg_input(pin, p_config->pull);
+    }
+    m_gpiote_in[pin].handler = evt_handler;
+    m_gpiote_in[pin].sense = p_config->sense;
+    m_gpiote_in[pin].enabled = false;
+    return NRFX_SUCCESS;
+}
+
+void nrfx_gpiote_in_uninit(nrfx_gpiote_pin_t pin)
+{
+    if (pin >= HOST_GPIO_PIN_COUNT) return;
+
+    m_gpiote_in[pin].handler = NULL;
+    m_gpiote_in[pin].enabled = false;
+}
+
+void nrfx_gpiote_in_event_enable(nrfx_gpiote_pin_t pin, bool int_enable)
+{
+    if (pin >= HOST_GPIO_PIN_COUNT) return;
+
+    m_gpiote_in[pin].enabled = int_enable;
+}
+
+void nrfx_gpiote_in_event_disable(nrfx_gpiote_pin_t pin)
+{
+    if (pin >= HOST_GPIO_PIN_COUNT) return;
+
+    m_gpiote_in[pin].enabled = false;
+}
+
+bool nrfx_gpiote_in_is_set(nrfx_gpiote_pin_t pin)
+{
+    return nrf_gpio_pin_read(pin) != 0;
+}
+
+void host_gpio_set_input(uint32_t pin, bool level)
+{
+    if (pin >= HOST_GPIO_PIN_COUNT || m_pin_output[pin]) return;
+    if (m_pin_level[pin] == level) return;
+
+    m_pin_level[pin] = level;
+
+    gpiote_in_t *p_in = &m_gpiote_in[pin];
+    if (!p_in->enabled || p_in->handler == NULL) return;
+
+    nrf_gpiote_polarity_t edge = level ? NRF_GPIOTE_POLARITY_LOTOHI : NRF_GPIOTE_POLARITY_HITOLO;
+    if (p_in->sense == NRF_GPIOTE_POLARITY_TOGGLE || p_in->sense == edge) {
+        p_in->handler(pin, p_in->sense);
+    }
+}
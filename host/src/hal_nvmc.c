@@ -0,0 +1,109 @@
+#include "nrfx_nvmc.h"
+#include "host_hal.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#ifndef MAP_FIXED_NOREPLACE
+#define MAP_FIXED_NOREPLACE MAP_FIXED
+#endif
+
+#define HOST_FLASH_ERASE_TIME_MS 87
+
+static uint32_t m_erase_count;
+static uint32_t m_write_count;
+static uint32_t m_partial_address;
+static uint32_t m_partial_duration_ms;
+static uint32_t m_partial_elapsed_ms;
+
+/* The firmware dereferences flash addresses directly, so the emulated flash
+ * has to live at the same addresses as on the nRF52840. */
+__attribute__((constructor))
+static void host_flash_map(void)
+{
+    size_t size = HOST_FLASH_END - HOST_FLASH_BASE;
+    void *p = mmap((void *)(uintptr_t)HOST_FLASH_BASE, size,
+                   PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+
+    if (p != (void *)(uintptr_t)HOST_FLASH_BASE) {
+        fprintf(stderr, "host: cannot map emulated flash at 0x%08X\n", HOST_FLASH_BASE);
+        exit(1);
+    }
+    memset(p, 0xFF, size);
+}
+
+static bool flash_range_valid(uint32_t address, uint32_t size)
+{
+    return address >= HOST_FLASH_BASE && address + size <= HOST_FLASH_END;
+}
+
+nrfx_err_t nrfx_nvmc_page_erase(uint32_t address)
+{
+    if (address % HOST_FLASH_PAGE_SIZE != 0 || !flash_range_valid(address, HOST_FLASH_PAGE_SIZE)) {
+        return NRFX_ERROR_INVALID_ADDR;
+    }
+
+    memset((void *)(uintptr_t)address, 0xFF, HOST_FLASH_PAGE_SIZE);
+    m_erase_count++;
+    return NRFX_SUCCESS;
+}
+
+void nrfx_nvmc_word_write(uint32_t address, uint32_t value)
+{
+    if (address % 4 != 0 || !flash_range_valid(address, 4)) return;
+
+    /* NOR flash can only clear bits until the page is erased again. */
+    *(uint32_t *)(uintptr_t)address &= value;
+    m_write_count++;
+}
+
+void nrfx_nvmc_words_write(uint32_t address, void const * src, uint32_t num_words)
+{
+    const uint8_t *p_src = src;
+
+    for (uint32_t i = 0; i < num_words; i++) {
+        uint32_t word;
+        memcpy(&word, p_src + i * 4, sizeof(word));
+        nrfx_nvmc_word_write(address + i * 4, word);
+    }
+}
+
+bool nrfx_nvmc_write_done_check(void)
+{
+    return true;
+}
+
+nrfx_err_t nrfx_nvmc_page_partial_erase_init(uint32_t address, uint32_t duration_ms)
+{
+    if (address % HOST_FLASH_PAGE_SIZE != 0 || !flash_range_valid(address, HOST_FLASH_PAGE_SIZE)) {
+        return NRFX_ERROR_INVALID_ADDR;
+    }
+    m_partial_address = address;
+    m_partial_duration_ms = duration_ms;
+    m_partial_elapsed_ms = 0;
+    return NRFX_SUCCESS;
+}
+
+/* The page reads as erased only once the slices add up to a full erase. */
+bool nrfx_nvmc_page_partial_erase_continue(void)
+{
+    m_partial_elapsed_ms += m_partial_duration_ms;
+    if (m_partial_elapsed_ms < HOST_FLASH_ERASE_TIME_MS) {
+        return false;
+    }
+    nrfx_nvmc_page_erase(m_partial_address);
+    return true;
+}
+
+uint32_t host_nvmc_erase_count(void)
+{
+    return m_erase_count;
+}
+
+uint32_t host_nvmc_write_count(void)
+{
+    return m_write_count;
+}
@@ -0,0 +1,356 @@
+#include "nrfx_pwm.h"
+#include "host_hal.h"
+
+#include <string.h>
+
+#define HOST_PWM_LOG_SIZE  1024
+
+typedef struct {
+    nrfx_pwm_config_t          config;
+    nrfx_pwm_handler_t         handler;
+    nrf_pwm_sequence_t const * p_seq[2];
+    nrf_pwm_sequence_t         latched;
+    uint16_t                   playback_count;
+    uint32_t                   flags;
+    bool                       initialized;
+    bool                       running;
+    bool                       stopping;
+    uint64_t                   on_since_us;
+    uint64_t                   on_total_us;
+    uint64_t                   period_us;
+    uint64_t                   period_start_us;
+    uint8_t                    seq_index;
+    uint32_t                   seq_period;
+    uint32_t                   loops_done;
+    uint16_t                   current[4];
+    uint16_t const *           p_current_src;
+    uint32_t                   period_count;
+    host_pwm_period_t          log[HOST_PWM_LOG_SIZE];
+} pwm_cb_t;
+
+NRF_PWM_Type host_pwm_registers[HOST_PWM_COUNT];
+
+static pwm_cb_t m_pwm_cb[HOST_PWM_COUNT];
+
+static uint32_t values_per_period(pwm_cb_t const *p_cb)
+{
+    switch (p_cb->config.load_mode) {
+        case NRF_PWM_LOAD_COMMON:  return 1;
+        case NRF_PWM_LOAD_GROUPED: return 2;
+        default:                   return 4;
+    }
+}
+
+static uint32_t seq_sets(pwm_cb_t const *p_cb)
+{
+    uint32_t sets = p_cb->latched.length / values_per_period(p_cb);
+    return sets > 0 ? sets : 1;
+}
+
+/* Periods one pass over the playing sequence takes: every value set is
+ * played repeats + 1 times, then the last one is held for end_delay. */
+static uint32_t seq_periods(pwm_cb_t const *p_cb)
+{
+    nrf_pwm_sequence_t const *p_seq = &p_cb->latched;
+    return seq_sets(p_cb) * (p_seq->repeats + 1) + p_seq->end_delay;
+}
+
+static void decode(pwm_cb_t const *p_cb, uint16_t const *p_src, uint16_t values[4])
+{
+    switch (p_cb->config.load_mode) {
+        case NRF_PWM_LOAD_COMMON:
+            values[0] = values[1] = values[2] = values[3] = p_src[0];
+            break;
+        case NRF_PWM_LOAD_GROUPED:
+            values[0] = values[1] = p_src[0];
+            values[2] = values[3] = p_src[1];
+            break;
+        default:
+            memcpy(values, p_src, 4 * sizeof(uint16_t));
+            break;
+    }
+}
+
+/* SEQ[n] registers are latched when the sequence starts, and EasyDMA
+ * fetches the value set of a period when the period starts. */
+static void period_load(pwm_cb_t *p_cb)
+{
+    if (p_cb->seq_period == 0) {
+        p_cb->latched = *p_cb->p_seq[p_cb->seq_index];
+    }
+
+    nrf_pwm_sequence_t const *p_seq = &p_cb->latched;
+    uint32_t set = p_cb->seq_period / (p_seq->repeats + 1);
+    if (set >= seq_sets(p_cb)) {
+        set = seq_sets(p_cb) - 1;
+    }
+
+    p_cb->p_current_src = p_seq->values.p_raw + set * values_per_period(p_cb);
+    decode(p_cb, p_cb->p_current_src, p_cb->current);
+}
+
+/* Closes the current period into the log. A period whose source values
+ * changed while it played is flagged: on hardware the DMA may have picked up
+ * part of the old and part of the new set. */
+static void period_finish(pwm_cb_t *p_cb)
+{
+    host_pwm_period_t *p_entry = &p_cb->log[p_cb->period_count % HOST_PWM_LOG_SIZE];
+    uint16_t now[4];
+
+    decode(p_cb, p_cb->p_current_src, now);
+    p_entry->start_us = p_cb->period_start_us;
+    p_entry->seq_index = p_cb->seq_index;
+    memcpy(p_entry->values, p_cb->current, sizeof(p_entry->values));
+    p_entry->modified = memcmp(now, p_cb->current, sizeof(now)) != 0;
+    p_cb->period_count++;
+}
+
+/* Interrupt line of an instance. Like the nrfx driver, the handler checks
+ * both SEQEND events once it is entered, whichever one raised the line. */
+static bool pwm_irq(uint8_t instance)
+{
+    pwm_cb_t *p_cb = &m_pwm_cb[instance];
+    NRF_PWM_Type *p_reg = &host_pwm_registers[instance];
+    bool fired = false;
+
+    if (!(nrf_pwm_event_check(p_reg, NRF_PWM_EVENT_SEQEND0) &&
+          nrf_pwm_int_enable_check(p_reg, NRF_PWM_INT_SEQEND0_MASK)) &&
+        !(nrf_pwm_event_check(p_reg, NRF_PWM_EVENT_SEQEND1) &&
+          nrf_pwm_int_enable_check(p_reg, NRF_PWM_INT_SEQEND1_MASK))) {
+        return false;
+    }
+
+    if (nrf_pwm_event_check(p_reg, NRF_PWM_EVENT_SEQEND0)) {
+        nrf_pwm_event_clear(p_reg, NRF_PWM_EVENT_SEQEND0);
+        if ((p_cb->flags & NRFX_PWM_FLAG_SIGNAL_END_SEQ0) && p_cb->handler) {
+            p_cb->handler(NRFX_PWM_EVT_END_SEQ0);
+            fired = true;
+        }
+    }
+    if (nrf_pwm_event_check(p_reg, NRF_PWM_EVENT_SEQEND1)) {
+        nrf_pwm_event_clear(p_reg, NRF_PWM_EVENT_SEQEND1);
+        if ((p_cb->flags & NRFX_PWM_FLAG_SIGNAL_END_SEQ1) && p_cb->handler) {
+            p_cb->handler(NRFX_PWM_EVT_END_SEQ1);
+            fired = true;
+        }
+    }
+    return fired;
+}
+
+/* Advances one instance to the present. Returns true if a handler ran. */
+static bool pwm_advance(uint8_t instance, uint64_t now_us)
+{
+    pwm_cb_t *p_cb = &m_pwm_cb[instance];
+    bool fired = pwm_irq(instance);
+
+    while (p_cb->running && p_cb->period_start_us + p_cb->period_us <= now_us) {
+        period_finish(p_cb);
+        p_cb->period_start_us += p_cb->period_us;
+
+        /* STOP takes effect at the end of the period. */
+        if (p_cb->stopping) {
+            p_cb->running = false;
+            p_cb->stopping = false;
+            p_cb->on_total_us += p_cb->period_start_us - p_cb->on_since_us;
+            if (p_cb->handler) {
+                p_cb->handler(NRFX_PWM_EVT_STOPPED);
+                fired = true;
+            }
+            break;
+        }
+
+        if (++p_cb->seq_period < seq_periods(p_cb)) {
+            period_load(p_cb);
+            continue;
+        }
+
+        uint8_t ended = p_cb->seq_index;
+        p_cb->seq_period = 0;
+        p_cb->seq_index ^= 1;
+        if (ended == 1 && ++p_cb->loops_done >= p_cb->playback_count &&
+            !(p_cb->flags & NRFX_PWM_FLAG_LOOP)) {
+            p_cb->running = false;
+        } else {
+            period_load(p_cb);
+        }
+
+        /* The next sequence is already being fetched when the interrupt
+         * for the one that ended is taken. */
+        host_pwm_registers[instance].events_seqend[ended] = 1;
+        fired |= pwm_irq(instance);
+    }
+    return fired;
+}
+
+nrfx_err_t nrfx_pwm_init(nrfx_pwm_t const * p_instance,
+                         nrfx_pwm_config_t const * p_config,
+                         nrfx_pwm_handler_t handler)
+{
+    pwm_cb_t *p_cb = &m_pwm_cb[p_instance->drv_inst_idx];
+
+    if (p_cb->initialized) {
+        return NRFX_ERROR_INVALID_STATE;
+    }
+
+    p_cb->config = *p_config;
+    p_cb->handler = handler;
+    p_cb->initialized = true;
+    p_cb->running = false;
+    p_cb->period_us = ((uint64_t)p_config->top_value << p_config->base_clock) / 16u;
+    if (p_cb->period_us == 0) {
+        p_cb->period_us = 1;
+    }
+    return NRFX_SUCCESS;
+}
+
+void nrfx_pwm_uninit(nrfx_pwm_t const * p_instance)
+{
+    memset(&m_pwm_cb[p_instance->drv_inst_idx], 0, sizeof(pwm_cb_t));
+    memset(&host_pwm_registers[p_instance->drv_inst_idx], 0, sizeof(NRF_PWM_Type));
+}
+
+uint32_t nrfx_pwm_complex_playback(nrfx_pwm_t const * p_instance,
+                                   nrf_pwm_sequence_t const * p_sequence_0,
+                                   nrf_pwm_sequence_t const * p_sequence_1,
+                                   uint16_t playback_count,
+                                   uint32_t flags)
+{
+    pwm_cb_t *p_cb = &m_pwm_cb[p_instance->drv_inst_idx];
+    NRF_PWM_Type *p_reg = p_instance->p_registers;
+
+    p_cb->p_seq[0] = p_sequence_0;
+    p_cb->p_seq[1] = p_sequence_1;
+    p_cb->playback_count = playback_count;
+    p_cb->flags = flags;
+    if (!p_cb->running) {
+        p_cb->on_since_us = host_time_us();
+    }
+    p_cb->running = true;
+    p_cb->stopping = false;
+    p_cb->period_start_us = host_time_us();
+    p_cb->seq_index = 0;
+    p_cb->seq_period = 0;
+    p_cb->loops_done = 0;
+    period_load(p_cb);
+
+    p_reg->events_seqend[0] = 0;
+    p_reg->events_seqend[1] = 0;
+    p_reg->inten = 0;
+    if (flags & NRFX_PWM_FLAG_SIGNAL_END_SEQ0) p_reg->inten |= NRF_PWM_INT_SEQEND0_MASK;
+    if (flags & NRFX_PWM_FLAG_SIGNAL_END_SEQ1) p_reg->inten |= NRF_PWM_INT_SEQEND1_MASK;
+    return 0;
+}
+
+uint32_t nrfx_pwm_simple_playback(nrfx_pwm_t const * p_instance,
+                                  nrf_pwm_sequence_t const * p_sequence,
+                                  uint16_t playback_count,
+                                  uint32_t flags)
+{
+    return nrfx_pwm_complex_playback(p_instance, p_sequence, p_sequence, playback_count, flags);
+}
+
+void nrfx_pwm_sequence_update(nrfx_pwm_t const * p_instance,
+                              uint8_t seq_id,
+                              nrf_pwm_sequence_t const * p_sequence)
+{
+    m_pwm_cb[p_instance->drv_inst_idx].p_seq[seq_id] = p_sequence;
+}
+
+bool nrfx_pwm_stop(nrfx_pwm_t const * p_instance, bool wait_until_stopped)
+{
+    pwm_cb_t *p_cb = &m_pwm_cb[p_instance->drv_inst_idx];
+
+    if (!p_cb->running) {
+        return true;
+    }
+    p_cb->stopping = true;
+    if (wait_until_stopped) {
+        pwm_advance(p_instance->drv_inst_idx, p_cb->period_start_us + p_cb->period_us);
+    }
+    return !p_cb->running;
+}
+
+bool nrfx_pwm_is_stopped(nrfx_pwm_t const * p_instance)
+{
+    return !m_pwm_cb[p_instance->drv_inst_idx].running;
+}
+
+bool host_pwm_dispatch(void)
+{
+    uint64_t now = host_time_us();
+    bool fired = false;
+
+    for (uint8_t i = 0; i < HOST_PWM_COUNT; i++) {
+        fired |= pwm_advance(i, now);
+    }
+    return fired;
+}
+
+uint64_t host_pwm_next_event_us(void)
+{
+    uint64_t next = UINT64_MAX;
+
+    for (uint8_t i = 0; i < HOST_PWM_COUNT; i++) {
+        pwm_cb_t const *p_cb = &m_pwm_cb[i];
+        if (!p_cb->running || p_cb->handler == NULL) {
+            continue;
+        }
+        uint64_t end;
+        if (p_cb->stopping) {
+            end = p_cb->period_start_us + p_cb->period_us;
+        } else if (nrf_pwm_int_enable_check(&host_pwm_registers[i],
+                                            NRF_PWM_INT_SEQEND0_MASK | NRF_PWM_INT_SEQEND1_MASK)) {
+            uint32_t left = seq_periods(p_cb) - p_cb->seq_period;
+            end = p_cb->period_start_us + left * p_cb->period_us;
+        } else {
+            continue;
+        }
+        if (end < next) {
+            next = end;
+        }
+    }
+    return next;
+}
+
+bool host_pwm_get_values(uint8_t instance, uint16_t values[4])
+{
+    if (instance >= HOST_PWM_COUNT) return false;
+
+    pwm_cb_t *p_cb = &m_pwm_cb[instance];
+    if (!p_cb->running || p_cb->p_seq[0] == NULL) {
+        memset(values, 0, 4 * sizeof(uint16_t));
+        return false;
+    }
+
+    memcpy(values, p_cb->current, 4 * sizeof(uint16_t));
+    return true;
+}
+
+uint64_t host_pwm_on_time_us(uint8_t instance)
+{
+    if (instance >= HOST_PWM_COUNT) return 0;
+
+    pwm_cb_t const *p_cb = &m_pwm_cb[instance];
+    uint64_t total = p_cb->on_total_us;
+    if (p_cb->running) {
+        total += host_time_us() - p_cb->on_since_us;
+    }
+    return total;
+}
+
+uint32_t host_pwm_period_count(uint8_t instance)
+{
+    return instance < HOST_PWM_COUNT ? m_pwm_cb[instance].period_count : 0;
+}
+
+bool host_pwm_period_get(uint8_t instance, uint32_t index, host_pwm_period_t *p_period)
+{
+    if (instance >= HOST_PWM_COUNT) return false;
+
+    pwm_cb_t const *p_cb = &m_pwm_cb[instance];
+    if (index >= p_cb->period_count || p_cb->period_count - index > HOST_PWM_LOG_SIZE) {
+        return false;
+    }
+    *p_period = p_cb->log[index % HOST_PWM_LOG_SIZE];
+    return true;
+}
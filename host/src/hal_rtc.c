@@ -0,0 +1,233 @@
+#include "nrfx_rtc.h"
+#include "host_hal.h"
+
+#define HOST_RTC_COUNT   3
+#define RTC_COUNTER_SPAN (1ull << 24)
+
+typedef struct {
+    nrfx_rtc_handler_t handler;
+    uint16_t           prescaler;
+    bool               initialized;
+    bool               enabled;
+    uint64_t           start_us;
+    uint64_t           checked_ticks;
+    uint32_t           cc[NRFX_RTC_CC_CHANNEL_COUNT];
+    bool               cc_irq[NRFX_RTC_CC_CHANNEL_COUNT];
+    bool               overflow_irq;
+} rtc_cb_t;
+
+NRF_RTC_Type host_rtc_registers[HOST_RTC_COUNT] = { { 0 }, { 1 }, { 2 } };
+
+static rtc_cb_t m_rtc_cb[HOST_RTC_COUNT];
+
+static uint64_t ticks_now(rtc_cb_t const *p_cb)
+{
+    if (!p_cb->enabled) {
+        return p_cb->checked_ticks;
+    }
+    uint64_t elapsed_us = host_time_us() - p_cb->start_us;
+    return (elapsed_us * RTC_INPUT_FREQ) / (1000000ull * (p_cb->prescaler + 1u));
+}
+
+static uint64_t ticks_to_us(rtc_cb_t const *p_cb, uint64_t ticks)
+{
+    uint64_t scaled = ticks * 1000000ull * (p_cb->prescaler + 1u);
+    return p_cb->start_us + (scaled + RTC_INPUT_FREQ - 1) / RTC_INPUT_FREQ;
+}
+
+/* First absolute tick after `after` at which the 24-bit counter equals `value`. */
+static uint64_t next_match(uint64_t after, uint32_t value)
+{
+    uint64_t match = (after & ~(RTC_COUNTER_SPAN - 1)) + value;
+    if (match <= after) {
+        match += RTC_COUNTER_SPAN;
+    }
+    return match;
+}
+
+static uint64_t next_overflow(uint64_t after)
+{
+    return (after & ~(RTC_COUNTER_SPAN - 1)) + RTC_COUNTER_SPAN;
+}
+
+nrfx_err_t nrfx_rtc_init(nrfx_rtc_t const * p_instance,
+                         nrfx_rtc_config_t const * p_config,
+                         nrfx_rtc_handler_t handler)
+{
+    rtc_cb_t *p_cb = &m_rtc_cb[p_instance->instance_id];
+
+    if (p_cb->initialized) {
+        return NRFX_ERROR_INVALID_STATE;
+    }
+    *p_cb = (rtc_cb_t){
+        .handler = handler,
+        .prescaler = p_config->prescaler,
+        .initialized = true,
+    };
+    return NRFX_SUCCESS;
+}
+
+void nrfx_rtc_uninit(nrfx_rtc_t const * p_instance)
+{
+    m_rtc_cb[p_instance->instance_id] = (rtc_cb_t){ 0 };
+}
+
+void nrfx_rtc_enable(nrfx_rtc_t const * p_instance)
+{
+    rtc_cb_t *p_cb = &m_rtc_cb[p_instance->instance_id];
+
+    if (p_cb->enabled) return;
+
+    p_cb->start_us = host_time_us();
+    p_cb->checked_ticks = 0;
+    p_cb->enabled = true;
+}
+
+void nrfx_rtc_disable(nrfx_rtc_t const * p_instance)
+{
+    rtc_cb_t *p_cb = &m_rtc_cb[p_instance->instance_id];
+
+    p_cb->checked_ticks = ticks_now(p_cb);
+    p_cb->enabled = false;
+}
+
+nrfx_err_t nrfx_rtc_cc_set(nrfx_rtc_t const * p_instance,
+                           uint32_t channel,
+                           uint32_t val,
+                           bool enable_irq)
+{
+    rtc_cb_t *p_cb = &m_rtc_cb[p_instance->instance_id];
+
+    if (channel >= NRFX_RTC_CC_CHANNEL_COUNT) {
+        return NRFX_ERROR_INVALID_PARAM;
+    }
+    p_cb->cc[channel] = val & RTC_COUNTER_COUNTER_Msk;
+    p_cb->cc_irq[channel] = enable_irq;
+    return NRFX_SUCCESS;
+}
+
+nrfx_err_t nrfx_rtc_cc_disable(nrfx_rtc_t const * p_instance, uint32_t channel)
+{
+    if (channel >= NRFX_RTC_CC_CHANNEL_COUNT) {
+        return NRFX_ERROR_INVALID_PARAM;
+    }
+    m_rtc_cb[p_instance->instance_id].cc_irq[channel] = false;
+    return NRFX_SUCCESS;
+}
+
+void nrfx_rtc_overflow_enable(nrfx_rtc_t const * p_instance, bool enable_irq)
+{
+    m_rtc_cb[p_instance->instance_id].overflow_irq = enable_irq;
+}
+
+void nrfx_rtc_overflow_disable(nrfx_rtc_t const * p_instance)
+{
+    m_rtc_cb[p_instance->instance_id].overflow_irq = false;
+}
+
+uint32_t nrfx_rtc_counter_get(nrfx_rtc_t const * p_instance)
+{
+    return (uint32_t)(ticks_now(&m_rtc_cb[p_instance->instance_id]) & RTC_COUNTER_COUNTER_Msk);
+}
+
+uint32_t nrfx_rtc_max_ticks_get(nrfx_rtc_t const * p_instance)
+{
+    return RTC_COUNTER_COUNTER_Msk;
+}
+
+bool nrf_rtc_event_check(NRF_RTC_Type * p_reg, nrf_rtc_event_t event)
+{
+    rtc_cb_t *p_cb = &m_rtc_cb[p_reg->instance_id];
+    uint64_t now = ticks_now(p_cb);
+
+    switch (event) {
+        case NRF_RTC_EVENT_OVERFLOW:
+            return next_overflow(p_cb->checked_ticks) <= now;
+        case NRF_RTC_EVENT_COMPARE_0:
+        case NRF_RTC_EVENT_COMPARE_1:
+        case NRF_RTC_EVENT_COMPARE_2:
+        case NRF_RTC_EVENT_COMPARE_3:
+        {
+            uint32_t channel = (event - NRF_RTC_EVENT_COMPARE_0) / 4;
+            return next_match(p_cb->checked_ticks, p_cb->cc[channel]) <= now;
+        }
+        default:
+            return false;
+    }
+}
+
+static bool fire(rtc_cb_t *p_cb, nrfx_rtc_int_type_t source)
+{
+    if (p_cb->handler == NULL) {
+        return false;
+    }
+    p_cb->handler(source);
+    return true;
+}
+
+/* Fires every compare and overflow interrupt that became due since the last
+ * call, in counter order. Compare interrupts are one-shot, as in nrfx. */
+bool host_rtc_dispatch(void)
+{
+    bool fired = false;
+
+    for (uint32_t i = 0; i < HOST_RTC_COUNT; i++) {
+        rtc_cb_t *p_cb = &m_rtc_cb[i];
+        if (!p_cb->enabled) continue;
+
+        uint64_t now = ticks_now(p_cb);
+        while (p_cb->checked_ticks < now) {
+            uint64_t after = p_cb->checked_ticks;
+            uint64_t first = next_overflow(after);
+
+            for (int ch = 0; ch < NRFX_RTC_CC_CHANNEL_COUNT; ch++) {
+                if (p_cb->cc_irq[ch]) {
+                    first = MIN(first, next_match(after, p_cb->cc[ch]));
+                }
+            }
+            if (first > now) {
+                p_cb->checked_ticks = now;
+                break;
+            }
+
+            bool cc_due[NRFX_RTC_CC_CHANNEL_COUNT];
+            for (int ch = 0; ch < NRFX_RTC_CC_CHANNEL_COUNT; ch++) {
+                cc_due[ch] = p_cb->cc_irq[ch] && next_match(after, p_cb->cc[ch]) == first;
+            }
+            p_cb->checked_ticks = first;
+
+            if (next_overflow(after) == first && p_cb->overflow_irq) {
+                fired |= fire(p_cb, NRFX_RTC_INT_OVERFLOW);
+            }
+            for (int ch = 0; ch < NRFX_RTC_CC_CHANNEL_COUNT; ch++) {
+                if (cc_due[ch]) {
+                    p_cb->cc_irq[ch] = false;
+                    fired |= fire(p_cb, (nrfx_rtc_int_type_t)ch);
+                }
+            }
+        }
+    }
+    return fired;
+}
+
+uint64_t host_rtc_next_event_us(void)
+{
+    uint64_t earliest = UINT64_MAX;
+
+    for (uint32_t i = 0; i < HOST_RTC_COUNT; i++) {
+        rtc_cb_t const *p_cb = &m_rtc_cb[i];
+        if (!p_cb->enabled) continue;
+
+        for (int ch = 0; ch < NRFX_RTC_CC_CHANNEL_COUNT; ch++) {
+            if (p_cb->cc_irq[ch]) {
+                uint64_t at = ticks_to_us(p_cb, next_match(p_cb->checked_ticks, p_cb->cc[ch]));
+                earliest = MIN(earliest, at);
+            }
+        }
+        if (p_cb->overflow_irq) {
+            uint64_t at = ticks_to_us(p_cb, next_overflow(p_cb->checked_ticks));
+            earliest = MIN(earliest, at);
+        }
+    }
+    return earliest;
+}
@@ -0,0 +1,300 @@
+#include "app_usbd.h"
+#include "app_usbd_cdc_acm.h"
+#include "app_usbd_serial_num.h"
+#include "host_hal.h"
+
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define HOST_USBD_EVT_QUEUE_SIZE 8
+#define HOST_USBD_STAGE_SIZE     4096
+
+static app_usbd_config_t m_config;
+static app_usbd_cdc_acm_t const *mp_cdc_acm;
+static bool m_enabled;
+static bool m_started;
+static bool m_port_open;
+static bool m_tx_busy;
+
+static app_usbd_cdc_acm_user_event_t m_evt_queue[HOST_USBD_EVT_QUEUE_SIZE];
+static uint8_t m_evt_head;
+static uint8_t m_evt_tail;
+
+static uint8_t *mp_rx_buf;
+static size_t m_rx_len;
+static bool m_rx_any;
+static size_t m_rx_done_size;
+
+static uint8_t m_stage[HOST_USBD_STAGE_SIZE];
+static size_t m_stage_pos;
+static size_t m_stage_len;
+static bool m_stdin_eof;
+static bool m_exit_pending;
+
+static uint64_t m_tx_bytes;
+
+static void evt_push(app_usbd_cdc_acm_user_event_t event)
+{
+    uint8_t next = (m_evt_head + 1) % HOST_USBD_EVT_QUEUE_SIZE;
+    if (next != m_evt_tail) {
+        m_evt_queue[m_evt_head] = event;
+        m_evt_head = next;
+    }
+}
+
+static bool evt_pop(app_usbd_cdc_acm_user_event_t *p_event)
+{
+    if (m_evt_head == m_evt_tail) {
+        return false;
+    }
+    *p_event = m_evt_queue[m_evt_tail];
+    m_evt_tail = (m_evt_tail + 1) % HOST_USBD_EVT_QUEUE_SIZE;
+    return true;
+}
+
+static void stage_fill(void)
+{
+    if (m_stage_pos < m_stage_len || m_stdin_eof) return;
+
+    struct pollfd pfd = { .fd = STDIN_FILENO, .events = POLLIN };
+    if (poll(&pfd, 1, 0) <= 0) return;
+
+    ssize_t n = read(STDIN_FILENO, m_stage, sizeof(m_stage));
+    if (n <= 0) {
+        m_stdin_eof = true;
+        return;
+    }
+    m_stage_pos = 0;
+    m_stage_len = (size_t)n;
+}
+
+static void user_event(app_usbd_cdc_acm_user_event_t event)
+{
+    if (mp_cdc_acm != NULL && mp_cdc_acm->user_ev_handler != NULL) {
+        mp_cdc_acm->user_ev_handler(&mp_cdc_acm->base, event);
+    }
+}
+
+ret_code_t app_usbd_init(app_usbd_config_t const * p_config)
+{
+    if (p_config != NULL) {
+        m_config = *p_config;
+    }
+    return NRF_SUCCESS;
+}
+
+ret_code_t app_usbd_uninit(void)
+{
+    memset(&m_config, 0, sizeof(m_config));
+    mp_cdc_acm = NULL;
+    return NRF_SUCCESS;
+}
+
+void app_usbd_enable(void)
+{
+    m_enabled = true;
+}
+
+void app_usbd_disable(void)
+{
+    m_enabled = false;
+}
+
+/* The host side terminal is stdin/stdout, so the port opens as soon as the
+ * device is started and closes on end of input. */
+void app_usbd_start(void)
+{
+    if (!m_enabled || m_started) return;
+
+    m_started = true;
+    if (m_config.ev_state_proc != NULL) {
+        m_config.ev_state_proc(APP_USBD_EVT_STARTED);
+    }
+    m_port_open = true;
+    evt_push(APP_USBD_CDC_ACM_USER_EVT_PORT_OPEN);
+}
+
+void app_usbd_stop(void)
+{
+    if (!m_started) return;
+
+    m_started = false;
+    if (m_config.ev_state_proc != NULL) {
+        m_config.ev_state_proc(APP_USBD_EVT_STOPPED);
+    }
+}
+
+ret_code_t app_usbd_class_append(app_usbd_class_inst_t const * p_cinst)
+{
+    if (p_cinst->class_id == APP_USBD_HOST_CLASS_CDC_ACM) {
+        mp_cdc_acm = (app_usbd_cdc_acm_t const *)p_cinst;
+    }
+    return NRF_SUCCESS;
+}
+
+ret_code_t app_usbd_power_events_enable(void)
+{
+    return NRF_SUCCESS;
+}
+
+bool nrf_drv_usbd_is_enabled(void)
+{
+    return m_enabled;
+}
+
+void app_usbd_serial_num_generate(void)
+{
+}
+
+bool app_usbd_event_queue_process(void)
+{
+    app_usbd_cdc_acm_user_event_t event;
+
+    if (evt_pop(&event)) {
+        user_event(event);
+        return true;
+    }
+
+    stage_fill();
+
+    /* A terminal that closed the port sends nothing until it reopens. */
+    if (m_port_open && mp_rx_buf != NULL && m_stage_pos < m_stage_len) {
+        size_t avail = MIN(m_stage_len - m_stage_pos, NRF_DRV_USBD_EPSIZE);
+        size_t n = MIN(avail, m_rx_len);
+
+        if (m_rx_any || n == m_rx_len) {
+            memcpy(mp_rx_buf, &m_stage[m_stage_pos], n);
+            m_stage_pos += n;
+            m_rx_done_size = n;
+            mp_rx_buf = NULL;
+            user_event(APP_USBD_CDC_ACM_USER_EVT_RX_DONE);
+            return true;
+        }
+    }
+
+    /* End of input: stop once the firmware has made a whole pass without
+     * writing anything, so queued replies are flushed first. */
+    if (m_stdin_eof && m_stage_pos >= m_stage_len) {
+        if (m_exit_pending) {
+            exit(0);
+        }
+        m_exit_pending = true;
+    }
+
+    return false;
+}
+
+ret_code_t app_usbd_cdc_acm_write(app_usbd_cdc_acm_t const * p_cdc_acm,
+                                  void const * p_buf,
+                                  size_t length)
+{
+    if (!m_port_open) {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if (m_tx_busy) {
+        return NRF_ERROR_BUSY;
+    }
+
+    m_exit_pending = false;
+
+    const uint8_t *p = p_buf;
+    size_t left = length;
+    while (left > 0) {
+        ssize_t n = write(STDOUT_FILENO, p, left);
+        if (n <= 0) break;
+        p += n;
+        left -= (size_t)n;
+    }
+    m_tx_bytes += length;
+    evt_push(APP_USBD_CDC_ACM_USER_EVT_TX_DONE);
+    return NRF_SUCCESS;
+}
+
+static ret_code_t rx_arm(void * p_buf, size_t length, bool any)
+{
+    if (mp_rx_buf != NULL) {
+        return NRF_ERROR_BUSY;
+    }
+    mp_rx_buf = p_buf;
+    m_rx_len = length;
+    m_rx_any = any;
+    return NRF_ERROR_IO_PENDING;
+}
+
+ret_code_t app_usbd_cdc_acm_read(app_usbd_cdc_acm_t const * p_cdc_acm,
+                                 void * p_buf,
+                                 size_t length)
+{
+    return rx_arm(p_buf, length, false);
+}
+
+ret_code_t app_usbd_cdc_acm_read_any(app_usbd_cdc_acm_t const * p_cdc_acm,
+                                     void * p_buf,
+                                     size_t length)
+{
+    return rx_arm(p_buf, length, true);
+}
+
+size_t app_usbd_cdc_acm_rx_size(app_usbd_cdc_acm_t const * p_cdc_acm)
+{
+    return m_rx_done_size;
+}
+
+size_t app_usbd_cdc_acm_bytes_stored(app_usbd_cdc_acm_t const * p_cdc_acm)
+{
+    stage_fill();
+    return m_stage_len - m_stage_pos;
+}
+
+ret_code_t app_usbd_cdc_acm_line_state_get(app_usbd_cdc_acm_t const * p_cdc_acm,
+                                           app_usbd_cdc_line_t line,
+                                           uint32_t * value)
+{
+    *value = (line == APP_USBD_CDC_ACM_LINE_STATE_DTR && m_port_open) ? 1 : 0;
+    return NRF_SUCCESS;
+}
+
+/* USB interrupts are modelled as "an event is queued or armed RX can
+ * complete", which is what wakes the real firmware from WFE. */
+bool host_usbd_irq_pending(void)
+{
+    if (m_evt_head != m_evt_tail) {
+        return true;
+    }
+    if (mp_rx_buf == NULL) {
+        return false;
+    }
+    stage_fill();
+    return m_stage_pos < m_stage_len || m_stdin_eof;
+}
+
+int host_usbd_wait_fd(void)
+{
+    return (mp_rx_buf != NULL && !m_stdin_eof) ? STDIN_FILENO : -1;
+}
+
+uint64_t host_usbd_tx_bytes(void)
+{
+    return m_tx_bytes;
+}
+
+void host_usbd_set_tx_busy(bool busy)
+{
+    m_tx_busy = busy;
+}
+
+void host_usbd_set_port_open(bool open)
+{
+    if (open == m_port_open) return;
+    m_port_open = open;
+    evt_push(open ? APP_USBD_CDC_ACM_USER_EVT_PORT_OPEN : APP_USBD_CDC_ACM_USER_EVT_PORT_CLOSE);
+}
+
+void host_usbd_set_suspended(bool suspended)
+{
+    if (m_config.ev_state_proc != NULL) {
+        m_config.ev_state_proc(suspended ? APP_USBD_EVT_DRV_SUSPEND : APP_USBD_EVT_DRV_RESUME);
+    }
+}
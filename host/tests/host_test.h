@@ -0,0 +1,123 @@
+/* Helpers shared by the host tests in this directory. Each test is its own
+ * program built against libesl_host.a; it prints what it measured and exits
+ * non-zero if a check failed. Tests that run the firmware loop include
+ * main.c as app_main() and check the outcome from an atexit() handler, as
+ * the loop only ends through exit(). */
+#ifndef HOST_TEST_H
+#define HOST_TEST_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "host_hal.h"
+
+static int m_test_failures;
+
+#define TEST_CHECK(_cond)                                                  \
+    do {                                                                   \
+        if (!(_cond)) {                                                    \
+            fprintf(stderr, "%s:%d: check failed: %s\n",                   \
+                    __FILE__, __LINE__, #_cond);                           \
+            m_test_failures++;                                             \
+        }                                                                  \
+    } while (0)
+
+/* Exit status for the test, after printing its verdict. */
+static inline int test_result(const char *p_name)
+{
+    fprintf(stderr, "%s: %s\n", p_name, m_test_failures == 0 ? "ok" : "FAILED");
+    return m_test_failures == 0 ? 0 : 1;
+}
+
+/* Wall clock for benchmarks, independent of the virtual device time. */
+static inline uint64_t test_wall_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+/* Moves virtual time on by us, running every emulated interrupt on the way,
+ * for tests that drive modules directly instead of the firmware loop. Steps
+ * are short enough that the PWM period log never wraps in between. */
+static inline void test_run_us(uint64_t us)
+{
+    uint64_t end = host_time_us() + us;
+
+    while (host_time_us() < end) {
+        uint64_t next = host_pwm_next_event_us();
+        uint64_t rtc = host_rtc_next_event_us();
+        uint64_t step = host_time_us() + 250000u;
+        next = rtc < next ? rtc : next;
+        next = step < next ? step : next;
+        next = end < next ? end : next;
+        host_time_advance_to(next);
+        if (!host_irq_dispatch() && next <= host_time_us()) {
+            host_time_advance_to(host_time_us() + 1);
+        }
+    }
+}
+
+/* Feeds the CDC terminal from a file holding len bytes of p_script; the run
+ * ends once the firmware has answered all of it. */
+static inline void test_terminal_script(const void *p_script, size_t len)
+{
+    FILE *p_file = tmpfile();
+    if (p_file == NULL || fwrite(p_script, 1, len, p_file) != len) {
+        perror("tmpfile");
+        exit(2);
+    }
+    fflush(p_file);
+    rewind(p_file);
+    dup2(fileno(p_file), STDIN_FILENO);
+}
+
+/* A terminal that is open but never types anything. */
+static inline void test_terminal_idle(void)
+{
+    int fds[2];
+    if (pipe(fds) != 0) {
+        perror("pipe");
+        exit(2);
+    }
+    dup2(fds[0], STDIN_FILENO);
+}
+
+/* Sends what the firmware writes to the terminal into a file, so the test
+ * can read it back with test_terminal_output(). */
+static FILE *mp_test_output;
+
+static inline void test_terminal_capture(void)
+{
+    mp_test_output = tmpfile();
+    if (mp_test_output == NULL) {
+        perror("tmpfile");
+        exit(2);
+    }
+    fflush(stdout);
+    dup2(fileno(mp_test_output), STDOUT_FILENO);
+}
+
+/* Everything captured so far, NUL terminated; the caller frees it. */
+static inline char *test_terminal_output(size_t *p_len)
+{
+    fflush(stdout);
+    long len = lseek(fileno(mp_test_output), 0, SEEK_END);
+    char *p_text = malloc((size_t)len + 1);
+    if (p_text == NULL || pread(fileno(mp_test_output), p_text, (size_t)len, 0) != len) {
+        perror("read");
+        exit(2);
+    }
+    p_text[len] = '\0';
+    if (p_len != NULL) {
+        *p_len = (size_t)len;
+    }
+    return p_text;
+}
+
+#endif
@@ -0,0 +1,152 @@
+/* A terminal that is open but never takes a packet: every CDC write returns
+ * NRF_ERROR_BUSY. A script of commands is pasted and the button is held in
+ * MODE_HUE meanwhile. No loop pass may spend a millisecond of host time in
+ * the CLI or delay device time there, and the hold repeats must still be
+ * handled within a millisecond. */
+#include "host_test.h"
+#include "host_hal.h"
+#include "timebase.h"
+#include "usb_cli.h"
+
+/* The loop in main.c calls these in place of the real ones. */
+void test_cli_process(void);
+void test_sleep(void);
+void test_sleep_until(uint32_t deadline_ms);
+
+#define cli_process          test_cli_process
+#define timebase_sleep       test_sleep
+#define timebase_sleep_until test_sleep_until
+#define main                 app_main
+#include "main.c"
+#undef main
+#undef timebase_sleep_until
+#undef timebase_sleep
+#undef cli_process
+
+#define RUN_US      5000000u
+#define HELP_PASTES 40
+#define HOLD_END_MS 3520
+
+/* Button script: a double click into MODE_HUE, then a 2 s hold. */
+static const struct {
+    uint32_t time_ms;
+    bool pressed;
+} m_script[] = {
+    { 1000, true }, { 1060, false }, { 1160, true }, { 1220, false },
+    { 1500, true }, { HOLD_END_MS, false },
+};
+#define SCRIPT_LEN (sizeof(m_script) / sizeof(m_script[0]))
+static uint32_t m_script_pos;
+
+static uint64_t m_cli_max_us;
+static uint64_t m_cli_delay_max_us;
+static uint32_t m_late_max_ms;
+static uint32_t m_passes;
+static uint16_t m_hue_start;
+
+static void script_run(uint32_t now)
+{
+    while (m_script_pos < SCRIPT_LEN && m_script[m_script_pos].time_ms <= now) {
+        host_gpio_set_input(BUTTON_PIN, !m_script[m_script_pos].pressed);
+        if (m_script[m_script_pos].pressed && m_script_pos == 4) {
+            hsv_color_t hsv;
+            color_state_get_hsv(&hsv);
+            m_hue_start = hsv.h;
+        }
+        m_script_pos++;
+    }
+}
+
+void test_cli_process(void)
+{
+    uint32_t now = timebase_millis();
+    uint32_t deadline;
+
+    script_run(now);
+    if (button_next_deadline(&deadline) && (int32_t)(now - deadline) > (int32_t)m_late_max_ms) {
+        m_late_max_ms = now - deadline;
+    }
+
+    /* Virtual time only moves inside nrf_delay_*() here, so it catches a
+     * retry loop that waits; host time catches one that spins. */
+    uint64_t start_ns = test_wall_ns();
+    uint64_t start_us = host_time_us();
+    cli_process();
+    uint64_t spent_us = (test_wall_ns() - start_ns) / 1000u;
+    uint64_t delayed_us = host_time_us() - start_us;
+    m_cli_max_us = spent_us > m_cli_max_us ? spent_us : m_cli_max_us;
+    m_cli_delay_max_us = delayed_us > m_cli_delay_max_us ? delayed_us : m_cli_delay_max_us;
+    m_passes++;
+}
+
+/* The loop sleeps as it would, but wakes for the next scripted edge. */
+void test_sleep_until(uint32_t deadline_ms)
+{
+    if (m_script_pos < SCRIPT_LEN &&
+        (int32_t)(m_script[m_script_pos].time_ms - deadline_ms) < 0) {
+        deadline_ms = m_script[m_script_pos].time_ms;
+    }
+    timebase_sleep_until(deadline_ms);
+}
+
+void test_sleep(void)
+{
+    if (m_script_pos < SCRIPT_LEN) {
+        test_sleep_until(m_script[m_script_pos].time_ms);
+    } else {
+        timebase_sleep();
+    }
+}
+
+static void check(void)
+{
+    hsv_color_t hsv;
+    color_state_get_hsv(&hsv);
+    uint16_t swept = (hsv.h + 360 - m_hue_start) % 360;
+
+    /* Every repeat of the hold, each with the step it should carry. */
+    uint32_t expected = 1;
+    for (uint32_t t = BUTTON_HOLD_DELAY_MS + VALUE_CHANGE_INTERVAL_MS; t <= HOLD_END_MS - 1500;
+         t += VALUE_CHANGE_INTERVAL_MS) {
+        uint32_t steps = 1 + (t - BUTTON_HOLD_DELAY_MS) / BUTTON_ACCEL_PERIOD_MS;
+        expected += steps < BUTTON_REPEAT_MAX_STEPS ? steps : BUTTON_REPEAT_MAX_STEPS;
+    }
+
+    fprintf(stderr, "busy host: %u passes, CLI at most %llu us of host time and %llu us of "
+            "delays, button late at most %u ms, %llu bytes sent, hue moved %u\n", m_passes,
+            (unsigned long long)m_cli_max_us, (unsigned long long)m_cli_delay_max_us, m_late_max_ms,
+            (unsigned long long)host_usbd_tx_bytes(), swept);
+    TEST_CHECK(m_script_pos == SCRIPT_LEN);
+    TEST_CHECK(current_mode == MODE_HUE);
+    TEST_CHECK(host_usbd_tx_bytes() == 0);
+    TEST_CHECK(m_cli_max_us < 1000);
+    TEST_CHECK(m_cli_delay_max_us == 0);
+    TEST_CHECK(m_late_max_ms <= 1);
+    TEST_CHECK(swept == expected % 360);
+    _exit(test_result("test_busy_host"));
+}
+
+int main(void)
+{
+    if (!host_time_is_virtual()) {
+        fprintf(stderr, "test_busy_host: needs HOST_VIRTUAL_TIME=1\n");
+        return 2;
+    }
+    int fds[2];
+    if (pipe(fds) != 0) {
+        perror("pipe");
+        return 2;
+    }
+    for (uint32_t i = 0; i < HELP_PASTES; i++) {
+        if (write(fds[1], "help\r", 5) != 5) {
+            return 2;
+        }
+    }
+    dup2(fds[0], STDIN_FILENO);
+    test_terminal_capture();
+
+    host_usbd_set_tx_busy(true);
+    host_time_set_limit(RUN_US);
+    atexit(check);
+    return app_main();
+}
@@ -0,0 +1,163 @@
+/* Feeds the button state machine timestamped edges and checks the gestures
+ * it reports, without the GPIOTE interrupt or a clock: button_edge() takes
+ * the edge time and button_process() the current time. */
+#include "host_test.h"
+#include "host_hal.h"
+#include "app_config.h"
+#include "button.h"
+
+#define MAX_EVENTS 256
+
+static button_evt_t m_seen[MAX_EVENTS];
+static uint32_t m_seen_count;
+static uint32_t m_now;
+
+static void edge(bool pressed, uint32_t time_ms)
+{
+    host_gpio_set_input(BUTTON_PIN, !pressed);
+    button_edge(pressed, time_ms);
+}
+
+/* Runs the state machine up to time_ms, stopping at each deadline on the
+ * way as the main loop would, and collects the events. */
+static void run_to(uint32_t time_ms)
+{
+    while (m_now != time_ms) {
+        uint32_t deadline;
+        if (button_next_deadline(&deadline) && (int32_t)(deadline - m_now) >= 0 &&
+            (int32_t)(deadline - time_ms) < 0) {
+            m_now = deadline;
+        } else {
+            m_now = time_ms;
+        }
+        button_process(m_now);
+
+        button_evt_t evt;
+        while (button_event_get(&evt)) {
+            if (m_seen_count < MAX_EVENTS) {
+                m_seen[m_seen_count++] = evt;
+            }
+        }
+    }
+}
+
+static uint32_t count_type(button_evt_type_t type)
+{
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < m_seen_count; i++) {
+        count += (m_seen[i].type == type);
+    }
+    return count;
+}
+
+/* Lets any pending timer run out and starts the next scenario afresh. */
+static void settle(void)
+{
+    run_to(m_now + 2000);
+    uint32_t deadline;
+    TEST_CHECK(!button_next_deadline(&deadline));
+    m_seen_count = 0;
+}
+
+static void test_click(void)
+{
+    uint32_t t = m_now;
+    edge(true, t + 10);
+    edge(false, t + 110);
+    run_to(t + 110 + DOUBLE_CLICK_TIMEOUT_MS);
+    TEST_CHECK(m_seen_count == 1);
+    TEST_CHECK(m_seen[0].type == BUTTON_EVT_CLICK);
+    TEST_CHECK(m_seen[0].time_ms == t + 10);
+    settle();
+}
+
+static void test_double_click(void)
+{
+    uint32_t t = m_now;
+    edge(true, t + 10);
+    edge(false, t + 90);
+    edge(true, t + 200);
+    edge(false, t + 280);
+    run_to(t + 300);
+    TEST_CHECK(m_seen_count == 1);
+    TEST_CHECK(m_seen[0].type == BUTTON_EVT_DOUBLE_CLICK);
+    TEST_CHECK(m_seen[0].time_ms == t + 200);
+    settle();
+    TEST_CHECK(m_seen_count == 0);
+}
+
+/* Contact bounce inside DEBOUNCE_MS is one press and one release. */
+static void test_bounce(void)
+{
+    uint32_t t = m_now;
+    edge(true, t + 10);
+    edge(false, t + 12);
+    edge(true, t + 15);
+    edge(false, t + 100);
+    edge(true, t + 103);
+    edge(false, t + 104);
+    run_to(t + 1000);
+    TEST_CHECK(m_seen_count == 1);
+    TEST_CHECK(m_seen[0].type == BUTTON_EVT_CLICK);
+    settle();
+}
+
+/* Holding repeats every VALUE_CHANGE_INTERVAL_MS with a growing step; a
+ * full hue circle takes about two seconds. */
+static void test_hold(void)
+{
+    uint32_t t = m_now;
+    edge(true, t + 10);
+    run_to(t + 10 + BUTTON_HOLD_DELAY_MS);
+    TEST_CHECK(m_seen_count == 1);
+    TEST_CHECK(m_seen[0].type == BUTTON_EVT_HOLD_START);
+    TEST_CHECK(m_seen[0].time_ms == t + 10 + BUTTON_HOLD_DELAY_MS);
+
+    uint32_t hue = 0;
+    uint32_t sweep_ms = 0;
+    for (uint32_t step = 1; hue < 360; step++) {
+        run_to(m_seen[m_seen_count - 1].time_ms + VALUE_CHANGE_INTERVAL_MS);
+        TEST_CHECK(m_seen[m_seen_count - 1].type == BUTTON_EVT_HOLD_REPEAT);
+        hue += m_seen[m_seen_count - 1].steps;
+        sweep_ms = m_seen[m_seen_count - 1].time_ms - (t + 10);
+    }
+    fprintf(stderr, "hue sweep: %u ms\n", sweep_ms);
+    TEST_CHECK(sweep_ms >= 1500 && sweep_ms <= 2500);
+
+    edge(false, m_now + 5);
+    run_to(m_now + 10);
+    TEST_CHECK(m_seen[m_seen_count - 1].type == BUTTON_EVT_RELEASE);
+    settle();
+    TEST_CHECK(m_seen_count == 0);
+}
+
+/* More bounce than the edge queue holds, with the final release among the
+ * edges that are lost: the pin is read back and the hold ends. */
+static void test_edge_overflow(void)
+{
+    uint32_t t = m_now;
+    edge(true, t + 10);
+    run_to(t + 10 + BUTTON_HOLD_DELAY_MS + 5);
+    TEST_CHECK(count_type(BUTTON_EVT_HOLD_START) == 1);
+
+    t = m_now;
+    for (uint32_t i = 0; i <= 40; i++) {
+        edge((i & 1) != 0, t + 1);
+    }
+    run_to(t + 2);
+    TEST_CHECK(count_type(BUTTON_EVT_RELEASE) == 1);
+    settle();
+    TEST_CHECK(m_seen_count == 0);
+}
+
+int main(void)
+{
+    host_gpio_set_input(BUTTON_PIN, true);
+
+    test_click();
+    test_double_click();
+    test_bounce();
+    test_hold();
+    test_edge_overflow();
+    return test_result("test_button");
+}
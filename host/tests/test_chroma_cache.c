@@ -0,0 +1,96 @@
+/* Validates the chroma cache of the color state. hsv_chroma_apply() must
+ * give exactly what hsv_to_rgb16() gives for every h 0..719, s and v. Then
+ * the color state is driven like a held button (V holds, hue and
+ * saturation sweeps, repeated colors) with its chroma builds and PWM
+ * stagings counted: a V-only change must not rebuild the chroma, and an
+ * unchanged color must not restage the PWM. */
+#include "host_test.h"
+#include "hsv.h"
+#include "pwm_leds.h"
+
+static uint32_t m_builds;
+static uint32_t m_stagings;
+static uint32_t m_skipped;
+
+static void test_chroma_init(hsv_chroma_t *p_chroma, uint16_t h, uint8_t s)
+{
+    m_builds++;
+    hsv_chroma_init(p_chroma, h, s);
+}
+
+static uint32_t test_fade_rgb16(uint16_t r, uint16_t g, uint16_t b, uint32_t fade_ms)
+{
+    static uint32_t last = UINT32_MAX;
+    uint32_t update = pwm_fade_rgb16(r, g, b, fade_ms);
+    m_stagings++;
+    m_skipped += update == last;
+    last = update;
+    return update;
+}
+
+#define hsv_chroma_init test_chroma_init
+#define pwm_fade_rgb16 test_fade_rgb16
+#include "src/color_state.c"
+#undef hsv_chroma_init
+#undef pwm_fade_rgb16
+
+static void check_exact(void)
+{
+    uint32_t mismatches = 0;
+
+    for (uint16_t h = 0; h < 720; h++) {
+        for (uint8_t s = 0; s <= 100; s++) {
+            hsv_chroma_t chroma;
+            hsv_chroma_init(&chroma, h, s);
+            for (uint8_t v = 0; v <= 100; v++) {
+                rgb16_t cached;
+                rgb16_t full;
+                hsv_chroma_apply(&chroma, v, &cached);
+                hsv_to_rgb16(h, s, v, &full.r, &full.g, &full.b);
+                mismatches += memcmp(&cached, &full, sizeof(full)) != 0;
+            }
+        }
+    }
+    fprintf(stderr, "chroma cache: %u mismatches over 720x101x101\n", mismatches);
+    TEST_CHECK(mismatches == 0);
+}
+
+int main(void)
+{
+    check_exact();
+    pwm_leds_init();
+
+    uint32_t updates = 0;
+    hsv_color_t hsv = { 200, 80, 0 };
+    /* V holds up and down, as in MODE_BRIGHTNESS. */
+    for (uint8_t round = 0; round < 4; round++) {
+        for (uint8_t v = 0; v <= 100; v++, updates++) {
+            hsv.v = (round & 1) ? 100 - v : v;
+            color_state_set_hsv(&hsv, 0);
+        }
+    }
+    uint32_t v_builds = m_builds;
+    /* Hue and saturation sweeps rebuild every time. */
+    for (uint16_t h = 0; h < 360; h++, updates++) {
+        hsv.h = h;
+        color_state_set_hsv(&hsv, 0);
+    }
+    for (uint8_t s = 0; s <= 100; s++, updates++) {
+        hsv.s = s;
+        color_state_set_hsv(&hsv, 0);
+    }
+    /* The same color again and again. */
+    uint32_t skipped_before = m_skipped;
+    for (uint8_t i = 0; i < 100; i++, updates++) {
+        color_state_set_hsv(&hsv, 0);
+    }
+    uint32_t repeats_skipped = m_skipped - skipped_before;
+
+    fprintf(stderr, "chroma cache: %u updates, %u chroma builds, %u full conversions avoided, "
+            "%u of 100 repeats skipped at the PWM\n",
+            updates, m_builds, updates - m_builds, repeats_skipped);
+    TEST_CHECK(v_builds == 1);
+    TEST_CHECK(m_builds == v_builds + 360 + 101);
+    TEST_CHECK(repeats_skipped == 100);
+    return test_result("test_chroma_cache");
+}
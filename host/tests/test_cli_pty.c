@@ -0,0 +1,294 @@
+/* CLI scripting through a pty, the way a host script talks to the device.
+ * The firmware runs with a raw pty slave as its terminal and a thread plays
+ * the script on the master. The same HSV commands are sent twice: one per
+ * line, waiting for each prompt as an interactive terminal would, and in
+ * quiet mode as ';' pipelines that are all written without waiting for
+ * any reply. A mixed line checks that every pipelined command gets its own
+ * status code. Commands per second of both runs are reported, the
+ * pipelines as the best of a few repeats so that one scheduling delay on a
+ * loaded host does not decide the result, and they must be at least an
+ * order of magnitude faster. */
+#define _GNU_SOURCE
+#include "host_test.h"
+#include "host_hal.h"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <termios.h>
+
+#define main app_main
+#include "main.c"
+#undef main
+
+#define COMMANDS       2000u
+#define PIPELINE       15u
+#define REPEATS        5u
+#define REPLY_TIMEOUT  5000
+#define SEED           12u
+
+static int m_master = -1;
+
+/* Everything the firmware has written since the last take. */
+static char m_rx[1 << 16];
+static size_t m_rx_len;
+
+static uint64_t m_seed;
+
+static uint32_t rand_below(uint32_t n)
+{
+    m_seed = m_seed * 1103515245u + 12345u;
+    return (uint32_t)(m_seed >> 8) % n;
+}
+
+static bool read_some(int timeout_ms)
+{
+    struct pollfd pfd = { .fd = m_master, .events = POLLIN };
+    if (poll(&pfd, 1, timeout_ms) <= 0) {
+        return false;
+    }
+    ssize_t n = read(m_master, m_rx + m_rx_len, sizeof(m_rx) - 1 - m_rx_len);
+    if (n <= 0) {
+        return false;
+    }
+    m_rx_len += (size_t)n;
+    m_rx[m_rx_len] = '\0';
+    return true;
+}
+
+static void write_all(const char *p_text, size_t len)
+{
+    while (len > 0) {
+        ssize_t n = write(m_master, p_text, len);
+        if (n <= 0) {
+            perror("pty write");
+            _exit(2);
+        }
+        p_text += n;
+        len -= (size_t)n;
+    }
+}
+
+static bool ends_with(const char *p_tail)
+{
+    size_t n = strlen(p_tail);
+    return m_rx_len >= n && memcmp(m_rx + m_rx_len - n, p_tail, n) == 0;
+}
+
+/* Reads until the output ends with p_tail; false if it stops short. */
+static bool read_until(const char *p_tail)
+{
+    while (!ends_with(p_tail)) {
+        if (!read_some(REPLY_TIMEOUT) || m_rx_len == sizeof(m_rx) - 1) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Reads until the output holds count whole lines. */
+static bool read_lines(uint32_t count)
+{
+    for (;;) {
+        uint32_t lines = 0;
+        for (const char *p = m_rx; (p = strstr(p, "\r\n")) != NULL; p += 2) {
+            lines++;
+        }
+        if (lines >= count) {
+            return true;
+        }
+        if (!read_some(REPLY_TIMEOUT) || m_rx_len == sizeof(m_rx) - 1) {
+            return false;
+        }
+    }
+}
+
+static void take(void)
+{
+    m_rx_len = 0;
+    m_rx[0] = '\0';
+}
+
+static void random_hsv(uint32_t hsv[3])
+{
+    hsv[0] = rand_below(360);
+    hsv[1] = rand_below(101);
+    hsv[2] = rand_below(101);
+}
+
+/* One command per line, each sent once the prompt for the last is back. */
+static uint64_t run_interactive(uint32_t *p_mismatches)
+{
+    m_seed = SEED;
+    uint64_t start_ns = test_wall_ns();
+    for (uint32_t i = 0; i < COMMANDS; i++) {
+        uint32_t hsv[3];
+        char line[32];
+        char expected[48];
+        random_hsv(hsv);
+        int n = snprintf(line, sizeof(line), "HSV %u %u %u\r", hsv[0], hsv[1], hsv[2]);
+        snprintf(expected, sizeof(expected), "\r\nSet HSV: %u %u %u\r\n", hsv[0], hsv[1], hsv[2]);
+        write_all(line, (size_t)n);
+        if (!read_until("> ")) {
+            (*p_mismatches)++;
+            break;
+        }
+        *p_mismatches += (strstr(m_rx, expected) == NULL);
+        take();
+    }
+    return test_wall_ns() - start_ns;
+}
+
+/* The same commands PIPELINE to a line in quiet mode, written as fast as
+ * the pty takes them while the replies are read back in between. */
+static uint64_t run_pipelined(uint32_t *p_mismatches)
+{
+    size_t cap = COMMANDS * 20;
+    char *p_script = malloc(cap);
+    size_t script_len = 0;
+
+    m_seed = SEED;
+    for (uint32_t i = 0; i < COMMANDS; i++) {
+        uint32_t hsv[3];
+        random_hsv(hsv);
+        char end = ((i + 1) % PIPELINE == 0 || i + 1 == COMMANDS) ? '\r' : ';';
+        script_len += (size_t)snprintf(p_script + script_len, cap - script_len, "HSV %u %u %u%c",
+                                       hsv[0], hsv[1], hsv[2], end);
+    }
+
+    int flags = fcntl(m_master, F_GETFL);
+    fcntl(m_master, F_SETFL, flags | O_NONBLOCK);
+
+    uint64_t start_ns = test_wall_ns();
+    size_t sent = 0;
+    uint32_t replies = 0;
+    size_t parsed = 0;
+    while (replies < COMMANDS) {
+        struct pollfd pfd = {
+            .fd = m_master,
+            .events = POLLIN | (sent < script_len ? POLLOUT : 0)
+        };
+        if (poll(&pfd, 1, REPLY_TIMEOUT) <= 0) {
+            break;
+        }
+        if ((pfd.revents & POLLOUT) != 0) {
+            ssize_t n = write(m_master, p_script + sent, script_len - sent);
+            sent += (n > 0) ? (size_t)n : 0;
+        }
+        if ((pfd.revents & POLLIN) != 0 && !read_some(0)) {
+            break;
+        }
+        /* Count whole status lines and keep any partial one. */
+        char *p_eol;
+        while ((p_eol = strstr(m_rx + parsed, "\r\n")) != NULL) {
+            *p_mismatches += (p_eol - (m_rx + parsed) != 2 || strncmp(m_rx + parsed, "OK", 2) != 0);
+            parsed = (size_t)(p_eol + 2 - m_rx);
+            replies++;
+        }
+        memmove(m_rx, m_rx + parsed, m_rx_len - parsed + 1);
+        m_rx_len -= parsed;
+        parsed = 0;
+    }
+    uint64_t elapsed_ns = test_wall_ns() - start_ns;
+
+    fcntl(m_master, F_SETFL, flags);
+    *p_mismatches += COMMANDS - replies;
+    take();
+    free(p_script);
+    return elapsed_ns;
+}
+
+/* Each command of a pipeline answers on its own line, in order, whatever
+ * the others do. */
+static void check_statuses(void)
+{
+    static const char line[] =
+        "HSV 10 20 30;frobnicate 1;RGB 1 2;apply_color nosuch;HSV 400 10 10; rgb 7 8 9 \r";
+    static const char expected[] = "OK\r\nERR 1\r\nERR 2\r\nERR 3\r\nERR 2\r\nOK\r\n";
+
+    write_all(line, sizeof(line) - 1);
+    TEST_CHECK(read_lines(6) && strcmp(m_rx, expected) == 0);
+    take();
+
+    /* A line longer than the buffer is one error, not a string of them. */
+    char long_line[300];
+    memset(long_line, 'x', sizeof(long_line) - 1);
+    long_line[sizeof(long_line) - 1] = '\r';
+    write_all(long_line, sizeof(long_line));
+    TEST_CHECK(read_lines(1) && strcmp(m_rx, "ERR 5\r\n") == 0);
+    take();
+}
+
+static void *terminal(void *p_arg)
+{
+    uint32_t interactive_mismatches = 0;
+    uint32_t pipelined_mismatches = 0;
+
+    /* An empty line only brings up a prompt; once it is back the CLI is
+     * listening. */
+    write_all("\r", 1);
+    TEST_CHECK(read_until("> "));
+    take();
+
+    uint64_t interactive_ns = run_interactive(&interactive_mismatches);
+
+    write_all("quiet 1\r", 8);
+    TEST_CHECK(read_until("OK\r\n"));
+    take();
+
+    check_statuses();
+    uint64_t pipelined_ns = UINT64_MAX;
+    for (uint32_t i = 0; i < REPEATS; i++) {
+        pipelined_ns = MIN(pipelined_ns, run_pipelined(&pipelined_mismatches));
+    }
+
+    double interactive_rate = COMMANDS / (interactive_ns / 1e9);
+    double pipelined_rate = COMMANDS / (pipelined_ns / 1e9);
+    fprintf(stderr, "cli pty: %u commands one per line: %.1f ms, %.0f commands/s, %u mismatched\n",
+            COMMANDS, interactive_ns / 1e6, interactive_rate, interactive_mismatches);
+    fprintf(stderr, "cli pty: %u commands %u per line, quiet, best of %u: %.1f ms, %.0f commands/s, %u mismatched, "
+            "%.1fx\n", COMMANDS, PIPELINE, REPEATS, pipelined_ns / 1e6, pipelined_rate, pipelined_mismatches,
+            pipelined_rate / interactive_rate);
+
+    TEST_CHECK(interactive_mismatches == 0);
+    TEST_CHECK(pipelined_mismatches == 0);
+    TEST_CHECK(pipelined_rate >= 10 * interactive_rate);
+    _exit(test_result("test_cli_pty"));
+}
+
+int main(void)
+{
+    /* In virtual time the firmware would run its timers flat out while it
+     * waits for the terminal and take the CPU from it. */
+    host_time_set_virtual(false);
+
+    m_master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (m_master < 0 || grantpt(m_master) != 0 || unlockpt(m_master) != 0) {
+        perror("posix_openpt");
+        return 2;
+    }
+    int slave = open(ptsname(m_master), O_RDWR | O_NOCTTY);
+    if (slave < 0) {
+        perror("open pty");
+        return 2;
+    }
+
+    /* No line discipline: bytes pass both ways as the USB CDC port would
+     * carry them. */
+    struct termios tio;
+    tcgetattr(slave, &tio);
+    cfmakeraw(&tio);
+    tcsetattr(slave, TCSANOW, &tio);
+
+    fflush(stdout);
+    dup2(slave, STDIN_FILENO);
+    dup2(slave, STDOUT_FILENO);
+    close(slave);
+
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, terminal, NULL) != 0) {
+        perror("pthread_create");
+        return 2;
+    }
+    return app_main();
+}
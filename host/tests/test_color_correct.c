@@ -0,0 +1,81 @@
+/* Checks color_correct_apply() against a double precision model of the
+ * matrix and gains over a million random colors in dither units, then
+ * times it. Every streamed frame takes one conversion, so the benchmark
+ * reports ns and, on x86, TSC cycles per conversion. */
+#include <math.h>
+#include "host_test.h"
+#include "color_correct.h"
+#include "dither.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define TEST_CYCLES() __rdtsc()
+#else
+#define TEST_CYCLES() 0
+#endif
+
+#define COLORS       1000000u
+#define BENCH_ROUNDS 20000000u
+
+static uint32_t m_seed = 17;
+
+static uint32_t rand_below(uint32_t n)
+{
+    m_seed = m_seed * 1103515245u + 12345u;
+    return (m_seed >> 8) % n;
+}
+
+static double model(color_calib_t const *p_calib, uint8_t row, uint16_t const in[3])
+{
+    double sum = 0;
+    for (uint8_t j = 0; j < 3; j++) {
+        sum += p_calib->matrix[row][j] / 32768.0 * in[j];
+    }
+    sum *= p_calib->gain[row] / 32768.0;
+    return sum < 0 ? 0 : (sum > DITHER_MAX ? DITHER_MAX : sum);
+}
+
+int main(void)
+{
+    color_calib_t calib = {
+        .matrix = { { 31130, 1638, 0 }, { -983, 32767, 655 }, { 0, 2293, 29491 } },
+        .gain = { 27853, 32767, 24576 }
+    };
+    color_correct_set(&calib);
+
+    double worst = 0;
+    for (uint32_t i = 0; i < COLORS; i++) {
+        uint16_t in[3] = { rand_below(DITHER_MAX + 1), rand_below(DITHER_MAX + 1),
+                           rand_below(DITHER_MAX + 1) };
+        uint16_t out[3] = { in[0], in[1], in[2] };
+        color_correct_apply(&out[0], &out[1], &out[2], DITHER_MAX);
+        for (uint8_t c = 0; c < 3; c++) {
+            double error = fabs(out[c] - model(&calib, c, in));
+            worst = error > worst ? error : worst;
+        }
+    }
+    fprintf(stderr, "color correct: worst %.2f of a 1/%u count over %u colors\n",
+            worst, DITHER_SCALE, COLORS);
+    TEST_CHECK(worst <= 1.0);
+
+    /* Inputs depend on the last output so the loop cannot be hoisted. */
+    uint16_t r = 1000, g = 5000, b = 9000;
+    uint64_t start_ns = test_wall_ns();
+    uint64_t start_cycles = TEST_CYCLES();
+    for (uint32_t i = 0; i < BENCH_ROUNDS; i++) {
+        uint16_t next_r = (uint16_t)((r + i) % DITHER_MAX);
+        uint16_t next_g = g;
+        uint16_t next_b = (uint16_t)((b + 7 * i) % DITHER_MAX);
+        color_correct_apply(&next_r, &next_g, &next_b, DITHER_MAX);
+        r = next_r;
+        g = (uint16_t)(next_g ^ (i & 0xFF));
+        b = next_b;
+    }
+    uint64_t cycles = TEST_CYCLES() - start_cycles;
+    double ns = (double)(test_wall_ns() - start_ns) / BENCH_ROUNDS;
+    fprintf(stderr, "color correct: %.1f ns, %.1f TSC cycles per conversion (%u %u %u)\n",
+            ns, (double)cycles / BENCH_ROUNDS, r, g, b);
+    TEST_CHECK(ns < 1000.0);
+
+    return test_result("test_color_correct");
+}
@@ -0,0 +1,126 @@
+/* Checks where the brightness curve applies, reading what PWM0 plays with
+ * dither off. RGB colors are duty cycles and reach the PWM as given under
+ * every curve. HSV colors go through the selected curve. The HSV view of an
+ * RGB color, taken through the inverse curve, shows it again within a count,
+ * and a curve change moves HSV colors but leaves RGB ones alone. */
+#include <stdlib.h>
+#include "host_test.h"
+#include "app_config.h"
+#include "color_state.h"
+#include "curve.h"
+#include "pwm_leds.h"
+
+/* PWM counts of LD2 as r, g, b. */
+static void shown(uint16_t counts[3])
+{
+    uint16_t values[4];
+
+    test_run_us(5000);
+    host_pwm_get_values(0, values);
+    counts[0] = values[0];
+    counts[1] = values[2];
+    counts[2] = values[1];
+}
+
+static uint32_t off_by(uint16_t const a[3], uint16_t const b[3])
+{
+    uint32_t worst = 0;
+    for (uint8_t c = 0; c < 3; c++) {
+        uint32_t d = (uint32_t)abs((int32_t)a[c] - (int32_t)b[c]);
+        worst = d > worst ? d : worst;
+    }
+    return worst;
+}
+
+static void set_counts(uint16_t r, uint16_t g, uint16_t b)
+{
+    rgb16_t rgb = { color_from_counts(r), color_from_counts(g), color_from_counts(b) };
+    color_state_set_rgb16(&rgb, 0);
+}
+
+int main(void)
+{
+    if (!host_time_is_virtual()) {
+        fprintf(stderr, "test_color_state: needs HOST_VIRTUAL_TIME=1\n");
+        return 2;
+    }
+    pwm_leds_init();
+    pwm_set_dither(false);
+
+    /* RGB is duty under every curve. */
+    uint32_t rgb_off = 0;
+    for (curve_t curve = 0; curve < CURVE_COUNT; curve++) {
+        curve_select(curve);
+        for (uint16_t level = 1; level <= PWM_TOP_VALUE; level += 37) {
+            uint16_t want[3] = { level, level / 3, PWM_TOP_VALUE - level };
+            uint16_t got[3];
+            set_counts(want[0], want[1], want[2]);
+            shown(got);
+            rgb_off += off_by(want, got);
+        }
+    }
+    curve_select(CURVE_CIE_LSTAR);
+    uint16_t low[3];
+    set_counts(7, 3, 1);
+    shown(low);
+    fprintf(stderr, "RGB 7 3 1 plays %u %u %u under CIE L*, %u counts off in all\n",
+            low[0], low[1], low[2], rgb_off);
+    TEST_CHECK(rgb_off == 0);
+
+    /* HSV goes through the curve: V 50 is L* 50, about 18.4% duty. */
+    hsv_color_t half = { 0, 100, 50 };
+    uint16_t red[3];
+    color_state_set_hsv(&half, 0);
+    shown(red);
+    fprintf(stderr, "HSV 0 100 50 plays %u %u %u under CIE L*\n", red[0], red[1], red[2]);
+    TEST_CHECK(red[0] >= 183 && red[0] <= 186 && red[1] == 0 && red[2] == 0);
+
+    /* The HSV view of an RGB color shows it again. HSV holds whole
+     * percent, so the brightest channel comes back within one V step. */
+    uint32_t view_off = 0;
+    uint32_t seed = 11;
+    for (uint32_t i = 0; i < 2000; i++) {
+        uint16_t want[3];
+        for (uint8_t c = 0; c < 3; c++) {
+            seed = seed * 1103515245u + 12345u;
+            want[c] = (seed >> 8) % (PWM_TOP_VALUE + 1);
+        }
+        uint16_t got[3];
+        hsv_color_t hsv;
+        set_counts(want[0], want[1], want[2]);
+        color_state_get_hsv(&hsv);
+        color_state_set_hsv(&hsv, 0);
+        shown(got);
+
+        uint8_t top = 0;
+        for (uint8_t c = 1; c < 3; c++) {
+            top = want[c] > want[top] ? c : top;
+        }
+        uint8_t v = hsv.v < 100 ? hsv.v : 99;
+        uint16_t step = color_to_counts(curve_apply(CURVE_CIE_LSTAR, (v + 1) * UINT16_MAX / 100)) -
+                        color_to_counts(curve_apply(CURVE_CIE_LSTAR, v * UINT16_MAX / 100));
+        uint32_t off = (uint32_t)abs((int32_t)want[top] - (int32_t)got[top]);
+        if (off > step) {
+            view_off++;
+        }
+    }
+    fprintf(stderr, "HSV view of RGB colors: %u of 2000 off by more than a V step\n", view_off);
+    TEST_CHECK(view_off == 0);
+
+    /* A new curve moves HSV colors, not RGB ones. */
+    uint16_t before[3];
+    uint16_t after[3];
+    color_state_set_hsv(&half, 0);
+    curve_select(CURVE_LINEAR);
+    color_state_refresh();
+    shown(after);
+    TEST_CHECK(after[0] >= 499 && after[0] <= 501);
+    set_counts(400, 200, 100);
+    shown(before);
+    curve_select(CURVE_GAMMA_22);
+    color_state_refresh();
+    shown(after);
+    TEST_CHECK(off_by(before, after) == 0);
+
+    return test_result("test_color_state");
+}
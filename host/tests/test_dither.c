@@ -0,0 +1,106 @@
+/* Checks which colors pay for dithering. With dither on, colors staged in
+ * whole counts must keep one value set and reach the LED within two periods,
+ * even when the calibration leaves them with a fraction. 16-bit colors with
+ * a sub-count part must average to it exactly over a dither sequence and
+ * reach the LED within two sequences. */
+#include "host_test.h"
+#include "app_config.h"
+#include "color_correct.h"
+#include "dither.h"
+#include "pwm_leds.h"
+
+#define UPDATES  300
+#define POLL_US  50
+
+static uint64_t wait_live(uint32_t update)
+{
+    uint64_t start_us = host_time_us();
+    while (!pwm_rgb_is_live(update) && host_time_us() - start_us < 100000u) {
+        test_run_us(POLL_US);
+    }
+    return host_time_us() - start_us;
+}
+
+/* Red of the last periods logged; false if they were not all logged. */
+static bool last_red(uint16_t *p_red, uint32_t count)
+{
+    uint32_t total = host_pwm_period_count(0);
+    for (uint32_t i = 0; i < count; i++) {
+        host_pwm_period_t period;
+        if (!host_pwm_period_get(0, total - count + i, &period)) {
+            return false;
+        }
+        p_red[i] = period.values[0];
+    }
+    return true;
+}
+
+static void check_counts(void)
+{
+    color_calib_t calib;
+    color_correct_default(&calib);
+    calib.gain[0] = COLOR_Q15_ONE * 9 / 10;
+    color_correct_set(&calib);
+
+    uint64_t worst_us = 0;
+    for (uint32_t i = 0; i < UPDATES; i++) {
+        uint16_t level = 101 + i * 3;
+        uint64_t latency_us = wait_live(pwm_set_rgb_values(level, level / 2, 0));
+        worst_us = latency_us > worst_us ? latency_us : worst_us;
+        test_run_us(1000 - latency_us % 1000);
+    }
+
+    uint16_t red[2 * PWM_DITHER_PERIODS];
+    pwm_set_rgb_values(333, 0, 0);
+    test_run_us(100000);
+    uint32_t varied = 0;
+    bool logged = last_red(red, 2 * PWM_DITHER_PERIODS);
+    for (uint32_t i = 1; i < 2 * PWM_DITHER_PERIODS; i++) {
+        varied += red[i] != red[0];
+    }
+    color_correct_default(&calib);
+    color_correct_set(&calib);
+
+    fprintf(stderr, "counts with gain 0.9: worst latency %llu us, red %u, %u periods differ\n",
+            (unsigned long long)worst_us, red[0], varied);
+    TEST_CHECK(worst_us <= 2 * PWM_TOP_VALUE + POLL_US);
+    TEST_CHECK(logged && varied == 0);
+    TEST_CHECK(red[0] == (333 * 9 + 5) / 10);
+}
+
+static void check_fraction(void)
+{
+    uint16_t duty16 = (uint16_t)((1001u * 65535u + 10u * PWM_TOP_VALUE) / (20u * PWM_TOP_VALUE));
+    uint16_t target = dither_from_duty16(duty16);
+
+    uint64_t latency_us = wait_live(pwm_set_rgb16(duty16, 0, 0));
+    test_run_us(100000);
+
+    uint16_t red[2 * PWM_DITHER_PERIODS];
+    uint32_t sum = 0;
+    bool logged = last_red(red, 2 * PWM_DITHER_PERIODS);
+    for (uint32_t i = 0; i < 2 * PWM_DITHER_PERIODS; i++) {
+        sum += red[i];
+    }
+
+    fprintf(stderr, "fraction %u/%u counts: latency %llu us, %u over two sequences\n",
+            target, DITHER_SCALE, (unsigned long long)latency_us, sum);
+    TEST_CHECK(target % DITHER_SCALE != 0);
+    TEST_CHECK(latency_us <= 2 * PWM_DITHER_PERIODS * PWM_TOP_VALUE + PWM_TOP_VALUE + POLL_US);
+    TEST_CHECK(logged && sum * DITHER_SCALE == 2u * PWM_DITHER_PERIODS * target);
+}
+
+int main(void)
+{
+    if (!host_time_is_virtual()) {
+        fprintf(stderr, "test_dither: needs HOST_VIRTUAL_TIME=1\n");
+        return 2;
+    }
+    pwm_leds_init();
+    TEST_CHECK(pwm_dither_enabled());
+    test_run_us(5000);
+
+    check_counts();
+    check_fraction();
+    return test_result("test_dither");
+}
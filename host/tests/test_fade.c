@@ -0,0 +1,150 @@
+/* Checks fade_plan() and fade_ramp_build() against a floating point model
+ * of the same rounding, then plays a 2 s fade on the host PWM model: the
+ * ramp only rises, ends exactly on the target after 2 s, and the CPU is
+ * interrupted no more than a few times while it plays. A plain set of the
+ * color a fade is heading for must then replace the fade. */
+#include <math.h>
+#include "host_test.h"
+#include "app_config.h"
+#include "fade.h"
+#include "isr_stats.h"
+#include "pwm_leds.h"
+
+#define FADE_MS      2000
+#define FADE_TARGET  800
+#define MAX_IRQS     2
+#define RESTAGE_TARGET 300
+
+static uint32_t m_seed = 5;
+
+static uint32_t rand_below(uint32_t n)
+{
+    m_seed = m_seed * 1103515245u + 12345u;
+    return (m_seed >> 8) % n;
+}
+
+/* from + (to - from) * i / steps, rounded half away from zero. */
+static uint16_t ramp_model(uint16_t from, uint16_t to, uint32_t i, uint16_t steps)
+{
+    double delta = ((double)to - from) * i / steps;
+    return (uint16_t)(from + (delta >= 0 ? floor(delta + 0.5) : -floor(-delta + 0.5)));
+}
+
+static void check_ramps(void)
+{
+    static nrf_pwm_values_individual_t ramp[PWM_FADE_MAX_STEPS];
+    uint32_t wrong = 0;
+
+    for (uint32_t n = 0; n < 20000; n++) {
+        uint16_t steps = 1 + rand_below(PWM_FADE_MAX_STEPS);
+        nrf_pwm_values_individual_t from = {
+            rand_below(PWM_TOP_VALUE + 1), rand_below(PWM_TOP_VALUE + 1),
+            rand_below(PWM_TOP_VALUE + 1), rand_below(PWM_TOP_VALUE + 1)
+        };
+        nrf_pwm_values_individual_t to = {
+            rand_below(PWM_TOP_VALUE + 1), rand_below(PWM_TOP_VALUE + 1),
+            rand_below(PWM_TOP_VALUE + 1), rand_below(PWM_TOP_VALUE + 1)
+        };
+
+        fade_ramp_build(ramp, &from, &to, steps);
+        for (uint32_t i = 1; i <= steps; i++) {
+            nrf_pwm_values_individual_t const *p_step = &ramp[i - 1];
+            wrong += p_step->channel_0 != ramp_model(from.channel_0, to.channel_0, i, steps);
+            wrong += p_step->channel_1 != ramp_model(from.channel_1, to.channel_1, i, steps);
+            wrong += p_step->channel_2 != ramp_model(from.channel_2, to.channel_2, i, steps);
+            wrong += p_step->channel_3 != ramp_model(from.channel_3, to.channel_3, i, steps);
+        }
+    }
+    fprintf(stderr, "fade ramps: %u wrong steps\n", wrong);
+    TEST_CHECK(wrong == 0);
+
+    /* The plan covers the fade to within half a step and fits the buffer. */
+    uint32_t off = 0;
+    for (uint32_t periods = 0; periods <= PWM_FADE_MAX_MS; periods++) {
+        uint16_t steps;
+        uint32_t repeats;
+        fade_plan(periods, PWM_FADE_MAX_STEPS, &steps, &repeats);
+        uint32_t total = steps * (repeats + 1);
+        uint32_t slack = (repeats + 1) / 2 + 1;
+        if (steps == 0 || steps > PWM_FADE_MAX_STEPS ||
+            (periods >= 2 && (total + slack < periods || total > periods + slack))) {
+            off++;
+        }
+    }
+    fprintf(stderr, "fade plans: %u off\n", off);
+    TEST_CHECK(off == 0);
+}
+
+static void check_playback(void)
+{
+    pwm_leds_init();
+    isr_stats_init();
+    test_run_us(5000);
+
+    uint32_t first = host_pwm_period_count(0);
+    isr_stats_reset();
+    pwm_fade_rgb(FADE_TARGET, 0, 0, FADE_MS);
+
+    uint32_t next = first;
+    uint32_t falls = 0;
+    uint16_t last = 0;
+    uint64_t reached_us = 0;
+    uint64_t start_us = host_time_us();
+    for (uint32_t chunk = 0; chunk < (FADE_MS + 500) / 100; chunk++) {
+        test_run_us(100000);
+        host_pwm_period_t period;
+        while (host_pwm_period_get(0, next, &period)) {
+            next++;
+            falls += period.values[0] < last;
+            last = period.values[0];
+            if (reached_us == 0 && last == FADE_TARGET) {
+                reached_us = period.start_us;
+            }
+        }
+        if (chunk == FADE_MS / 100 - 1) {
+            isr_stats_t stats;
+            isr_stats_get(ISR_STATS_PWM, &stats);
+            fprintf(stderr, "fade playback: %u PWM interrupts during %u ms\n", stats.count, FADE_MS);
+            TEST_CHECK(stats.count <= MAX_IRQS);
+        }
+    }
+
+    uint32_t took_ms = (uint32_t)((reached_us - start_us) / 1000);
+    fprintf(stderr, "fade playback: target after %u ms, %u falls\n", took_ms, falls);
+    TEST_CHECK(falls == 0);
+    TEST_CHECK(reached_us != 0);
+    TEST_CHECK(took_ms + 20 >= FADE_MS && took_ms <= FADE_MS + 20);
+}
+
+/* Restaging the staged color only dedupes with the same fade length: a
+ * plain set after a fade to the same color replaces the fade. */
+static void check_restage(void)
+{
+    uint32_t fade = pwm_fade_rgb(RESTAGE_TARGET, 0, 0, FADE_MS);
+    uint32_t again = pwm_fade_rgb(RESTAGE_TARGET, 0, 0, FADE_MS);
+    uint32_t set = pwm_set_rgb_values(RESTAGE_TARGET, 0, 0);
+    uint32_t set_again = pwm_set_rgb_values(RESTAGE_TARGET, 0, 0);
+    test_run_us(5000);
+
+    host_pwm_period_t period;
+    bool played = host_pwm_period_get(0, host_pwm_period_count(0) - 1, &period);
+    fprintf(stderr, "fade restage: fade %u, again %u, set %u, set again %u, live %u, red %u\n",
+            fade, again, set, set_again, pwm_rgb_live_update(), played ? period.values[0] : 0);
+    TEST_CHECK(again == fade);
+    TEST_CHECK(set != fade);
+    TEST_CHECK(set_again == set);
+    TEST_CHECK(pwm_rgb_is_live(set));
+    TEST_CHECK(played && period.values[0] == RESTAGE_TARGET);
+}
+
+int main(void)
+{
+    if (!host_time_is_virtual()) {
+        fprintf(stderr, "test_fade: needs HOST_VIRTUAL_TIME=1\n");
+        return 2;
+    }
+    check_ramps();
+    check_playback();
+    check_restage();
+    return test_result("test_fade");
+}
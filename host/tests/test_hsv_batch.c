@@ -0,0 +1,167 @@
+/* Checks hsv_to_rgb_batch() against hsv_to_rgb16() on every h 0..719, s
+ * and v, for the portable path of the library and for the DSP path, which
+ * is built here from src/hsv.c against C models of the CMSIS intrinsics it
+ * uses (the HSV_HUE_LUT build has no DSP path, so both are its table
+ * loop). Then times the library batch against a loop of hsv_to_rgb16() at
+ * 1, 16 and 256 colors a call and reports ns and, on x86, TSC cycles per
+ * color. */
+#include "host_test.h"
+#include "hsv.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define TEST_CYCLES() __rdtsc()
+#else
+#define TEST_CYCLES() 0
+#endif
+
+#define BENCH_COLORS 4000000u
+#define POOL_SIZE    4096u
+
+/* APSR.GE, one bit per byte as on the core. */
+static uint32_t m_ge;
+
+static inline uint32_t dsp_lanes(uint32_t a, uint32_t b, bool sub, bool sign)
+{
+    uint32_t out = 0;
+    m_ge = 0;
+    for (uint8_t k = 0; k < 2; k++) {
+        int32_t x = sign ? (int16_t)(a >> (16 * k)) : (int32_t)((a >> (16 * k)) & 0xFFFF);
+        int32_t y = sign ? (int16_t)(b >> (16 * k)) : (int32_t)((b >> (16 * k)) & 0xFFFF);
+        int32_t r = sub ? x - y : x + y;
+        bool ge = sign ? r >= 0 : (sub ? r >= 0 : r > 0xFFFF);
+        m_ge |= ge ? 3u << (2 * k) : 0;
+        out |= ((uint32_t)r & 0xFFFF) << (16 * k);
+    }
+    return out;
+}
+
+static inline uint32_t __UADD16(uint32_t a, uint32_t b) { return dsp_lanes(a, b, false, false); }
+static inline uint32_t __USUB16(uint32_t a, uint32_t b) { return dsp_lanes(a, b, true, false); }
+static inline uint32_t __SSUB16(uint32_t a, uint32_t b) { return dsp_lanes(a, b, true, true); }
+
+static inline uint32_t __SEL(uint32_t a, uint32_t b)
+{
+    uint32_t out = 0;
+    for (uint8_t k = 0; k < 4; k++) {
+        out |= (((m_ge >> k) & 1) ? a : b) & (0xFFu << (8 * k));
+    }
+    return out;
+}
+
+static inline uint32_t __USAT16(uint32_t a, uint32_t bits)
+{
+    uint32_t out = 0;
+    for (uint8_t k = 0; k < 2; k++) {
+        int32_t x = (int16_t)(a >> (16 * k));
+        int32_t top = (1 << bits) - 1;
+        x = x < 0 ? 0 : (x > top ? top : x);
+        out |= (uint32_t)x << (16 * k);
+    }
+    return out;
+}
+
+static inline int32_t __SMLAD(uint32_t a, uint32_t b, int32_t acc)
+{
+    return acc + (int16_t)a * (int16_t)b + (int16_t)(a >> 16) * (int16_t)(b >> 16);
+}
+
+#define __PKHBT(_a, _b, _shift) \
+    ((((uint32_t)(_a)) & 0x0000FFFFu) | ((((uint32_t)(_b)) << (_shift)) & 0xFFFF0000u))
+
+#define __ARM_FEATURE_DSP 1
+#define hsv_to_rgb_simple dsp_hsv_to_rgb_simple
+#define hsv_to_rgb16 dsp_hsv_to_rgb16
+#define hsv_to_rgb_batch dsp_hsv_to_rgb_batch
+#define hsv_chroma_init dsp_hsv_chroma_init
+#define hsv_chroma_apply dsp_hsv_chroma_apply
+#define rgb_to_hsv_simple dsp_rgb_to_hsv_simple
+#include "src/hsv.c"
+#undef hsv_to_rgb_simple
+#undef hsv_to_rgb16
+#undef hsv_to_rgb_batch
+#undef hsv_chroma_init
+#undef hsv_chroma_apply
+#undef rgb_to_hsv_simple
+#undef __ARM_FEATURE_DSP
+
+typedef void (*batch_fn_t)(const hsv_color_t *p_hsv, rgb16_t *p_rgb, size_t n);
+
+/* Converts every h, s, v in runs of 101 colors, which leaves an odd last
+ * color in each run. */
+static uint32_t mismatches(batch_fn_t batch)
+{
+    uint32_t count = 0;
+
+    for (uint16_t h = 0; h < 720; h++) {
+        for (uint8_t s = 0; s <= 100; s++) {
+            hsv_color_t in[101];
+            rgb16_t out[101];
+            for (uint8_t v = 0; v <= 100; v++) {
+                in[v] = (hsv_color_t){ .h = h, .s = s, .v = v };
+            }
+            batch(in, out, 101);
+            for (uint8_t v = 0; v <= 100; v++) {
+                rgb16_t full;
+                hsv_to_rgb16(h, s, v, &full.r, &full.g, &full.b);
+                count += memcmp(&out[v], &full, sizeof(full)) != 0;
+            }
+        }
+    }
+    return count;
+}
+
+static uint32_t m_seed = 23;
+
+static uint32_t rand_below(uint32_t n)
+{
+    m_seed = m_seed * 1103515245u + 12345u;
+    return (m_seed >> 8) % n;
+}
+
+static void scalar_loop(const hsv_color_t *p_hsv, rgb16_t *p_rgb, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        hsv_to_rgb16(p_hsv[i].h, p_hsv[i].s, p_hsv[i].v, &p_rgb[i].r, &p_rgb[i].g, &p_rgb[i].b);
+    }
+}
+
+static void bench(const char *p_name, batch_fn_t batch, uint32_t run,
+                  const hsv_color_t *p_pool, rgb16_t *p_out)
+{
+    uint32_t sink = 0;
+    uint64_t start_ns = test_wall_ns();
+    uint64_t start_cycles = TEST_CYCLES();
+    for (uint32_t done = 0; done < BENCH_COLORS; done += run) {
+        uint32_t at = done % POOL_SIZE;
+        batch(&p_pool[at], &p_out[at], run);
+        sink += p_out[at].r;
+    }
+    uint64_t cycles = TEST_CYCLES() - start_cycles;
+    double ns = (double)(test_wall_ns() - start_ns) / BENCH_COLORS;
+    fprintf(stderr, "hsv batch: %3u colors, %-6s %5.1f ns, %5.1f TSC cycles per color (%u)\n",
+            run, p_name, ns, (double)cycles / BENCH_COLORS, sink & 0xFF);
+}
+
+int main(void)
+{
+    uint32_t portable = mismatches(hsv_to_rgb_batch);
+    uint32_t dsp = mismatches(dsp_hsv_to_rgb_batch);
+    fprintf(stderr, "hsv batch: %u portable and %u DSP mismatches over 720x101x101\n",
+            portable, dsp);
+    TEST_CHECK(portable == 0);
+    TEST_CHECK(dsp == 0);
+
+    static hsv_color_t pool[POOL_SIZE];
+    static rgb16_t out[POOL_SIZE];
+    for (uint32_t i = 0; i < POOL_SIZE; i++) {
+        pool[i] = (hsv_color_t){ .h = rand_below(360), .s = rand_below(101), .v = rand_below(101) };
+    }
+    static uint32_t const runs[] = { 1, 16, 256 };
+    for (uint8_t i = 0; i < sizeof(runs) / sizeof(runs[0]); i++) {
+        bench("batch", hsv_to_rgb_batch, runs[i], pool, out);
+        bench("scalar", scalar_loop, runs[i], pool, out);
+    }
+
+    return test_result("test_hsv_batch");
+}
@@ -0,0 +1,102 @@
+/* Builds src/hsv.c a second time with HSV_HUE_LUT flipped and compares the
+ * two HSV -> RGB paths on every h 0..719, s and v: hsv_to_rgb_simple() must
+ * agree within one PWM count and hsv_to_rgb16(), hsv_to_rgb_batch() and
+ * the chroma cache within one LSB of 16 bits. The library holds the
+ * path of the build, so either setting covers both. */
+#include "host_test.h"
+#include "hsv.h"
+
+#if HSV_HUE_LUT
+#define TEST_OTHER_LUT 0
+#else
+#define TEST_OTHER_LUT 1
+#endif
+
+#undef HSV_HUE_LUT
+#define HSV_HUE_LUT TEST_OTHER_LUT
+#define hsv_to_rgb_simple other_hsv_to_rgb_simple
+#define hsv_to_rgb16 other_hsv_to_rgb16
+#define hsv_to_rgb_batch other_hsv_to_rgb_batch
+#define hsv_chroma_init other_hsv_chroma_init
+#define hsv_chroma_apply other_hsv_chroma_apply
+#define rgb_to_hsv_simple other_rgb_to_hsv_simple
+#include "src/hsv.c"
+#undef hsv_to_rgb_simple
+#undef hsv_to_rgb16
+#undef hsv_to_rgb_batch
+#undef hsv_chroma_init
+#undef hsv_chroma_apply
+#undef rgb_to_hsv_simple
+
+static uint32_t diff(uint16_t a, uint16_t b)
+{
+    return a > b ? a - b : b - a;
+}
+
+static uint32_t worst(uint16_t const a[3], uint16_t const b[3])
+{
+    return MAX(diff(a[0], b[0]), MAX(diff(a[1], b[1]), diff(a[2], b[2])));
+}
+
+static uint32_t worst16(rgb16_t const *p_a, rgb16_t const *p_b)
+{
+    return MAX(diff(p_a->r, p_b->r), MAX(diff(p_a->g, p_b->g), diff(p_a->b, p_b->b)));
+}
+
+int main(void)
+{
+    uint32_t worst_counts = 0;
+    uint32_t worst_lsb = 0;
+    uint32_t worst_batch = 0;
+    uint32_t worst_chroma = 0;
+    uint32_t differ = 0;
+
+    for (uint16_t h = 0; h < 720; h++) {
+        for (uint8_t s = 0; s <= 100; s++) {
+            hsv_color_t in[101];
+            rgb16_t batch[101];
+            rgb16_t other_batch[101];
+            hsv_chroma_t chroma;
+            hsv_chroma_t other_chroma;
+            hsv_chroma_init(&chroma, h, s);
+            other_hsv_chroma_init(&other_chroma, h, s);
+
+            for (uint8_t v = 0; v <= 100; v++) {
+                uint16_t a[3], b[3];
+                hsv_to_rgb_simple(h, s, v, &a[0], &a[1], &a[2]);
+                other_hsv_to_rgb_simple(h, s, v, &b[0], &b[1], &b[2]);
+                worst_counts = MAX(worst_counts, worst(a, b));
+                differ += worst(a, b) != 0;
+
+                hsv_to_rgb16(h, s, v, &a[0], &a[1], &a[2]);
+                other_hsv_to_rgb16(h, s, v, &b[0], &b[1], &b[2]);
+                worst_lsb = MAX(worst_lsb, worst(a, b));
+
+                rgb16_t cached;
+                rgb16_t other_cached;
+                hsv_chroma_apply(&chroma, v, &cached);
+                other_hsv_chroma_apply(&other_chroma, v, &other_cached);
+                worst_chroma = MAX(worst_chroma, worst16(&cached, &other_cached));
+
+                in[v] = (hsv_color_t){ .h = h, .s = s, .v = v };
+            }
+
+            hsv_to_rgb_batch(in, batch, 101);
+            other_hsv_to_rgb_batch(in, other_batch, 101);
+            for (uint8_t v = 0; v <= 100; v++) {
+                worst_batch = MAX(worst_batch, worst16(&batch[v], &other_batch[v]));
+            }
+        }
+    }
+
+    fprintf(stderr, "hsv lut: %s build against %s, worst %u count (%u of %u colors differ), "
+            "%u LSB, batch %u LSB, chroma %u LSB\n",
+            TEST_OTHER_LUT ? "arithmetic" : "table", TEST_OTHER_LUT ? "table" : "arithmetic",
+            worst_counts, differ, 720u * 101 * 101, worst_lsb, worst_batch, worst_chroma);
+    TEST_CHECK(worst_counts <= 1);
+    TEST_CHECK(worst_lsb <= 1);
+    TEST_CHECK(worst_batch <= 1);
+    TEST_CHECK(worst_chroma <= 1);
+
+    return test_result("test_hsv_lut");
+}
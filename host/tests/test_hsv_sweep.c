@@ -0,0 +1,306 @@
+/* Sweeps the HSV<->RGB conversions on every core over all 360x101x101 HSV
+ * inputs and all 1001^3 RGB inputs. Each result is compared with the exact
+ * real valued conversion, and so is the result of the conversions as they
+ * were before the fixed-point rewrite, kept below as ref_*(). Checks the
+ * bounds hsv.h promises for the build's HSV_HUE_LUT and reports max and
+ * mean error, the largest old-vs-new difference and ns per conversion for
+ * both. */
+#include <math.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "host_test.h"
+#include "app_config.h"
+#include "hsv.h"
+
+#define MAX_THREADS  64
+#define BOUND        (0.5 + 1e-9)
+
+/* The hue ramp table rounds to 16 bits before the final rounding, see
+ * hsv.h, so the LUT build only promises one count. */
+#if HSV_HUE_LUT
+#define RGB_BOUND    (1.0 + 1e-9)
+#else
+#define RGB_BOUND    BOUND
+#endif
+
+typedef struct {
+    double max;
+    double sum;
+} conv_error_t;
+
+/* Errors of the current ([0]) and the old ([1]) conversions, and the
+ * largest difference between them. */
+typedef struct {
+    uint32_t first;
+    uint32_t step;
+    conv_error_t rgb[2];
+    uint32_t rgb_diff;
+    uint64_t n_rgb;
+    conv_error_t hsv[2][3];
+    uint32_t hsv_diff[3];
+    uint64_t n_hsv;
+} sweep_t;
+
+static void ref_hsv_to_rgb(uint16_t h, uint8_t s, uint8_t v, uint16_t *r, uint16_t *g, uint16_t *b)
+{
+    h = h % 360;
+
+    if (s == 0) {
+        *r = *g = *b = (v * PWM_TOP_VALUE) / 100;
+        return;
+    }
+
+    uint8_t sector = h / 60;
+    uint16_t remainder = (h % 60) * 6;
+
+    uint32_t p = ((uint32_t)v * (100 - s)) / 100;
+    uint32_t q = ((uint32_t)v * (100 - ((s * remainder) / 360))) / 100;
+    uint32_t t = ((uint32_t)v * (100 - ((s * (360 - remainder)) / 360))) / 100;
+
+    uint16_t v_pwm = (v * PWM_TOP_VALUE) / 100;
+    uint16_t p_pwm = (p * PWM_TOP_VALUE) / 100;
+    uint16_t q_pwm = (q * PWM_TOP_VALUE) / 100;
+    uint16_t t_pwm = (t * PWM_TOP_VALUE) / 100;
+
+    switch (sector) {
+        case 0:
+            *r = v_pwm; *g = t_pwm; *b = p_pwm;
+            break;
+        case 1:
+            *r = q_pwm; *g = v_pwm; *b = p_pwm;
+            break;
+        case 2:
+            *r = p_pwm; *g = v_pwm; *b = t_pwm;
+            break;
+        case 3:
+            *r = p_pwm; *g = q_pwm; *b = v_pwm;
+            break;
+        case 4:
+            *r = t_pwm; *g = p_pwm; *b = v_pwm;
+            break;
+        default:
+            *r = v_pwm; *g = p_pwm; *b = q_pwm;
+            break;
+    }
+}
+
+static void ref_rgb_to_hsv(uint16_t r, uint16_t g, uint16_t b, uint16_t *h, uint8_t *s, uint8_t *v)
+{
+    if (r > PWM_TOP_VALUE) r = PWM_TOP_VALUE;
+    if (g > PWM_TOP_VALUE) g = PWM_TOP_VALUE;
+    if (b > PWM_TOP_VALUE) b = PWM_TOP_VALUE;
+
+    uint32_t max_val = MAX(r, MAX(g, b));
+    uint32_t min_val = MIN(r, MIN(g, b));
+    uint32_t delta = max_val - min_val;
+
+    *v = max_val / 10;
+    *s = max_val == 0 ? 0 : (delta * 100) / max_val;
+
+    if (delta == 0) {
+        *h = 0;
+    } else {
+        int32_t hue_temp;
+        if (max_val == r) {
+            hue_temp = ((int32_t)(g - b) * 60) / (int32_t)delta;
+            if (g < b) hue_temp += 360;
+        } else if (max_val == g) {
+            hue_temp = ((int32_t)(b - r) * 60) / (int32_t)delta + 120;
+        } else {
+            hue_temp = ((int32_t)(r - g) * 60) / (int32_t)delta + 240;
+        }
+
+        if (hue_temp < 0) hue_temp += 360;
+        if (hue_temp >= 360) hue_temp -= 360;
+
+        *h = (uint16_t)hue_temp;
+    }
+}
+
+static void exact_rgb(uint16_t h, uint8_t s, uint8_t v, double out[3])
+{
+    double c = v / 100.0 * s / 100.0 * PWM_TOP_VALUE;
+    double m = v / 100.0 * PWM_TOP_VALUE - c;
+    double hh = (h % 360) / 60.0;
+    double x = c * (1 - fabs(fmod(hh, 2) - 1));
+    static uint8_t const order[6][3] = {
+        { 0, 1, 2 }, { 1, 0, 2 }, { 2, 0, 1 }, { 2, 1, 0 }, { 1, 2, 0 }, { 0, 2, 1 }
+    };
+    double level[3] = { c, x, 0 };
+    for (uint8_t i = 0; i < 3; i++) {
+        out[i] = level[order[(int)hh][i]] + m;
+    }
+}
+
+static void exact_hsv(uint16_t r, uint16_t g, uint16_t b, double out[3])
+{
+    double max = r > g ? (r > b ? r : b) : (g > b ? g : b);
+    double min = r < g ? (r < b ? r : b) : (g < b ? g : b);
+    double delta = max - min;
+    double h = 0;
+    if (delta > 0) {
+        if (max == r) {
+            h = fmod((g - b) / delta + 6, 6);
+        } else if (max == g) {
+            h = (b - r) / delta + 2;
+        } else {
+            h = (r - g) / delta + 4;
+        }
+    }
+    out[0] = h * 60;
+    out[1] = max > 0 ? delta / max * 100 : 0;
+    out[2] = max / PWM_TOP_VALUE * 100;
+}
+
+static void add_error(conv_error_t *p_error, double error)
+{
+    p_error->max = error > p_error->max ? error : p_error->max;
+    p_error->sum += error;
+}
+
+static uint32_t diff(uint32_t a, uint32_t b)
+{
+    return a > b ? a - b : b - a;
+}
+
+/* Hue error in degrees, around the circle and zero for grays. */
+static double hue_error(uint16_t h, double const exact[3])
+{
+    double error = fabs(h - exact[0]);
+    error = error > 180 ? 360 - error : error;
+    return exact[1] == 0 ? 0 : error;
+}
+
+static void *sweep(void *p_arg)
+{
+    sweep_t *p = p_arg;
+
+    for (uint32_t i = p->first; i < 360u * 101u * 101u; i += p->step) {
+        uint16_t h = i / (101 * 101);
+        uint8_t s = (i / 101) % 101;
+        uint8_t v = i % 101;
+        uint16_t rgb[2][3];
+        double exact[3];
+        hsv_to_rgb_simple(h, s, v, &rgb[0][0], &rgb[0][1], &rgb[0][2]);
+        ref_hsv_to_rgb(h, s, v, &rgb[1][0], &rgb[1][1], &rgb[1][2]);
+        exact_rgb(h, s, v, exact);
+        for (uint8_t c = 0; c < 3; c++) {
+            for (uint8_t k = 0; k < 2; k++) {
+                add_error(&p->rgb[k], fabs(rgb[k][c] - exact[c]));
+            }
+            p->rgb_diff = MAX(p->rgb_diff, diff(rgb[0][c], rgb[1][c]));
+        }
+        p->n_rgb += 3;
+    }
+
+    for (uint32_t r = p->first; r <= PWM_TOP_VALUE; r += p->step) {
+        for (uint32_t g = 0; g <= PWM_TOP_VALUE; g++) {
+            for (uint32_t b = 0; b <= PWM_TOP_VALUE; b++) {
+                uint16_t h[2];
+                uint8_t s[2], v[2];
+                double exact[3];
+                rgb_to_hsv_simple(r, g, b, &h[0], &s[0], &v[0]);
+                ref_rgb_to_hsv(r, g, b, &h[1], &s[1], &v[1]);
+                exact_hsv(r, g, b, exact);
+                for (uint8_t k = 0; k < 2; k++) {
+                    add_error(&p->hsv[k][0], hue_error(h[k], exact));
+                    add_error(&p->hsv[k][1], fabs(s[k] - exact[1]));
+                    add_error(&p->hsv[k][2], fabs(v[k] - exact[2]));
+                }
+                uint32_t h_diff = diff(h[0], h[1]);
+                h_diff = exact[1] == 0 ? 0 : MIN(h_diff, 360 - h_diff);
+                p->hsv_diff[0] = MAX(p->hsv_diff[0], h_diff);
+                p->hsv_diff[1] = MAX(p->hsv_diff[1], diff(s[0], s[1]));
+                p->hsv_diff[2] = MAX(p->hsv_diff[2], diff(v[0], v[1]));
+                p->n_hsv++;
+            }
+        }
+    }
+    return NULL;
+}
+
+/* Single threaded, so the figure is per core. */
+static double ns_per(bool to_rgb, bool old)
+{
+    volatile uint32_t sink = 0;
+    uint64_t start_ns = test_wall_ns();
+    uint32_t n = 0;
+    for (uint32_t i = 0; i < 4000000u; i++, n++) {
+        uint16_t a, b, c;
+        if (to_rgb) {
+            (old ? ref_hsv_to_rgb : hsv_to_rgb_simple)(i % 360, (i >> 3) % 101, (i >> 5) % 101,
+                                                       &a, &b, &c);
+            sink += a + b + c;
+        } else {
+            uint8_t s, v;
+            (old ? ref_rgb_to_hsv : rgb_to_hsv_simple)(i % 1001, (i >> 2) % 1001, (i >> 9) % 1001,
+                                                       &a, &s, &v);
+            sink += a + s + v;
+        }
+    }
+    (void)sink;
+    return (double)(test_wall_ns() - start_ns) / n;
+}
+
+static void merge(conv_error_t *p_total, conv_error_t const *p_part)
+{
+    p_total->max = fmax(p_total->max, p_part->max);
+    p_total->sum += p_part->sum;
+}
+
+int main(void)
+{
+    static sweep_t sweeps[MAX_THREADS];
+    static pthread_t threads[MAX_THREADS];
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    uint32_t count = cores < 1 ? 1 : (cores > MAX_THREADS ? MAX_THREADS : (uint32_t)cores);
+
+    for (uint32_t t = 0; t < count; t++) {
+        sweeps[t] = (sweep_t){ .first = t, .step = count };
+        pthread_create(&threads[t], NULL, sweep, &sweeps[t]);
+    }
+    sweep_t total = { 0 };
+    for (uint32_t t = 0; t < count; t++) {
+        pthread_join(threads[t], NULL);
+        for (uint8_t k = 0; k < 2; k++) {
+            merge(&total.rgb[k], &sweeps[t].rgb[k]);
+            for (uint8_t c = 0; c < 3; c++) {
+                merge(&total.hsv[k][c], &sweeps[t].hsv[k][c]);
+            }
+        }
+        total.rgb_diff = MAX(total.rgb_diff, sweeps[t].rgb_diff);
+        for (uint8_t c = 0; c < 3; c++) {
+            total.hsv_diff[c] = MAX(total.hsv_diff[c], sweeps[t].hsv_diff[c]);
+        }
+        total.n_rgb += sweeps[t].n_rgb;
+        total.n_hsv += sweeps[t].n_hsv;
+    }
+
+    static char const *const p_names[2] = { "new", "old" };
+    fprintf(stderr, "HSV->RGB, %llu channels:\n", (unsigned long long)total.n_rgb);
+    for (uint8_t k = 0; k < 2; k++) {
+        fprintf(stderr, "  %s: max %.3f, mean %.3f counts, %.1f ns\n", p_names[k],
+                total.rgb[k].max, total.rgb[k].sum / total.n_rgb, ns_per(true, k == 1));
+    }
+    fprintf(stderr, "  new vs old: at most %u counts apart\n", total.rgb_diff);
+    fprintf(stderr, "RGB->HSV, %llu colors:\n", (unsigned long long)total.n_hsv);
+    for (uint8_t k = 0; k < 2; k++) {
+        fprintf(stderr, "  %s: max %.3f deg %.3f %% %.3f %%, mean %.3f %.3f %.3f, %.1f ns\n",
+                p_names[k], total.hsv[k][0].max, total.hsv[k][1].max, total.hsv[k][2].max,
+                total.hsv[k][0].sum / total.n_hsv, total.hsv[k][1].sum / total.n_hsv,
+                total.hsv[k][2].sum / total.n_hsv, ns_per(false, k == 1));
+    }
+    fprintf(stderr, "  new vs old: at most %u deg %u %% %u %% apart\n",
+            total.hsv_diff[0], total.hsv_diff[1], total.hsv_diff[2]);
+    fprintf(stderr, "%u threads\n", count);
+
+    TEST_CHECK(total.n_rgb == 3ull * 360 * 101 * 101);
+    TEST_CHECK(total.n_hsv == 1001ull * 1001 * 1001);
+    TEST_CHECK(total.rgb[0].max <= RGB_BOUND);
+    TEST_CHECK(total.rgb[0].max <= total.rgb[1].max);
+    for (uint8_t c = 0; c < 3; c++) {
+        TEST_CHECK(total.hsv[0][c].max <= BOUND);
+        TEST_CHECK(total.hsv[0][c].max <= total.hsv[1][c].max);
+    }
+    return test_result("test_hsv_sweep");
+}
@@ -0,0 +1,37 @@
+/* Runs the firmware for one hour of virtual time in MODE_NO_INPUT with the
+ * terminal open and idle, and counts how often the loop woke up. Nothing is
+ * due in that state, so the only wake-ups left are the RTC1 overflow every
+ * 512 s and a few while booting. */
+#include "host_test.h"
+#include "host_hal.h"
+
+#define main app_main
+#include "main.c"
+#undef main
+
+#define RUN_US        (3600ull * 1000000u)
+#define BOOT_WAKEUPS  8
+#define MAX_WAKEUPS   (BOOT_WAKEUPS + 3600 / 512 + 1)
+
+static void check(void)
+{
+    uint32_t wakeups = host_wfe_count();
+
+    fprintf(stderr, "idle hour: %u wake-ups, mode %d\n", wakeups, current_mode);
+    TEST_CHECK(current_mode == MODE_NO_INPUT);
+    TEST_CHECK(wakeups <= MAX_WAKEUPS);
+    _exit(test_result("test_idle_wakeups"));
+}
+
+int main(void)
+{
+    if (!host_time_is_virtual()) {
+        fprintf(stderr, "test_idle_wakeups: needs HOST_VIRTUAL_TIME=1\n");
+        return 2;
+    }
+    test_terminal_idle();
+    test_terminal_capture();
+    host_time_set_limit(RUN_US);
+    atexit(check);
+    return app_main();
+}
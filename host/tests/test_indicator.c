@@ -0,0 +1,121 @@
+/* Plays each LD1 pattern on the host PWM model and measures it from the
+ * period log: blink halves last MODE_BLINK_SLOW_MS or MODE_BLINK_FAST_MS to
+ * within one dither sequence and do not drift over many cycles, breathing
+ * repeats every MODE_BREATHE_MS, and solid and off hold still without any
+ * PWM interrupts. One period is 1 ms. */
+#include "host_test.h"
+#include "app_config.h"
+#include "isr_stats.h"
+#include "pwm_leds.h"
+
+#define PERIOD_US   (PWM_TOP_VALUE)
+#define RUN_PERIODS 20000
+
+static uint16_t m_ld1[RUN_PERIODS];
+
+/* Plays a pattern from a settled start and records LD1 of each period. */
+static void record(pwm_indicator_pattern_t pattern)
+{
+    pwm_indicator_set_pattern(PWM_INDICATOR_OFF);
+    test_run_us(100000);
+    pwm_indicator_set_pattern(pattern);
+
+    uint32_t next = host_pwm_period_count(0);
+    uint32_t count = 0;
+    while (count < RUN_PERIODS) {
+        test_run_us(100000);
+        host_pwm_period_t period;
+        while (count < RUN_PERIODS && host_pwm_period_get(0, next, &period)) {
+            next++;
+            m_ld1[count++] = period.values[3];
+        }
+    }
+}
+
+static void check_blink(pwm_indicator_pattern_t pattern, uint32_t half_ms)
+{
+    static uint32_t starts[RUN_PERIODS];
+    uint32_t runs = 0;
+    uint32_t off = 0;
+
+    record(pattern);
+    /* Run boundaries after the first run, which starts from the switch. */
+    for (uint32_t i = 1; i < RUN_PERIODS; i++) {
+        if (m_ld1[i] != m_ld1[i - 1]) {
+            starts[runs++] = i;
+        }
+    }
+    for (uint32_t r = 0; r + 1 < runs; r++) {
+        uint32_t len = starts[r + 1] - starts[r];
+        uint16_t level = m_ld1[starts[r]];
+        if ((level != 0 && level != PWM_TOP_VALUE) ||
+            len + PWM_DITHER_PERIODS < half_ms || len > half_ms + PWM_DITHER_PERIODS) {
+            off++;
+        }
+    }
+
+    /* Over whole cycles the rounding to sequences cancels out. */
+    uint32_t cycles = (runs - 1) / 2;
+    int32_t drift = (int32_t)(starts[cycles * 2] - starts[0]) - (int32_t)(cycles * 2 * half_ms);
+    fprintf(stderr, "blink %u ms: %u runs, %u off, drift %d periods\n", half_ms, runs, off, drift);
+    TEST_CHECK(runs + 2 >= RUN_PERIODS / half_ms);
+    TEST_CHECK(off == 0);
+    TEST_CHECK(drift >= -PWM_DITHER_PERIODS && drift <= PWM_DITHER_PERIODS);
+}
+
+static void check_breathing(void)
+{
+    uint16_t low = UINT16_MAX;
+    uint16_t high = 0;
+    uint32_t differ = 0;
+
+    record(PWM_INDICATOR_BREATHING);
+    for (uint32_t i = MODE_BREATHE_MS; i < RUN_PERIODS; i++) {
+        low = m_ld1[i] < low ? m_ld1[i] : low;
+        high = m_ld1[i] > high ? m_ld1[i] : high;
+        differ += m_ld1[i] != m_ld1[i - MODE_BREATHE_MS];
+    }
+    fprintf(stderr, "breathing: %u..%u, %u periods differ from one cycle before\n", low, high, differ);
+    TEST_CHECK(low < PWM_TOP_VALUE / 10 && high > PWM_TOP_VALUE * 9 / 10);
+    TEST_CHECK(differ == 0);
+}
+
+static void check_still(pwm_indicator_pattern_t pattern, uint16_t level)
+{
+    uint32_t moved = 0;
+
+    record(pattern);
+    isr_stats_reset();
+    test_run_us(RUN_PERIODS * PERIOD_US / 4);
+    isr_stats_t stats;
+    isr_stats_get(ISR_STATS_PWM, &stats);
+
+    for (uint32_t i = RUN_PERIODS / 2; i < RUN_PERIODS; i++) {
+        moved += m_ld1[i] != level;
+    }
+    fprintf(stderr, "still %u: %u periods off level, %u PWM interrupts\n", level, moved, stats.count);
+    TEST_CHECK(moved == 0);
+    TEST_CHECK(stats.count == 0);
+}
+
+int main(void)
+{
+    if (!host_time_is_virtual()) {
+        fprintf(stderr, "test_indicator: needs HOST_VIRTUAL_TIME=1\n");
+        return 2;
+    }
+    pwm_leds_init();
+    isr_stats_init();
+    /* Some red keeps the PWM running when LD1 is off. */
+    pwm_set_rgb_values(PWM_TOP_VALUE / 4, 0, 0);
+
+    for (uint8_t dither = 0; dither < 2; dither++) {
+        pwm_set_dither(dither);
+        check_blink(PWM_INDICATOR_SLOW_BLINK, MODE_BLINK_SLOW_MS);
+        check_blink(PWM_INDICATOR_FAST_BLINK, MODE_BLINK_FAST_MS);
+        check_breathing();
+        check_still(PWM_INDICATOR_SOLID, PWM_TOP_VALUE);
+        check_still(PWM_INDICATOR_OFF, 0);
+    }
+    return test_result("test_indicator");
+}
@@ -0,0 +1,44 @@
+/* Boots the firmware, turns LD2 off from the terminal and lets it sit in
+ * MODE_NO_INPUT for a minute of virtual time. With every LED dark PWM0 must
+ * have stopped, so its on-time stays at the boot flash, and nothing may
+ * still hold the HFCLK request. */
+#include "host_test.h"
+#include "host_hal.h"
+
+#define main app_main
+#include "main.c"
+#undef main
+
+#define RUN_US          (60ull * 1000000u)
+#define MAX_ON_TIME_US  (400u * 1000u)
+
+static void check(void)
+{
+    uint64_t on_us = host_pwm_on_time_us(0);
+    uint32_t hfclk = host_hfclk_request_count();
+
+    fprintf(stderr, "dark minute: PWM0 on for %llu ms, %u HFCLK requests held\n",
+            (unsigned long long)(on_us / 1000), hfclk);
+    TEST_CHECK(on_us <= MAX_ON_TIME_US);
+    TEST_CHECK(hfclk == 0);
+    _exit(test_result("test_led_power"));
+}
+
+int main(void)
+{
+    if (!host_time_is_virtual()) {
+        fprintf(stderr, "test_led_power: needs HOST_VIRTUAL_TIME=1\n");
+        return 2;
+    }
+    int fds[2];
+    static char const command[] = "RGB 0 0 0\r";
+    if (pipe(fds) != 0 || write(fds[1], command, sizeof(command) - 1) != sizeof(command) - 1) {
+        perror("pipe");
+        return 2;
+    }
+    dup2(fds[0], STDIN_FILENO);
+    test_terminal_capture();
+    host_time_set_limit(RUN_US);
+    atexit(check);
+    return app_main();
+}
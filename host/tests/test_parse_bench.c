@@ -0,0 +1,91 @@
+/* Parser benchmark: a million commands through the CLI in quiet mode. The
+ * mix has valid commands, unknown names, missing arguments and values out
+ * of range, so lookup, tokenizing and argument checks all get exercised;
+ * every command must get the status it deserves. */
+#include "host_test.h"
+#include "host_hal.h"
+
+#define main app_main
+#include "main.c"
+#undef main
+
+#define COMMANDS 1000000u
+
+static const struct {
+    const char *p_line;
+    const char *p_status;
+} m_mix[] = {
+    { "RGB 12 345 678\r",       "OK\r\n" },
+    { "hsv 200 50 75\r",        "OK\r\n" },
+    { "frobnicate 1 2\r",       "ERR 1\r\n" },
+    { "RGB 1 2\r",              "ERR 2\r\n" },
+    { "HSV 400 10 10\r",        "ERR 2\r\n" },
+    { "RGB 1;RGB 2 3 4\r",      "ERR 2\r\nOK\r\n" },
+    { "  rgb   7   8   9  \r",  "OK\r\n" },
+    { "list_colors\r",          NULL },
+};
+#define MIX_LEN (sizeof(m_mix) / sizeof(m_mix[0]))
+
+static size_t m_script_len;
+static uint64_t m_start_ns;
+
+static void check(void)
+{
+    uint64_t elapsed_ns = test_wall_ns() - m_start_ns;
+    size_t len;
+    char *p_out = test_terminal_output(&len);
+
+    /* Skip the banner and the reply to "quiet 1". */
+    char *p = strstr(p_out, "OK\r\n");
+    uint32_t mismatches = 0;
+    uint32_t checked = 0;
+    p = (p != NULL) ? p + 4 : p_out + len;
+    for (uint32_t i = 0; i < COMMANDS && p < p_out + len; i++) {
+        const char *p_status = m_mix[i % MIX_LEN].p_status;
+        if (p_status == NULL) {
+            /* list_colors prints a listing, then its status. */
+            char *p_ok = strstr(p, "OK\r\n");
+            p = (p_ok != NULL) ? p_ok + 4 : p_out + len;
+            continue;
+        }
+        size_t n = strlen(p_status);
+        mismatches += (strncmp(p, p_status, n) != 0);
+        p += n;
+        checked++;
+    }
+    char *p_stats = strstr(p, "TX peak");
+    unsigned peak = 0, size = 0, dropped = 1, truncated = 1;
+    if (p_stats != NULL) {
+        sscanf(p_stats, "TX peak %u/%u dropped %u truncated %u", &peak, &size, &dropped, &truncated);
+    }
+
+    fprintf(stderr, "parse: %u commands, %zu bytes in %.1f ms, %.0f ns/command, %u mismatched\n",
+            COMMANDS, m_script_len, elapsed_ns / 1e6, (double)elapsed_ns / COMMANDS, mismatches);
+    TEST_CHECK(checked == COMMANDS - COMMANDS / MIX_LEN);
+    TEST_CHECK(mismatches == 0);
+    TEST_CHECK(p_stats != NULL && dropped == 0 && truncated == 0);
+    free(p_out);
+    _exit(test_result("test_parse_bench"));
+}
+
+int main(void)
+{
+    size_t cap = 64 + COMMANDS * 24;
+    char *p_script = malloc(cap);
+
+    m_script_len = (size_t)sprintf(p_script, "quiet 1\r");
+    for (uint32_t i = 0; i < COMMANDS; i++) {
+        const char *p_line = m_mix[i % MIX_LEN].p_line;
+        size_t n = strlen(p_line);
+        memcpy(p_script + m_script_len, p_line, n);
+        m_script_len += n;
+    }
+    m_script_len += (size_t)sprintf(p_script + m_script_len, "usb_stats\r");
+
+    test_terminal_script(p_script, m_script_len);
+    free(p_script);
+    test_terminal_capture();
+    atexit(check);
+    m_start_ns = test_wall_ns();
+    return app_main();
+}
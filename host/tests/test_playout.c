@@ -0,0 +1,60 @@
+/* Plays timestamped frames from a sender whose clock runs 500 ppm fast or
+ * slow against the device, with up to 20 ms of random send jitter. Over two
+ * minutes that adds up to 60 ms, as much as the whole jitter latency, so
+ * without drift tracking frames would pile up in the buffer or arrive late.
+ * The device time is stepped by hand; no firmware loop runs. */
+#include "host_test.h"
+#include "app_config.h"
+#include "playout.h"
+#include "pwm_leds.h"
+
+#define RUN_MS      120000u
+#define FRAME_MS    10u
+#define JITTER_MS   20u
+
+static void run(int32_t ppm)
+{
+    playout_stats_t stats;
+    uint32_t seed = 7;
+    uint32_t frame = 0;
+    uint32_t next_arrival = 0;
+
+    playout_start();
+    playout_stats_reset();
+    for (uint32_t now = 0; now < RUN_MS; now++) {
+        while (next_arrival <= now) {
+            uint32_t pts = frame * FRAME_MS;
+            uint16_t rgb[3] = { (uint16_t)(frame % 1000), 0, 0 };
+            playout_push(pts, rgb, now);
+            frame++;
+            /* Sent at pts on the sender's clock, which is pts * (1 - ppm)
+             * on the device's, plus the jitter. */
+            seed = seed * 1103515245u + 12345u;
+            uint64_t send = (uint64_t)frame * FRAME_MS * (1000000 - ppm) / 1000000;
+            next_arrival = (uint32_t)send + (seed >> 16) % JITTER_MS;
+        }
+        playout_process(now);
+    }
+    playout_stats_get(&stats);
+
+    int32_t expected = -(int32_t)((int64_t)RUN_MS * ppm / 1000000);
+    fprintf(stderr, "%+d ppm: played=%u late=%u underruns=%u overflows=%u drift=%d ms (clocks %d ms)\n",
+            ppm, stats.played, stats.late, stats.underruns, stats.overflows, stats.drift_ms, expected);
+    TEST_CHECK(stats.late == 0);
+    TEST_CHECK(stats.overflows == 0);
+    /* The rest is still queued for the latency. */
+    TEST_CHECK(frame - stats.played <= (STREAM_JITTER_LATENCY_MS + JITTER_MS) / FRAME_MS);
+    TEST_CHECK(stats.drift_ms >= expected - 3 && stats.drift_ms <= expected + 3);
+
+    uint16_t last[3];
+    TEST_CHECK(playout_stop(last));
+}
+
+int main(void)
+{
+    pwm_leds_init();
+    run(0);
+    run(500);
+    run(-500);
+    return test_result("test_playout");
+}
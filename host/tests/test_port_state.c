@@ -0,0 +1,115 @@
+/* Drives the CLI through the terminal states the CDC port reports. Output
+ * queued while the bus is suspended must wait, even past the stall
+ * timeout, and all go out on resume. Closing the port discards what is
+ * still queued and counts it. Input typed while the port is closed is held
+ * back by the endpoint and runs once the port opens again. */
+#include "host_test.h"
+#include "host_hal.h"
+#include "pwm_leds.h"
+#include "timebase.h"
+#include "usb_cli.h"
+
+static int m_input;
+
+static void type(const char *p_text)
+{
+    if (write(m_input, p_text, strlen(p_text)) != (ssize_t)strlen(p_text)) {
+        perror("write");
+        exit(2);
+    }
+}
+
+/* Loop passes one millisecond apart. */
+static void run_ms(uint32_t ms)
+{
+    for (uint32_t i = 0; i < ms; i++) {
+        cli_process();
+        test_run_us(1000);
+    }
+}
+
+/* Output sent to the host from offset on, NUL terminated; caller frees. */
+static char *output_since(size_t offset)
+{
+    size_t len;
+    char *p_text = test_terminal_output(&len);
+    memmove(p_text, p_text + (offset < len ? offset : len), len - (offset < len ? offset : len) + 1);
+    return p_text;
+}
+
+static size_t output_len(void)
+{
+    size_t len;
+    free(test_terminal_output(&len));
+    return len;
+}
+
+int main(void)
+{
+    if (!host_time_is_virtual()) {
+        fprintf(stderr, "test_port_state: needs HOST_VIRTUAL_TIME=1\n");
+        return 2;
+    }
+    int fds[2];
+    if (pipe(fds) != 0) {
+        perror("pipe");
+        return 2;
+    }
+    dup2(fds[0], STDIN_FILENO);
+    m_input = fds[1];
+    test_terminal_capture();
+
+    timebase_init();
+    pwm_leds_init();
+    cli_init();
+    type("\r");
+    run_ms(10);
+
+    /* Suspended: help is queued and waits past the stall timeout. */
+    host_usbd_set_suspended(true);
+    uint64_t sent = host_usbd_tx_bytes();
+    size_t mark = output_len();
+    type("help\r");
+    run_ms(500);
+    uint64_t while_suspended = host_usbd_tx_bytes() - sent;
+    host_usbd_set_suspended(false);
+    run_ms(50);
+    char *p_help = output_since(mark);
+    bool help_whole = strstr(p_help, "quiet") != NULL && strstr(p_help, "\r\n> ") != NULL;
+    fprintf(stderr, "suspend: %llu bytes sent while suspended, help %s after resume\n",
+            (unsigned long long)while_suspended, help_whole ? "complete" : "incomplete");
+    TEST_CHECK(while_suspended == 0);
+    TEST_CHECK(help_whole);
+    free(p_help);
+
+    /* Closed with help still queued: it is discarded and counted. */
+    host_usbd_set_suspended(true);
+    type("help\r");
+    run_ms(5);
+    host_usbd_set_port_open(false);
+    run_ms(5);
+    host_usbd_set_suspended(false);
+    sent = host_usbd_tx_bytes();
+    /* Typed while closed: not read until the port opens. */
+    type("usb_stats\r");
+    run_ms(200);
+    uint64_t while_closed = host_usbd_tx_bytes() - sent;
+    mark = output_len();
+    host_usbd_set_port_open(true);
+    run_ms(50);
+    char *p_stats = output_since(mark);
+    char *p_tx = strstr(p_stats, "TX peak");
+    unsigned long peak = 0, size = 0, dropped = 0, truncated = 0;
+    bool parsed = p_tx != NULL &&
+                  sscanf(p_tx, "TX peak %lu/%lu dropped %lu truncated %lu", &peak, &size, &dropped,
+                         &truncated) == 4;
+    fprintf(stderr, "close: %llu bytes sent while closed, usb_stats after open: %s dropped %lu\n",
+            (unsigned long long)while_closed, parsed ? "ran," : "missing,", dropped);
+    TEST_CHECK(while_closed == 0);
+    TEST_CHECK(parsed);
+    TEST_CHECK(dropped > 500);
+    TEST_CHECK(strstr(p_stats, "quiet") == NULL);
+    free(p_stats);
+
+    return test_result("test_port_state");
+}
@@ -0,0 +1,102 @@
+/* Stages a few thousand colors at random moments and checks the period log
+ * of the host PWM model: every period plays exactly one staged color, none
+ * had its buffer written while EasyDMA read it, colors never go back to an
+ * older one, and an update is reported live no earlier than the period it
+ * starts in. */
+#include "host_test.h"
+#include "app_config.h"
+#include "pwm_leds.h"
+
+#define UPDATES 3000
+
+static uint16_t m_colors[UPDATES + 1][3];
+static uint32_t m_ids[UPDATES + 1];
+static uint64_t m_live_us[UPDATES + 1];
+
+/* Index of the staged color in from..to a period played, or -1. */
+static int32_t color_of(host_pwm_period_t const *p_period, int32_t from, int32_t to)
+{
+    for (int32_t i = from; i <= to; i++) {
+        if (p_period->values[0] == m_colors[i][0] && p_period->values[2] == m_colors[i][1] &&
+            p_period->values[1] == m_colors[i][2]) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int main(void)
+{
+    if (!host_time_is_virtual()) {
+        fprintf(stderr, "test_pwm_swap: needs HOST_VIRTUAL_TIME=1\n");
+        return 2;
+    }
+    pwm_leds_init();
+
+    /* Color 0 is the dark one pwm_leds_init() starts with. */
+    uint32_t seed = 3;
+    test_run_us(5000);
+
+    uint32_t checked = 0;
+    uint32_t mixed = 0;
+    uint32_t modified = 0;
+    uint32_t backwards = 0;
+    uint32_t early = 0;
+    int32_t newest = 0;
+    uint32_t next_period = 0;
+
+    for (uint32_t i = 1; i <= UPDATES; i++) {
+        for (uint8_t c = 0; c < 3; c++) {
+            seed = seed * 1103515245u + 12345u;
+            m_colors[i][c] = 1 + (seed >> 16) % PWM_TOP_VALUE;
+        }
+        m_ids[i] = pwm_set_rgb_values(m_colors[i][0], m_colors[i][1], m_colors[i][2]);
+
+        /* 0.1 to 3 periods until the next one, checking liveness often. */
+        seed = seed * 1103515245u + 12345u;
+        uint64_t wait = 100 + (seed >> 16) % 2900;
+        for (uint64_t t = 0; t < wait; t += 100) {
+            test_run_us(100);
+            for (uint32_t j = 1; j <= i; j++) {
+                if (m_live_us[j] == 0 && pwm_rgb_is_live(m_ids[j])) {
+                    m_live_us[j] = host_time_us();
+                }
+            }
+        }
+
+        host_pwm_period_t period;
+        while (host_pwm_period_get(0, next_period, &period)) {
+            next_period++;
+            checked++;
+            modified += period.modified;
+            int32_t index = color_of(&period, 0, (int32_t)i);
+            if (index < 0) {
+                mixed++;
+                continue;
+            }
+            backwards += (index < newest);
+            newest = index > newest ? index : newest;
+            /* Live must not be reported before a period of it started. */
+            if (m_live_us[index] != 0 && m_live_us[index] < period.start_us) {
+                uint32_t first = 1;
+                for (uint32_t k = 0; k < next_period - 1; k++) {
+                    host_pwm_period_t earlier;
+                    if (host_pwm_period_get(0, k, &earlier) && color_of(&earlier, index, index) == index) {
+                        first = 0;
+                        break;
+                    }
+                }
+                early += first;
+            }
+        }
+    }
+
+    fprintf(stderr, "pwm swap: %u updates, %u periods, %u mixed, %u modified, %u backwards, %u early\n",
+            UPDATES, checked, mixed, modified, backwards, early);
+    TEST_CHECK(checked > UPDATES / 2);
+    TEST_CHECK(mixed == 0);
+    TEST_CHECK(modified == 0);
+    TEST_CHECK(backwards == 0);
+    TEST_CHECK(early == 0);
+    return test_result("test_pwm_swap");
+}
@@ -0,0 +1,46 @@
+/* Stages undithered colors at random moments while LD1 blinks and measures
+ * how long each takes to reach the LED. The SEQEND handler only swaps
+ * buffers between chunks, so the wait is bounded by the two chunks queued
+ * on PWM0, LED_CHUNK_MAX_PERIODS long each. */
+#include "host_test.h"
+#include "app_config.h"
+#include "pwm_leds.h"
+
+#define UPDATES          500
+#define POLL_US          100
+#define MAX_LATENCY_US   (10u * PWM_TOP_VALUE)
+
+int main(void)
+{
+    if (!host_time_is_virtual()) {
+        fprintf(stderr, "test_rgb_latency: needs HOST_VIRTUAL_TIME=1\n");
+        return 2;
+    }
+    pwm_leds_init();
+    pwm_set_dither(false);
+    pwm_indicator_set_pattern(PWM_INDICATOR_SLOW_BLINK);
+    test_run_us(5000);
+
+    uint32_t seed = 7;
+    uint64_t worst_us = 0;
+    uint64_t total_us = 0;
+    for (uint32_t i = 0; i < UPDATES; i++) {
+        seed = seed * 1103515245u + 12345u;
+        test_run_us(POLL_US + (seed >> 8) % 20000);
+
+        uint16_t level = 1 + i % PWM_TOP_VALUE;
+        uint32_t update = pwm_set_rgb_values(level, level, 0);
+        uint64_t start_us = host_time_us();
+        while (!pwm_rgb_is_live(update) && host_time_us() - start_us < 100000u) {
+            test_run_us(POLL_US);
+        }
+        uint64_t latency_us = host_time_us() - start_us;
+        worst_us = latency_us > worst_us ? latency_us : worst_us;
+        total_us += latency_us;
+    }
+
+    fprintf(stderr, "rgb latency while blinking: mean %llu us, worst %llu us\n",
+            (unsigned long long)(total_us / UPDATES), (unsigned long long)worst_us);
+    TEST_CHECK(worst_us <= MAX_LATENCY_US);
+    return test_result("test_rgb_latency");
+}
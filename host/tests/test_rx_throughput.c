@@ -0,0 +1,61 @@
+/* Pastes a long script into the CLI and measures how fast it is taken in.
+ * Every command must be answered, in order, and nothing may be dropped on
+ * the way into the RX FIFO. */
+#include "host_test.h"
+#include "host_hal.h"
+
+#define main app_main
+#include "main.c"
+#undef main
+
+#define COMMANDS 20000
+
+static size_t m_script_len;
+static uint64_t m_start_ns;
+
+static void check(void)
+{
+    uint64_t elapsed_ns = test_wall_ns() - m_start_ns;
+    size_t len;
+    char *p_out = test_terminal_output(&len);
+
+    uint32_t ok = 0;
+    for (char *p = strstr(p_out, "OK\r\n"); p != NULL; p = strstr(p + 4, "OK\r\n")) {
+        ok++;
+    }
+    char *p_stats = strstr(p_out, "RX peak");
+    unsigned peak = 0, size = 0, dropped = 1;
+    if (p_stats != NULL) {
+        sscanf(p_stats, "RX peak %u/%u dropped %u", &peak, &size, &dropped);
+    }
+
+    fprintf(stderr, "rx: %zu bytes, %u commands in %.1f ms, %.0f kB/s, RX peak %u/%u\n",
+            m_script_len, ok, elapsed_ns / 1e6, m_script_len * 1e6 / elapsed_ns, peak, size);
+    /* quiet 1, the RGB commands and usb_stats. */
+    TEST_CHECK(ok == COMMANDS + 2);
+    TEST_CHECK(p_stats != NULL);
+    TEST_CHECK(dropped == 0);
+    TEST_CHECK(strstr(p_out, "ERR") == NULL);
+    free(p_out);
+    _exit(test_result("test_rx_throughput"));
+}
+
+int main(void)
+{
+    size_t cap = 32 + COMMANDS * 24;
+    char *p_script = malloc(cap);
+
+    m_script_len = (size_t)sprintf(p_script, "quiet 1\r");
+    for (uint32_t i = 0; i < COMMANDS; i++) {
+        m_script_len += (size_t)sprintf(p_script + m_script_len, "RGB %u %u %u\r",
+                                        i % 1001, (i * 7) % 1001, (i * 13) % 1001);
+    }
+    m_script_len += (size_t)sprintf(p_script + m_script_len, "usb_stats\r");
+
+    test_terminal_script(p_script, m_script_len);
+    free(p_script);
+    test_terminal_capture();
+    atexit(check);
+    m_start_ns = test_wall_ns();
+    return app_main();
+}
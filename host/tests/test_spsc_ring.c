@@ -0,0 +1,110 @@
+/* Stress test of the SPSC ring across two threads: the producer writes a
+ * running sequence in bursts of varying length, the consumer reads it back
+ * with get or peek/skip in chunks of another length and checks that every
+ * value arrives once and in order. A small ring makes both sides meet at
+ * the wrap point constantly. */
+#include "host_test.h"
+#include "spsc_ring.h"
+
+#include <pthread.h>
+#include <sched.h>
+
+#define VALUES 4000000u
+
+SPSC_RING_DEF(m_ring, uint32_t, 64);
+
+static bool m_put_all;
+
+static void *producer(void *p_arg)
+{
+    uint32_t burst[17];
+    uint32_t next = 0;
+    uint32_t seed = 1;
+
+    while (next < VALUES) {
+        seed = seed * 1103515245u + 12345u;
+        uint32_t count = 1 + (seed >> 16) % 17;
+        if (count > VALUES - next) {
+            count = VALUES - next;
+        }
+        for (uint32_t i = 0; i < count; i++) {
+            burst[i] = next + i;
+        }
+        uint32_t put;
+        if (m_put_all) {
+            put = spsc_ring_put_all(&m_ring, burst, count) ? count : 0;
+        } else {
+            put = spsc_ring_put(&m_ring, burst, count);
+        }
+        next += put;
+        /* Hand over the CPU on a single-core host instead of spinning. */
+        if (put < count) {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+static uint32_t consume(void)
+{
+    uint32_t chunk[13];
+    uint32_t expected = 0;
+    uint32_t errors = 0;
+    uint32_t round = 0;
+
+    while (expected < VALUES) {
+        uint32_t want = 1 + round++ % 13;
+        uint32_t got;
+        if (round & 1) {
+            got = spsc_ring_get(&m_ring, chunk, want);
+        } else {
+            got = spsc_ring_peek(&m_ring, chunk, want);
+            TEST_CHECK(spsc_ring_skip(&m_ring, got) == got);
+        }
+        for (uint32_t i = 0; i < got; i++) {
+            errors += (chunk[i] != expected);
+            expected = chunk[i] + 1;
+        }
+        if (got < want) {
+            sched_yield();
+        }
+    }
+    return errors;
+}
+
+static void run(bool put_all)
+{
+    pthread_t thread;
+    uint64_t start = test_wall_ns();
+
+    m_put_all = put_all;
+    m_ring.dropped = 0;
+    m_ring.high_water = 0;
+    pthread_create(&thread, NULL, producer, NULL);
+    uint32_t errors = consume();
+    pthread_join(thread, NULL);
+
+    double ns = (double)(test_wall_ns() - start);
+    fprintf(stderr, "%s: %u values, %u out of order, %.1f ns/value, peak %u/%u\n",
+            put_all ? "put_all" : "put", VALUES, errors, ns / VALUES,
+            m_ring.high_water, spsc_ring_capacity(&m_ring));
+    TEST_CHECK(errors == 0);
+    TEST_CHECK(spsc_ring_is_empty(&m_ring));
+    TEST_CHECK(m_ring.high_water <= spsc_ring_capacity(&m_ring));
+}
+
+int main(void)
+{
+    run(false);
+    run(true);
+
+    /* put_all leaves a ring that cannot take everything untouched. */
+    uint32_t values[64] = { 0 };
+    spsc_ring_stats_reset(&m_ring);
+    TEST_CHECK(spsc_ring_put(&m_ring, values, 60) == 60);
+    TEST_CHECK(!spsc_ring_put_all(&m_ring, values, 5));
+    TEST_CHECK(spsc_ring_used(&m_ring) == 60 && m_ring.dropped == 5);
+    TEST_CHECK(spsc_ring_put(&m_ring, values, 5) == 4);
+    TEST_CHECK(m_ring.dropped == 6 && m_ring.high_water == 64);
+    return test_result("test_spsc_ring");
+}
@@ -0,0 +1,91 @@
+/* Checks the flash records of storage.c. An image from before the colors
+ * record loads its HSV colors through the brightness curve, as the HSV path
+ * shows them. After a save, which has to be one paced page erase and a
+ * chunked write, exact 16-bit duty cycles survive a reload. */
+#include "host_test.h"
+#include "host_hal.h"
+#include "color_state.h"
+#include "curve.h"
+
+#include "src/storage.c"
+
+static bool same_rgb(rgb16_t const *p_a, rgb16_t const *p_b)
+{
+    return p_a->r == p_b->r && p_a->g == p_b->g && p_a->b == p_b->b;
+}
+
+static void check_old_image(void)
+{
+    flash_image_t *p_flash = (flash_image_t *)FLASH_STORAGE_ADDR;
+    hsv_color_t const last = { 120, 100, 50 };
+    hsv_color_t const saved = { 30, 60, 80 };
+
+    /* What older firmware wrote: only flash_data_t, the rest erased. */
+    memset(p_flash, 0xFF, sizeof(*p_flash));
+    memset(&p_flash->data, 0, sizeof(p_flash->data));
+    p_flash->data.magic = STORAGE_MAGIC;
+    p_flash->data.last_state = last;
+    strcpy(p_flash->data.saved_colors[0].name, "old");
+    p_flash->data.saved_colors[0].color = saved;
+    p_flash->data.saved_colors[0].valid = 1;
+
+    curve_select(CURVE_CIE_LSTAR);
+    storage_init();
+
+    rgb16_t rgb;
+    rgb16_t want;
+    hsv_color_t hsv;
+    TEST_CHECK(storage_get_last(&rgb, &hsv));
+    color_from_hsv(&last, &want);
+    fprintf(stderr, "old image: last %u %u %u, HSV path %u %u %u\n",
+            rgb.r, rgb.g, rgb.b, want.r, want.g, want.b);
+    TEST_CHECK(same_rgb(&rgb, &want));
+    TEST_CHECK(hsv.h == last.h && hsv.s == last.s && hsv.v == last.v);
+    /* L* 50 is about 18.4% duty, not the 50% a linear conversion gives. */
+    TEST_CHECK(rgb.g > UINT16_MAX / 6 && rgb.g < UINT16_MAX / 5);
+
+    TEST_CHECK(storage_get_color("old", &rgb, &hsv));
+    color_from_hsv(&saved, &want);
+    TEST_CHECK(same_rgb(&rgb, &want));
+    TEST_CHECK(!storage_get_color("missing", &rgb, &hsv));
+}
+
+static void check_save(void)
+{
+    rgb16_t const last = { 12345, 3, 65535 };
+    rgb16_t const color = { 1, 40000, 777 };
+    hsv_color_t const hsv = { 300, 99, 1 };
+    uint32_t erases = host_nvmc_erase_count();
+    uint32_t writes = host_nvmc_write_count();
+
+    storage_save_current(&last, &hsv);
+    TEST_CHECK(storage_add_color("new", &color, &hsv));
+    uint32_t steps = 1;
+    while (storage_process()) {
+        steps++;
+    }
+    erases = host_nvmc_erase_count() - erases;
+    writes = host_nvmc_write_count() - writes;
+    fprintf(stderr, "save: %u steps, %u page erase, %u words written\n", steps, erases, writes);
+    TEST_CHECK(erases == 1);
+    TEST_CHECK(writes == FLASH_IMAGE_WORDS);
+    TEST_CHECK(steps > 2);
+
+    /* Forget the RAM copy and read it back from flash. */
+    memset(&m_ram_colors, 0, sizeof(m_ram_colors));
+    memset(&m_ram_data, 0, sizeof(m_ram_data));
+    storage_init();
+    rgb16_t rgb;
+    hsv_color_t got;
+    TEST_CHECK(storage_get_last(&rgb, &got) && same_rgb(&rgb, &last));
+    TEST_CHECK(storage_get_color("new", &rgb, &got) && same_rgb(&rgb, &color));
+    TEST_CHECK(got.h == hsv.h && got.s == hsv.s && got.v == hsv.v);
+    TEST_CHECK(storage_get_color("old", &rgb, &got));
+}
+
+int main(void)
+{
+    check_old_image();
+    check_save();
+    return test_result("test_storage");
+}
@@ -0,0 +1,231 @@
+/* Stream parser benchmark: a million COBS frames of every color type
+ * through stream_rx_byte(), with faults injected on the way. Some
+ * sequence numbers are skipped, some frames are sent again later, some get
+ * a byte flipped after their CRC, and some are cut short. The decoder's
+ * counters must match the injected faults exactly, every frame it accepts
+ * must decode to what was sent, and the throughput is reported in frames
+ * and MB per second. */
+#include "host_test.h"
+#include "stream.h"
+
+#define FRAMES       1000000u
+#define MAX_ENCODED  (STREAM_MAX_FRAME + 2)
+
+/* One in FAULT_RATE frames gets each fault. */
+#define FAULT_RATE   97u
+
+typedef struct {
+    uint32_t sent;
+    uint32_t skipped;
+    uint32_t resent;
+    uint32_t corrupted;
+    uint32_t truncated;
+} faults_t;
+
+static uint8_t *m_stream;
+static size_t m_stream_len;
+static stream_frame_t *m_expected;
+static uint32_t m_expected_count;
+
+static uint32_t m_seed = 11;
+
+static uint32_t rand_below(uint32_t n)
+{
+    m_seed = m_seed * 1103515245u + 12345u;
+    return (m_seed >> 8) % n;
+}
+
+static void put_u16(uint8_t *p, uint16_t value)
+{
+    p[0] = value & 0xFF;
+    p[1] = value >> 8;
+}
+
+/* Frame bytes with their CRC, before COBS. */
+static size_t frame_raw(stream_frame_t const *p_frame, uint8_t *p_raw)
+{
+    size_t n = 0;
+    p_raw[n++] = p_frame->type;
+    put_u16(&p_raw[n], p_frame->seq);
+    n += 2;
+    if (p_frame->type == STREAM_FRAME_RGB_AT) {
+        put_u16(&p_raw[n], p_frame->pts & 0xFFFF);
+        put_u16(&p_raw[n + 2], p_frame->pts >> 16);
+        n += 4;
+    }
+    if (p_frame->type == STREAM_FRAME_HSV) {
+        put_u16(&p_raw[n], p_frame->hsv.h);
+        p_raw[n + 2] = p_frame->hsv.s;
+        p_raw[n + 3] = p_frame->hsv.v;
+        n += 4;
+    } else {
+        put_u16(&p_raw[n], p_frame->rgb.r);
+        put_u16(&p_raw[n + 2], p_frame->rgb.g);
+        put_u16(&p_raw[n + 4], p_frame->rgb.b);
+        n += 6;
+    }
+    put_u16(&p_raw[n], stream_crc16(p_raw, n));
+    return n + 2;
+}
+
+/* COBS encodes len bytes and appends the terminating zero. */
+static size_t cobs_encode(uint8_t const *p_raw, size_t len, uint8_t *p_out)
+{
+    size_t code_pos = 0;
+    size_t e = 1;
+    uint8_t code = 1;
+
+    for (size_t i = 0; i < len; i++) {
+        if (p_raw[i] == 0) {
+            p_out[code_pos] = code;
+            code_pos = e++;
+            code = 1;
+        } else {
+            p_out[e++] = p_raw[i];
+            code++;
+        }
+    }
+    p_out[code_pos] = code;
+    p_out[e++] = 0;
+    return e;
+}
+
+static void random_frame(stream_frame_t *p_frame, uint16_t seq)
+{
+    static stream_frame_type_t const types[3] = {
+        STREAM_FRAME_RGB, STREAM_FRAME_HSV, STREAM_FRAME_RGB_AT
+    };
+
+    memset(p_frame, 0, sizeof(*p_frame));
+    p_frame->type = types[rand_below(3)];
+    p_frame->seq = seq;
+    if (p_frame->type == STREAM_FRAME_HSV) {
+        p_frame->hsv.h = rand_below(361);
+        p_frame->hsv.s = rand_below(101);
+        p_frame->hsv.v = rand_below(101);
+        return;
+    }
+    if (p_frame->type == STREAM_FRAME_RGB_AT) {
+        p_frame->pts = m_seed;
+    }
+    p_frame->rgb.r = rand_below(PWM_TOP_VALUE + 1);
+    p_frame->rgb.g = rand_below(PWM_TOP_VALUE + 1);
+    p_frame->rgb.b = rand_below(PWM_TOP_VALUE + 1);
+}
+
+static void build_stream(faults_t *p_faults)
+{
+    uint16_t seq = 0;
+    stream_frame_t last = { 0 };
+    bool have_last = false;
+
+    m_stream = malloc((size_t)FRAMES * 2 * MAX_ENCODED);
+    m_expected = malloc(FRAMES * sizeof(*m_expected));
+    if (m_stream == NULL || m_expected == NULL) {
+        exit(2);
+    }
+
+    for (uint32_t i = 0; i < FRAMES; i++) {
+        uint8_t raw[STREAM_MAX_FRAME];
+        stream_frame_t frame;
+        uint32_t fault = rand_below(FAULT_RATE);
+
+        if (fault == 0) {
+            /* Lost on the way: the decoder sees the next number jump. */
+            uint32_t skip = 1 + rand_below(3);
+            seq += skip;
+            p_faults->skipped += skip;
+        }
+        random_frame(&frame, seq);
+        size_t len = frame_raw(&frame, raw);
+
+        if (fault == 1) {
+            /* Damaged after the CRC; the frame never arrives as such. */
+            raw[rand_below(len - 2)] ^= (uint8_t)(1 + rand_below(255));
+            p_faults->corrupted++;
+        }
+        size_t encoded = cobs_encode(raw, len, &m_stream[m_stream_len]);
+        if (fault == 2) {
+            /* Cut short after at most four bytes, shorter than any
+             * frame header and CRC. */
+            size_t keep = 1 + rand_below(4);
+            m_stream[m_stream_len + keep] = 0;
+            encoded = keep + 1;
+            p_faults->truncated++;
+        }
+        m_stream_len += encoded;
+        p_faults->sent++;
+
+        if (fault == 3 && have_last) {
+            /* A stale frame from behind, sent again. */
+            len = frame_raw(&last, raw);
+            m_stream_len += cobs_encode(raw, len, &m_stream[m_stream_len]);
+            p_faults->resent++;
+        }
+        if (fault != 1 && fault != 2) {
+            m_expected[m_expected_count++] = frame;
+            last = frame;
+            have_last = true;
+        }
+        seq++;
+    }
+}
+
+static bool frame_equal(stream_frame_t const *p_a, stream_frame_t const *p_b)
+{
+    if (p_a->type != p_b->type || p_a->seq != p_b->seq) {
+        return false;
+    }
+    if (p_a->type == STREAM_FRAME_HSV) {
+        return p_a->hsv.h == p_b->hsv.h && p_a->hsv.s == p_b->hsv.s && p_a->hsv.v == p_b->hsv.v;
+    }
+    return (p_a->type != STREAM_FRAME_RGB_AT || p_a->pts == p_b->pts) &&
+           p_a->rgb.r == p_b->rgb.r && p_a->rgb.g == p_b->rgb.g && p_a->rgb.b == p_b->rgb.b;
+}
+
+int main(void)
+{
+    faults_t faults = { 0 };
+    build_stream(&faults);
+
+    /* Every frame that never decodes leaves a gap in the numbers too. */
+    uint32_t expected_lost = faults.skipped + faults.corrupted + faults.truncated;
+
+    stream_reset();
+    stream_stats_reset();
+    uint32_t delivered = 0;
+    uint32_t wrong = 0;
+    uint64_t start_ns = test_wall_ns();
+    for (size_t i = 0; i < m_stream_len; i++) {
+        stream_frame_t frame;
+        if (stream_rx_byte(m_stream[i], &frame)) {
+            wrong += delivered >= m_expected_count || !frame_equal(&frame, &m_expected[delivered]);
+            delivered++;
+        }
+    }
+    uint64_t elapsed_ns = test_wall_ns() - start_ns;
+
+    stream_stats_t stats;
+    stream_stats_get(&stats);
+    double seconds = elapsed_ns / 1e9;
+    fprintf(stderr, "stream parse: %u frames, %zu bytes in %.1f ms: %.2f M frames/s, %.1f MB/s\n",
+            faults.sent + faults.resent, m_stream_len, elapsed_ns / 1e6,
+            (faults.sent + faults.resent) / seconds / 1e6, m_stream_len / seconds / 1e6);
+    fprintf(stderr, "stream parse: injected %u skipped, %u corrupted, %u truncated, %u resent; "
+            "counted frames=%u crc_errors=%u malformed=%u lost=%u (expected %u) "
+            "out_of_order=%u, %u decoded wrong\n",
+            faults.skipped, faults.corrupted, faults.truncated, faults.resent, stats.frames,
+            stats.crc_errors, stats.malformed, stats.lost, expected_lost, stats.out_of_order, wrong);
+
+    TEST_CHECK(delivered == m_expected_count);
+    TEST_CHECK(stats.frames == m_expected_count);
+    TEST_CHECK(wrong == 0);
+    TEST_CHECK(stats.crc_errors == faults.corrupted);
+    TEST_CHECK(stats.malformed == faults.truncated);
+    TEST_CHECK(stats.out_of_order == faults.resent);
+    TEST_CHECK(stats.lost == expected_lost);
+
+    free(m_stream);
+    free(m_expected);
+    return test_result("test_stream_parse");
+}
@@ -0,0 +1,141 @@
+/* Benchmarks the CLI output path: how long a typed character takes to come
+ * back as echo, and how long the whole help text takes to reach the host.
+ * Both are counted in main loop passes, each being one cli_process() call,
+ * and in host wall-clock time. */
+#include "host_test.h"
+#include "host_hal.h"
+#include "pwm_leds.h"
+#include "timebase.h"
+#include "usb_cli.h"
+
+#define ECHO_ROUNDS 1000
+#define HELP_ROUNDS 200
+#define MAX_PASSES  64
+
+static int m_input;
+
+static void type(const char *p_text)
+{
+    if (write(m_input, p_text, strlen(p_text)) != (ssize_t)strlen(p_text)) {
+        perror("write");
+        exit(2);
+    }
+}
+
+/* Whether the last bytes sent to the host are the prompt. */
+static bool output_ends_with_prompt(void)
+{
+    char tail[4];
+    fflush(stdout);
+    off_t len = lseek(STDOUT_FILENO, 0, SEEK_END);
+    return len >= 4 && pread(STDOUT_FILENO, tail, 4, len - 4) == 4 && memcmp(tail, "\r\n> ", 4) == 0;
+}
+
+/* Runs the loop until done() holds; returns the passes it took. */
+static uint32_t run_until(bool (*done)(uint64_t start_bytes), uint64_t *p_ns)
+{
+    uint64_t start_bytes = host_usbd_tx_bytes();
+    uint64_t start_ns = test_wall_ns();
+    uint32_t passes = 0;
+
+    while (passes < MAX_PASSES && !done(start_bytes)) {
+        cli_process();
+        passes++;
+    }
+    *p_ns = test_wall_ns() - start_ns;
+    return passes;
+}
+
+static bool echoed(uint64_t start_bytes)
+{
+    return host_usbd_tx_bytes() > start_bytes;
+}
+
+static bool prompted(uint64_t start_bytes)
+{
+    return host_usbd_tx_bytes() > start_bytes && output_ends_with_prompt();
+}
+
+int main(void)
+{
+    int fds[2];
+    if (pipe(fds) != 0) {
+        perror("pipe");
+        return 2;
+    }
+    dup2(fds[0], STDIN_FILENO);
+    m_input = fds[1];
+    test_terminal_capture();
+
+    timebase_init();
+    pwm_leds_init();
+    cli_init();
+    uint64_t ns;
+    type("\r");
+    run_until(prompted, &ns);
+
+    uint32_t echo_max = 0;
+    uint64_t echo_ns = 0;
+    for (uint32_t i = 0; i < ECHO_ROUNDS; i++) {
+        type("a");
+        uint32_t passes = run_until(echoed, &ns);
+        echo_max = passes > echo_max ? passes : echo_max;
+        echo_ns += ns;
+        type("\x7f");
+        run_until(echoed, &ns);
+    }
+
+    uint32_t help_max = 0;
+    uint64_t help_ns = 0;
+    uint64_t help_bytes = host_usbd_tx_bytes();
+    for (uint32_t i = 0; i < HELP_ROUNDS; i++) {
+        type("help\r");
+        uint32_t passes = run_until(prompted, &ns);
+        help_max = passes > help_max ? passes : help_max;
+        help_ns += ns;
+    }
+    help_bytes = (host_usbd_tx_bytes() - help_bytes) / HELP_ROUNDS;
+
+    fprintf(stderr, "echo: at most %u pass(es), %.2f us average\n",
+            echo_max, echo_ns / 1e3 / ECHO_ROUNDS);
+    fprintf(stderr, "help: %llu bytes, at most %u pass(es), %.2f us average\n",
+            (unsigned long long)help_bytes, help_max, help_ns / 1e3 / HELP_ROUNDS);
+    /* Echo goes out in the pass that reads the character. The help text
+     * is queued in one pass; its packets are chained by TX_DONE, which the
+     * next pass handles. */
+    TEST_CHECK(echo_max == 1);
+    TEST_CHECK(help_max <= 2);
+
+    /* The last help text arrived whole. */
+    size_t len;
+    char *p_out = test_terminal_output(&len);
+    char *p_last = p_out;
+    for (char *p = strstr(p_out, "Commands:"); p != NULL; p = strstr(p + 1, "Commands:")) {
+        p_last = p;
+    }
+    TEST_CHECK(strstr(p_last, "quiet <0|1>") != NULL);
+    TEST_CHECK((size_t)(p_out + len - p_last) + 2 == help_bytes - strlen("help"));
+    free(p_out);
+
+    /* Pipelined replies larger than the TX ring wait for each other
+     * instead of being cut. */
+    uint64_t start = host_usbd_tx_bytes();
+    type("help;help;help;usb_stats\r");
+    uint32_t passes = run_until(prompted, &ns);
+    p_out = test_terminal_output(&len);
+    char *p_tail = p_out + len - (host_usbd_tx_bytes() - start);
+    uint32_t helps = 0;
+    for (char *p = strstr(p_tail, "Commands:"); p != NULL; p = strstr(p + 1, "Commands:")) {
+        helps++;
+    }
+    unsigned peak = 0, size = 0, dropped = 1, truncated = 1;
+    char *p_stats = strstr(p_tail, "TX peak");
+    if (p_stats != NULL) {
+        sscanf(p_stats, "TX peak %u/%u dropped %u truncated %u", &peak, &size, &dropped, &truncated);
+    }
+    fprintf(stderr, "help x3: %u passes, TX peak %u/%u\n", passes, peak, size);
+    TEST_CHECK(helps == 3);
+    TEST_CHECK(p_stats != NULL && dropped == 0 && truncated == 0);
+    free(p_out);
+    return test_result("test_tx_latency");
+}
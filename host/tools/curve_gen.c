@@ -0,0 +1,125 @@
+/* Generates the brightness curve tables declared in curve.h.
+ *
+ *   curve_gen <out.c>
+ *
+ * Each entry is the reference formula evaluated at the entry's input and
+ * rounded to 16 bits. Before writing anything the tables are checked
+ * against the formulas for every 16-bit input as curve_apply() looks them
+ * up: the result must be monotonic, exact at both ends and within
+ * CURVE_MAX_ERROR of the formula. A failed check exits non-zero, which
+ * stops the build. */
+#include "curve.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Half a PWM count at PWM_TOP_VALUE 1000, in 16-bit duty units. */
+#define CURVE_MAX_ERROR 32.0
+
+typedef double (*curve_fn_t)(double x);
+
+static double gamma_22(double x)
+{
+    return pow(x, 2.2);
+}
+
+/* CIE 1976 lightness L* = 100 x back to relative luminance. */
+static double cie_lstar(double x)
+{
+    double l = x * 100.0;
+    if (l <= 8.0) {
+        return l / 903.3;
+    }
+    double f = (l + 16.0) / 116.0;
+    return f * f * f;
+}
+
+static uint16_t quantize(double y)
+{
+    if (y <= 0.0) return 0;
+    if (y >= 1.0) return UINT16_MAX;
+    return (uint16_t)lround(y * UINT16_MAX);
+}
+
+static void build(uint16_t *p_table, curve_fn_t fn)
+{
+    for (uint32_t i = 0; i < CURVE_TABLE_SIZE; i++) {
+        double x = (double)(i << CURVE_INDEX_SHIFT) / UINT16_MAX;
+        p_table[i] = quantize(fn(x > 1.0 ? 1.0 : x));
+    }
+}
+
+static uint16_t lookup(uint16_t const *p_table, uint32_t x)
+{
+    return p_table[(x + (1u << (CURVE_INDEX_SHIFT - 1))) >> CURVE_INDEX_SHIFT];
+}
+
+static bool check(char const *name, uint16_t const *p_table, curve_fn_t fn)
+{
+    double max_err = 0.0;
+    double sum_err = 0.0;
+    bool ok = true;
+
+    for (uint32_t x = 0; x <= UINT16_MAX; x++) {
+        uint16_t y = lookup(p_table, x);
+        double err = fabs(y - fn((double)x / UINT16_MAX) * UINT16_MAX);
+        if (err > max_err) max_err = err;
+        sum_err += err;
+        if (x > 0 && y < lookup(p_table, x - 1)) {
+            fprintf(stderr, "curve_gen: %s not monotonic at %u\n", name, (unsigned)x);
+            ok = false;
+        }
+    }
+    if (lookup(p_table, 0) != 0 || lookup(p_table, UINT16_MAX) != UINT16_MAX) {
+        fprintf(stderr, "curve_gen: %s does not map 0 and full scale to themselves\n", name);
+        ok = false;
+    }
+    if (max_err > CURVE_MAX_ERROR) {
+        fprintf(stderr, "curve_gen: %s off by %.1f, limit %.1f\n", name, max_err, CURVE_MAX_ERROR);
+        ok = false;
+    }
+    fprintf(stderr, "curve_gen: %-9s max error %5.2f mean %5.2f (16-bit units)\n",
+            name, max_err, sum_err / (UINT16_MAX + 1.0));
+    return ok;
+}
+
+static void emit(FILE *p_out, char const *name, uint16_t const *p_table)
+{
+    fprintf(p_out, "\nuint16_t const %s[CURVE_TABLE_SIZE] = {", name);
+    for (uint32_t i = 0; i < CURVE_TABLE_SIZE; i++) {
+        fprintf(p_out, "%s%5u,", (i % 12) ? " " : "\n    ", p_table[i]);
+    }
+    fprintf(p_out, "\n};\n");
+}
+
+int main(int argc, char **argv)
+{
+    static uint16_t gamma[CURVE_TABLE_SIZE];
+    static uint16_t lstar[CURVE_TABLE_SIZE];
+
+    if (argc != 2) {
+        fprintf(stderr, "usage: curve_gen <out.c>\n");
+        return 2;
+    }
+
+    build(gamma, gamma_22);
+    build(lstar, cie_lstar);
+    bool ok = check("gamma 2.2", gamma, gamma_22);
+    ok = check("CIE L*", lstar, cie_lstar) && ok;
+    if (!ok) {
+        return 1;
+    }
+
+    FILE *p_out = fopen(argv[1], "w");
+    if (p_out == NULL) {
+        perror(argv[1]);
+        return 1;
+    }
+    fprintf(p_out, "/* Generated by host/tools/curve_gen.c, do not edit. */\n");
+    fprintf(p_out, "#include \"curve.h\"\n");
+    emit(p_out, "curve_table_gamma_22", gamma);
+    emit(p_out, "curve_table_cie_lstar", lstar);
+    return fclose(p_out) == 0 ? 0 : 1;
+}
@@ -0,0 +1,121 @@
+/* Generates the reciprocal and hue ramp tables declared in hsv.h.
+ *
+ *   hsv_gen <out.c>
+ *
+ * hsv_recip[d] is 2^HSV_RECIP_SHIFT / d rounded up. Before writing anything
+ * every entry is checked against integer division for every numerator the
+ * conversions can pass, up to HSV_RECIP_MAX_NUM, and every h, s and v is
+ * converted through hsv_hue_ramp and compared with the exact arithmetic
+ * result in PWM counts and in 16 bits. A mismatch exits non-zero, which
+ * stops the build. This checks the table; host/tests/test_hsv_lut.c checks
+ * the conversions in src/hsv.c that use it. */
+#include "hsv.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+
+static bool check(uint32_t const *p_recip)
+{
+    for (uint32_t d = 1; d < HSV_RECIP_SIZE; d++) {
+        for (uint32_t n = 0; n <= HSV_RECIP_MAX_NUM; n++) {
+            uint32_t q = (uint32_t)(((uint64_t)n * p_recip[d]) >> HSV_RECIP_SHIFT);
+            if (q != n / d) {
+                fprintf(stderr, "hsv_gen: %u / %u gives %u\n", (unsigned)n, (unsigned)d, (unsigned)q);
+                return false;
+            }
+        }
+    }
+    fprintf(stderr, "hsv_gen: %u reciprocals exact up to %u\n",
+            (unsigned)(HSV_RECIP_SIZE - 1), (unsigned)HSV_RECIP_MAX_NUM);
+    return true;
+}
+
+/* Channel c of hue h at full saturation, in 1/60 of full: 60 on the
+ * plateau, 0 on the floor, the degree within the sector on a ramp. */
+static uint32_t hue_sixtieths(uint32_t h, uint32_t c)
+{
+    static const uint32_t offset[3] = { 300, 180, 60 };
+    uint32_t k = (offset[c] + h) % 360;
+    uint32_t x = MIN(k, 240 - MIN(k, 240));
+    return 60 - MIN(x, 60);
+}
+
+/* x / d rounded to nearest, halves up. */
+static uint64_t div_round(uint64_t x, uint64_t d)
+{
+    return (x + d / 2) / d;
+}
+
+static uint32_t diff(uint64_t a, uint64_t b)
+{
+    return (uint32_t)(a > b ? a - b : b - a);
+}
+
+static bool check_ramp(uint16_t const (*p_ramp)[3])
+{
+    static const uint32_t fulls[2] = { PWM_TOP_VALUE, UINT16_MAX };
+    uint32_t worst[2] = { 0, 0 };
+
+    for (uint32_t h = 0; h < HSV_HUE_DEGREES; h++) {
+        for (uint32_t c = 0; c < 3; c++) {
+            uint32_t x = hue_sixtieths(h, c);
+            for (uint32_t s = 0; s <= 100; s++) {
+                uint64_t exact = 6000 - s * (60 - x);
+                uint64_t lut = (100 - s) * UINT16_MAX + s * p_ramp[h][c];
+                for (uint32_t v = 0; v <= 100; v++) {
+                    for (uint32_t i = 0; i < 2; i++) {
+                        uint64_t a = div_round(v * exact * fulls[i], 600000);
+                        uint64_t l = div_round(v * lut * fulls[i], 100ull * 100 * UINT16_MAX);
+                        worst[i] = MAX(worst[i], diff(a, l));
+                    }
+                }
+            }
+        }
+    }
+    fprintf(stderr, "hsv_gen: hue ramp within %u count, %u LSB of 16 bits\n",
+            (unsigned)worst[0], (unsigned)worst[1]);
+    return worst[0] <= 1 && worst[1] <= 1;
+}
+
+int main(int argc, char **argv)
+{
+    static uint32_t recip[HSV_RECIP_SIZE];
+    static uint16_t ramp[HSV_HUE_DEGREES][3];
+
+    if (argc != 2) {
+        fprintf(stderr, "usage: hsv_gen <out.c>\n");
+        return 2;
+    }
+
+    for (uint32_t d = 1; d < HSV_RECIP_SIZE; d++) {
+        recip[d] = (uint32_t)(((1ull << HSV_RECIP_SHIFT) + d - 1) / d);
+    }
+    for (uint32_t h = 0; h < HSV_HUE_DEGREES; h++) {
+        for (uint32_t c = 0; c < 3; c++) {
+            ramp[h][c] = (uint16_t)div_round((uint64_t)hue_sixtieths(h, c) * UINT16_MAX, 60);
+        }
+    }
+    if (!check(recip) || !check_ramp(ramp)) {
+        return 1;
+    }
+
+    FILE *p_out = fopen(argv[1], "w");
+    if (p_out == NULL) {
+        perror(argv[1]);
+        return 1;
+    }
+    fprintf(p_out, "/* Generated by host/tools/hsv_gen.c, do not edit. */\n");
+    fprintf(p_out, "#include \"hsv.h\"\n");
+    fprintf(p_out, "\nuint32_t const hsv_recip[HSV_RECIP_SIZE] = {");
+    for (uint32_t i = 0; i < HSV_RECIP_SIZE; i++) {
+        fprintf(p_out, "%s%10u,", (i % 6) ? " " : "\n    ", (unsigned)recip[i]);
+    }
+    fprintf(p_out, "\n};\n");
+    fprintf(p_out, "\nuint16_t const hsv_hue_ramp[HSV_HUE_DEGREES][3] = {");
+    for (uint32_t h = 0; h < HSV_HUE_DEGREES; h++) {
+        fprintf(p_out, "%s{ %5u, %5u, %5u },", (h % 3) ? " " : "\n    ",
+                (unsigned)ramp[h][0], (unsigned)ramp[h][1], (unsigned)ramp[h][2]);
+    }
+    fprintf(p_out, "\n};\n");
+    return fclose(p_out) == 0 ? 0 : 1;
+}
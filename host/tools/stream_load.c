@@ -0,0 +1,159 @@
+/* Load generator for the binary color stream.
+ *
+ *   stream_load <frames> [rate_hz] [jitter_ms] > /dev/ttyACM0
+ *   stream_load 1000000 | esl_host
+ *   stream_load 2000 100 40 | esl_host
+ *
+ * Switches the CLI into stream mode, sends <frames> RGB frames walking the
+ * hue circle, leaves stream mode and asks for the device counters. A rate
+ * of 0 (the default) sends as fast as the output accepts. With jitter_ms
+ * the frames are timestamped (RGB_AT) and each one is held back by a
+ * random 0..jitter_ms on top of its nominal send time, which replays the
+ * bunching a busy host OS produces. */
+#include "stream.h"
+#include "hsv.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+static uint8_t m_out[64 * 1024];
+static size_t m_out_len;
+
+static void out_flush(void)
+{
+    size_t pos = 0;
+    while (pos < m_out_len) {
+        ssize_t n = write(STDOUT_FILENO, m_out + pos, m_out_len - pos);
+        if (n <= 0) exit(1);
+        pos += (size_t)n;
+    }
+    m_out_len = 0;
+}
+
+static void out_bytes(const void *p_data, size_t len)
+{
+    if (m_out_len + len > sizeof(m_out)) out_flush();
+    memcpy(m_out + m_out_len, p_data, len);
+    m_out_len += len;
+}
+
+static void timespec_add_us(struct timespec *p_ts, uint64_t us)
+{
+    p_ts->tv_nsec += (long)(us % 1000000) * 1000;
+    p_ts->tv_sec += (time_t)(us / 1000000);
+    if (p_ts->tv_nsec >= 1000000000L) {
+        p_ts->tv_nsec -= 1000000000L;
+        p_ts->tv_sec++;
+    }
+}
+
+static void send_frame(stream_frame_type_t type, uint16_t seq, const uint8_t *p_payload, size_t len)
+{
+    uint8_t raw[STREAM_MAX_FRAME];
+    size_t n = 0;
+    raw[n++] = type;
+    raw[n++] = seq & 0xFF;
+    raw[n++] = seq >> 8;
+    memcpy(&raw[n], p_payload, len);
+    n += len;
+    uint16_t crc = stream_crc16(raw, n);
+    raw[n++] = crc & 0xFF;
+    raw[n++] = crc >> 8;
+
+    uint8_t enc[STREAM_MAX_FRAME + 2];
+    size_t code_pos = 0;
+    size_t e = 1;
+    uint8_t code = 1;
+    for (size_t i = 0; i < n; i++) {
+        if (raw[i] == 0) {
+            enc[code_pos] = code;
+            code_pos = e++;
+            code = 1;
+        } else {
+            enc[e++] = raw[i];
+            code++;
+        }
+    }
+    enc[code_pos] = code;
+    enc[e++] = 0;
+    out_bytes(enc, e);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <frames> [rate_hz]\n", argv[0]);
+        return 2;
+    }
+    unsigned long frames = strtoul(argv[1], NULL, 0);
+    unsigned long rate = (argc > 2) ? strtoul(argv[2], NULL, 0) : 0;
+    bool timed = (argc > 3);
+    unsigned long jitter_ms = timed ? strtoul(argv[3], NULL, 0) : 0;
+
+    if (timed && rate == 0) {
+        fprintf(stderr, "timestamped frames need a rate\n");
+        return 2;
+    }
+
+    static const char enter[] = "stream\r";
+    out_bytes(enter, sizeof(enter) - 1);
+    out_bytes("", 1);
+    out_flush();
+
+    /* Let the device finish booting and switch modes, so the first frames
+     * are not queued up behind the command and skew the jitter figures. */
+    if (timed) {
+        usleep(300000);
+    }
+
+    struct timespec start;
+    struct timespec last;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    last = start;
+
+
+    for (unsigned long i = 0; i < frames; i++) {
+        uint16_t rgb[3];
+        hsv_to_rgb_simple(i % 360, 100, 100, &rgb[0], &rgb[1], &rgb[2]);
+        uint64_t nominal_us = (uint64_t)i * 1000000 / (rate ? rate : 1);
+
+        if (rate != 0) {
+            struct timespec at = start;
+            timespec_add_us(&at, nominal_us + (jitter_ms ? (uint64_t)(rand() % (jitter_ms * 1000)) : 0));
+            if (at.tv_sec < last.tv_sec || (at.tv_sec == last.tv_sec && at.tv_nsec < last.tv_nsec)) {
+                at = last;
+            }
+            clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &at, NULL);
+            last = at;
+        }
+
+        uint8_t payload[10];
+        size_t len = 0;
+        if (timed) {
+            uint32_t pts = (uint32_t)(nominal_us / 1000);
+            payload[len++] = pts & 0xFF;
+            payload[len++] = (pts >> 8) & 0xFF;
+            payload[len++] = (pts >> 16) & 0xFF;
+            payload[len++] = pts >> 24;
+        }
+        for (int c = 0; c < 3; c++) {
+            payload[len++] = rgb[c] & 0xFF;
+            payload[len++] = rgb[c] >> 8;
+        }
+        send_frame(timed ? STREAM_FRAME_RGB_AT : STREAM_FRAME_RGB, (uint16_t)i, payload, len);
+
+        if (rate != 0) {
+            out_flush();
+        }
+    }
+
+    send_frame(STREAM_FRAME_EXIT, (uint16_t)frames, NULL, 0);
+    static const char stats[] = "stream_stats\r";
+    out_bytes(stats, sizeof(stats) - 1);
+    out_flush();
+    return 0;
+}
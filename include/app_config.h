@@ -12,12 +12,29 @@
 #define DEVICE_ID       7205
 #define DEFAULT_HUE_PERCENT  (DEVICE_ID % 100)
 #define PWM_TOP_VALUE   1000
+#define PWM_FADE_MAX_STEPS  256
+#define PWM_FADE_MAX_MS     60000
+#define PWM_DITHER_PERIODS  16
+#define COLOR_CURVE_DEFAULT CURVE_CIE_LSTAR
+
+/* 1 takes HSV hue ramps from a generated table in flash, see hsv.h. */
+#ifndef HSV_HUE_LUT
+#define HSV_HUE_LUT 0
+#endif
 
 #define DOUBLE_CLICK_TIMEOUT_MS  400
 #define DEBOUNCE_MS              50
 #define MODE_BLINK_SLOW_MS       1000
 #define MODE_BLINK_FAST_MS       200
+#define MODE_BREATHE_MS          2000
 #define VALUE_CHANGE_INTERVAL_MS 50
+#define BUTTON_HOLD_DELAY_MS     300
+#define BUTTON_ACCEL_PERIOD_MS   100
+#define BUTTON_REPEAT_MAX_STEPS  20
+
+#define STREAM_JITTER_DEPTH       32
+#define STREAM_JITTER_LATENCY_MS  60
+#define STREAM_DRIFT_WINDOW_MS    1000
 
 #define MAX_SAVED_COLORS    10
 #define COLOR_NAME_MAX_LEN  16
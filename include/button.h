@@ -2,10 +2,33 @@
 #define BUTTON_H
 
 #include <stdint.h>
-#include "nrfx_gpiote.h"
+#include <stdbool.h>
 
-typedef void (*button_handler_t)(nrfx_gpiote_pin_t pin, nrf_gpiote_polarity_t action);
+typedef enum {
+    BUTTON_EVT_CLICK = 0,
+    BUTTON_EVT_DOUBLE_CLICK,
+    BUTTON_EVT_HOLD_START,
+    BUTTON_EVT_HOLD_REPEAT,
+    BUTTON_EVT_RELEASE
+} button_evt_type_t;
 
-void button_init(button_handler_t handler);
+typedef struct {
+    button_evt_type_t type;
+    uint16_t steps;
+    uint32_t time_ms;
+} button_evt_t;
 
-#endif
\ No newline at end of file
+void button_init(void);
+
+/* Records a raw edge. Safe to call from the GPIOTE interrupt. If the queue
+ * is full the edge is dropped and button_process() reads the pin instead. */
+void button_edge(bool pressed, uint32_t time_ms);
+
+/* Runs the gesture state machine over queued edges and expired timers. */
+void button_process(uint32_t now_ms);
+
+bool button_event_get(button_evt_t *p_evt);
+
+bool button_next_deadline(uint32_t *p_deadline_ms);
+
+#endif
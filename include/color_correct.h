@@ -0,0 +1,33 @@
+#ifndef COLOR_CORRECT_H
+#define COLOR_CORRECT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Q15 coefficient closest to 1.0. */
+#define COLOR_Q15_ONE INT16_MAX
+
+/* Largest channel value color_correct_apply() takes without overflowing
+ * its 32-bit sums. */
+#define COLOR_CORRECT_MAX_INPUT 21845
+
+/* White balance and crosstalk correction for LD2, in Q15. Row i of the
+ * matrix mixes the requested red, green and blue into output channel i,
+ * which is then scaled by gain[i]. */
+typedef struct {
+    int16_t matrix[3][3];
+    int16_t gain[3];
+} color_calib_t;
+
+/* Identity matrix and unity gains, which leave colors untouched. */
+void color_correct_default(color_calib_t *p_calib);
+
+void color_correct_set(const color_calib_t *p_calib);
+void color_correct_get(color_calib_t *p_calib);
+
+/* Corrects a color in place. Channels run from 0 to max, which must not
+ * exceed COLOR_CORRECT_MAX_INPUT, and results are clamped to that range.
+ * The default calibration returns without touching the color. */
+void color_correct_apply(uint16_t *p_r, uint16_t *p_g, uint16_t *p_b, uint16_t max);
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef COLOR_STATE_H
+#define COLOR_STATE_H
+
+#include <stdint.h>
+#include "app_config.h"
+#include "hsv.h"
+
+/* The color the LED shows, kept as 16-bit RGB duty cycles before the LD2
+ * calibration. RGB setters store it as is and never convert to HSV. HSV
+ * setters go through the brightness curve, so V reads as lightness. The HSV
+ * view of an RGB color is derived through the inverse curve the first time
+ * the button or CLI asks for it and then kept, so HSV edits step from
+ * exactly the values the user saw. */
+void color_state_set_rgb16(const rgb16_t *p_rgb, uint32_t fade_ms);
+void color_state_set_hsv(const hsv_color_t *p_hsv, uint32_t fade_ms);
+
+/* Sets both views of one color, as saved together by storage. */
+void color_state_restore(const rgb16_t *p_rgb, const hsv_color_t *p_hsv, uint32_t fade_ms);
+
+void color_state_get_rgb16(rgb16_t *p_rgb);
+void color_state_get_hsv(hsv_color_t *p_hsv);
+
+/* Shows the state again after the curve or calibration changed. A color set
+ * through HSV follows the new curve; an RGB one keeps its duty cycles. */
+void color_state_refresh(void);
+
+/* HSV to duty cycles through the selected curve, as color_state_set_hsv()
+ * shows it, and back through the inverse curve. */
+void color_from_hsv(const hsv_color_t *p_hsv, rgb16_t *p_rgb);
+void color_to_hsv(const rgb16_t *p_rgb, hsv_color_t *p_hsv);
+
+/* PWM counts, 0..PWM_TOP_VALUE, to the 16-bit state scale and back,
+ * rounded to nearest so a count survives the round trip. */
+uint16_t color_from_counts(uint16_t counts);
+uint16_t color_to_counts(uint16_t value);
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef CURVE_H
+#define CURVE_H
+
+#include <stdint.h>
+
+/* Brightness curves between the 16-bit color and the PWM duty cycle. */
+typedef enum {
+    CURVE_LINEAR,
+    CURVE_GAMMA_22,
+    CURVE_CIE_LSTAR,
+    CURVE_COUNT
+} curve_t;
+
+/* Non-linear curves are tables of CURVE_TABLE_SIZE 16-bit duty cycles,
+ * generated at build time by host/tools/curve_gen.c. Entry i is the curve
+ * at input i << CURVE_INDEX_SHIFT, and an input looks up its nearest entry. */
+#define CURVE_INDEX_SHIFT 4
+#define CURVE_TABLE_SIZE  ((UINT16_MAX >> CURVE_INDEX_SHIFT) + 2)
+
+extern uint16_t const curve_table_gamma_22[CURVE_TABLE_SIZE];
+extern uint16_t const curve_table_cie_lstar[CURVE_TABLE_SIZE];
+
+/* Maps a 16-bit lightness to a 16-bit duty cycle, one table load. */
+uint16_t curve_apply(curve_t curve, uint16_t x);
+
+/* The lightness whose curve value is nearest to duty cycle y, for showing
+ * an RGB color as HSV. A binary search over the table; not for hot paths. */
+uint16_t curve_invert(curve_t curve, uint16_t y);
+
+/* Curve used for colors from the color state; COLOR_CURVE_DEFAULT at boot. */
+void curve_select(curve_t curve);
+curve_t curve_selected(void);
+
+#endif
@@ -0,0 +1,24 @@
+#ifndef DITHER_H
+#define DITHER_H
+
+#include <stdint.h>
+#include "nrfx_pwm.h"
+#include "app_config.h"
+
+/* Dithered duty cycles are carried in 1/DITHER_SCALE PWM counts, so one
+ * dither sequence of PWM_DITHER_PERIODS periods can average to any of them. */
+#define DITHER_SCALE PWM_DITHER_PERIODS
+#define DITHER_MAX   (PWM_TOP_VALUE * DITHER_SCALE)
+
+/* Maps a 16-bit duty cycle, 65535 fully on, to 1/DITHER_SCALE counts. */
+uint16_t dither_from_duty16(uint16_t duty);
+
+/* Spreads *p_target, in 1/DITHER_SCALE counts, over p_sets[0..sets-1] by
+ * first-order sigma-delta: each period gets the whole count or one more, and
+ * the error carries into the next period. The sets add up to the target
+ * times sets / DITHER_SCALE rounded to nearest, so sets == DITHER_SCALE
+ * averages to the target exactly and sets == 1 rounds it. */
+void dither_fill(nrf_pwm_values_individual_t *p_sets, uint16_t sets,
+                 nrf_pwm_values_individual_t const *p_target);
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef FADE_H
+#define FADE_H
+
+#include <stdint.h>
+#include "nrfx_pwm.h"
+
+/* Splits a fade of `periods` PWM periods into at most max_steps ramp steps
+ * that each play for *p_repeats + 1 periods. The total is periods rounded to
+ * a whole number of steps; fades shorter than two periods get one step. */
+void fade_plan(uint32_t periods, uint16_t max_steps, uint16_t *p_steps, uint32_t *p_repeats);
+
+/* Fills p_ramp[0..steps-1] with the linear ramp from *p_from to *p_to,
+ * excluding the start and ending exactly on the target. Step i (1-based)
+ * holds from + (to - from) * i / steps rounded half away from zero. */
+void fade_ramp_build(nrf_pwm_values_individual_t *p_ramp,
+                     nrf_pwm_values_individual_t const *p_from,
+                     nrf_pwm_values_individual_t const *p_to,
+                     uint16_t steps);
+
+#endif
@@ -2,9 +2,72 @@
 #define HSV_H
 
 #include <stdint.h>
+#include <stddef.h>
+#include "app_config.h"
 
+/* HSV with h in degrees, s and v in percent. Both directions work without
+ * run-time division and round once, to nearest, against the exact real
+ * valued conversion with the same integer inputs: RGB channels are within
+ * 0.5 count (0.5 LSB for hsv_to_rgb16()), and h, s and v within 0.5 of
+ * their unit, h wrapping to 0 at 360. With HSV_HUE_LUT the ramp of the hue
+ * is fetched from hsv_hue_ramp instead, which adds up to 0.5 LSB of 16-bit
+ * rounding before the final one: RGB channels are then within one count
+ * (one LSB) of the exact result. */
 void hsv_to_rgb_simple(uint16_t h, uint8_t s, uint8_t v, uint16_t *r, uint16_t *g, uint16_t *b);
 
+/* Same as hsv_to_rgb_simple() but with 16-bit outputs, 65535 for v = 100. */
+void hsv_to_rgb16(uint16_t h, uint8_t s, uint8_t v, uint16_t *r, uint16_t *g, uint16_t *b);
+
+/* 16-bit color, 65535 fully on, packed without padding. */
+typedef struct {
+    uint16_t r;
+    uint16_t g;
+    uint16_t b;
+} rgb16_t;
+
+/* hsv_to_rgb16() for n colors, with identical results for s and v up to
+ * 100. Each channel is v * 6000 - v * s * clamp(min(hh, 240 - hh), 0, 60)
+ * units, hh being h + 300, 180 and 60 for r, g and b wrapped to 0..359, so
+ * there is no sector switch. With the DSP extension two colors are
+ * converted at a time, one per 16-bit half: the hue steps are
+ * USUB16/SSUB16 with SEL and USAT16 on both colors at once, and each
+ * channel is one SMLAD. An odd last color goes through hsv_to_rgb16(). */
+void hsv_to_rgb_batch(const hsv_color_t *p_hsv, rgb16_t *p_rgb, size_t n);
+
+/* Hue and saturation part of a conversion, per percent of v. Brightness-only
+ * changes reuse it: hsv_chroma_apply() is one multiply per channel and
+ * gives exactly what hsv_to_rgb16() gives for the same h, s and v. */
+typedef struct {
+    uint64_t level[3];
+} hsv_chroma_t;
+
+void hsv_chroma_init(hsv_chroma_t *p_chroma, uint16_t h, uint8_t s);
+void hsv_chroma_apply(const hsv_chroma_t *p_chroma, uint8_t v, rgb16_t *p_rgb);
+
+/* Channels above PWM_TOP_VALUE are clamped. */
 void rgb_to_hsv_simple(uint16_t r, uint16_t g, uint16_t b, uint16_t *h, uint8_t *s, uint8_t *v);
 
-#endif
\ No newline at end of file
+/* hsv_recip[d] is 2^HSV_RECIP_SHIFT / d rounded up, generated at build time
+ * by host/tools/hsv_gen.c. Multiplying by it divides exactly, see
+ * HSV_RECIP_MAX_NUM. */
+#define HSV_RECIP_SHIFT   31
+#define HSV_RECIP_SIZE    (PWM_TOP_VALUE + 1)
+#define HSV_RECIP_MAX_NUM (100u * PWM_TOP_VALUE + PWM_TOP_VALUE / 2)
+
+extern uint32_t const hsv_recip[HSV_RECIP_SIZE];
+
+/* hsv_hue_ramp[h] is r, g and b of hue h at full saturation and brightness,
+ * 65535 fully on, rounded. Also generated by hsv_gen, which checks that
+ * conversions through it stay within one count of the arithmetic path. */
+#define HSV_HUE_DEGREES 360
+
+extern uint16_t const hsv_hue_ramp[HSV_HUE_DEGREES][3];
+
+/* n / d rounded to nearest for 1 <= d < HSV_RECIP_SIZE and
+ * n + d / 2 <= HSV_RECIP_MAX_NUM. */
+static inline uint32_t hsv_div_round(uint32_t n, uint32_t d)
+{
+    return (uint32_t)(((uint64_t)(n + (d >> 1)) * hsv_recip[d]) >> HSV_RECIP_SHIFT);
+}
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef ISR_STATS_H
+#define ISR_STATS_H
+
+#include <stdint.h>
+
+/* USBD covers the app_usbd class and state handlers. With the app_usbd event
+ * queue enabled the USBD interrupt only queues events, and these handlers
+ * run from cli_process() in thread context. */
+typedef enum {
+    ISR_STATS_GPIOTE = 0,
+    ISR_STATS_RTC,
+    ISR_STATS_PWM,
+    ISR_STATS_USBD,
+    ISR_STATS_SOURCE_COUNT
+} isr_stats_source_t;
+
+typedef struct {
+    uint32_t count;
+    uint32_t max_cycles;
+} isr_stats_t;
+
+void isr_stats_init(void);
+
+uint32_t isr_stats_begin(void);
+
+void isr_stats_end(isr_stats_source_t source, uint32_t start);
+
+void isr_stats_get(isr_stats_source_t source, isr_stats_t *p_stats);
+
+void isr_stats_reset(void);
+
+uint32_t isr_stats_cycles_to_us(uint32_t cycles);
+
+#endif
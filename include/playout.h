@@ -0,0 +1,43 @@
+#ifndef PLAYOUT_H
+#define PLAYOUT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Jitter buffer for timestamped stream frames. Presentation times are in
+ * the sender's milliseconds; the first frame of a session is shown
+ * STREAM_JITTER_LATENCY_MS after it arrives and the rest keep their spacing
+ * relative to it.
+ *
+ * The sender's clock and RTC1 drift apart, so the mapping follows the
+ * fastest transit, arrival time minus pts, seen in each
+ * STREAM_DRIFT_WINDOW_MS: whenever it has moved against the first window
+ * the mapping moves 1 ms the same way. Jitter only ever adds delay, so the
+ * fastest frame of a window tracks the clocks and not the network. This
+ * follows drift up to 1 ms per window, 1000 ppm with the default. */
+
+typedef struct {
+    uint32_t played;
+    uint32_t late;
+    uint32_t underruns;
+    uint32_t overflows;
+    /* How far the mapping has moved since the session started, in ms; not
+     * cleared by playout_stats_reset(). */
+    int32_t drift_ms;
+} playout_stats_t;
+
+void playout_start(void);
+
+bool playout_push(uint32_t pts_ms, const uint16_t rgb[3], uint32_t now_ms);
+
+/* Drops whatever is still queued and shows the newest frame received.
+ * Returns false if the session carried no frames. */
+bool playout_stop(uint16_t rgb[3]);
+
+void playout_process(uint32_t now_ms);
+
+void playout_stats_get(playout_stats_t *p_stats);
+
+void playout_stats_reset(void);
+
+#endif
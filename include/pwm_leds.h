@@ -2,11 +2,61 @@
 #define PWM_LEDS_H
 
 #include <stdint.h>
+#include <stdbool.h>
 #include "app_config.h"
 
-void pwm_rgb_init(void);
-void pwm_indicator_init(void);
-void pwm_set_rgb_values(uint16_t r, uint16_t g, uint16_t b);
-void pwm_set_indicator_value(uint16_t value);
+/* Sets up PWM0 for LD2 on channels 0-2 and LD1 on channel 3. The PWM only
+ * runs, and only holds an HFCLK request, while some channel is lit. */
+void pwm_leds_init(void);
+
+/* Stages a color for the RGB LED, 0 to PWM_TOP_VALUE per channel, and
+ * returns its update number. The color starts playing at the beginning of a
+ * PWM period, at the latest two periods later; no period mixes it with the
+ * previous one. It is played in whole counts even after the calibration, so
+ * it never waits for a dither sequence. All calls take colors before the LD2
+ * calibration set with color_correct_set(). Staging the color already staged,
+ * with the same fade length, writes nothing and returns its update number;
+ * a plain set of the color a staged fade heads for replaces the fade. */
+uint32_t pwm_set_rgb_values(uint16_t r, uint16_t g, uint16_t b);
+
+/* Like pwm_set_rgb_values() but moves linearly from the current color to the
+ * new one over fade_ms, played from a PWM sequence without CPU involvement.
+ * The update counts as live once the fade has reached the new color. A color
+ * set while a fade runs is applied when the fade ends. */
+uint32_t pwm_fade_rgb(uint16_t r, uint16_t g, uint16_t b, uint32_t fade_ms);
+
+/* Like pwm_set_rgb_values() and pwm_fade_rgb() but with 16-bit duty cycles,
+ * 65535 fully on. In dithered mode a sub-count part is played by spreading
+ * it over PWM_DITHER_PERIODS periods; otherwise it is rounded to a count.
+ * A dithered color, and the one after it, can take up to two dither
+ * sequences, 2 * PWM_DITHER_PERIODS periods, to start playing. */
+uint32_t pwm_set_rgb16(uint16_t r, uint16_t g, uint16_t b);
+uint32_t pwm_fade_rgb16(uint16_t r, uint16_t g, uint16_t b, uint32_t fade_ms);
+
+/* Switches dithered mode, on by default, and returns the update number under
+ * which the current color is replayed in the new mode. */
+uint32_t pwm_set_dither(bool enable);
+bool pwm_dither_enabled(void);
+
+/* Update number of the color playing now, and whether an update returned by
+ * pwm_set_rgb_values() (or a later one) has reached the LED. */
+uint32_t pwm_rgb_live_update(void);
+bool pwm_rgb_is_live(uint32_t update);
+
+typedef enum {
+    PWM_INDICATOR_OFF,
+    PWM_INDICATOR_SLOW_BLINK,
+    PWM_INDICATOR_FAST_BLINK,
+    PWM_INDICATOR_SOLID,
+    PWM_INDICATOR_BREATHING,
+    PWM_INDICATOR_PATTERN_COUNT
+} pwm_indicator_pattern_t;
+
+/* Switches LD1 to a pattern. Timed patterns are advanced by the PWM0
+ * SEQEND handler at most every 4 periods, or every dither sequence in
+ * dithered mode, where steps also round to whole sequences; off and solid
+ * need no CPU. Selecting the pattern that is already playing keeps its
+ * phase. */
+void pwm_indicator_set_pattern(pwm_indicator_pattern_t pattern);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,20 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef enum {
+    SCHED_BUTTON = 0,
+    SCHED_STORAGE,
+    SCHED_PLAYOUT,
+    SCHED_SLOT_COUNT
+} sched_slot_t;
+
+void sched_set(sched_slot_t slot, uint32_t deadline_ms);
+
+void sched_clear(sched_slot_t slot);
+
+bool sched_next(uint32_t now_ms, uint32_t *p_deadline_ms);
+
+#endif
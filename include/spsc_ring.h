@@ -0,0 +1,163 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+/* Single-producer/single-consumer ring of fixed-size elements.
+ *
+ * head and tail run freely and are masked on access, so the full capacity
+ * is usable and the fill level is head - tail. Only the producer writes
+ * head, high_water and dropped; only the consumer writes tail. Each side
+ * publishes its index with a release store after touching the slots and
+ * reads the other side's index with an acquire load, which on Cortex-M4
+ * becomes a DMB around the access and on the host a real atomic. The
+ * producer may run in an interrupt while the consumer runs in thread
+ * context, or the other way round. */
+typedef struct {
+    void * const p_buf;
+    uint16_t const elem_size;
+    uint32_t const mask;
+    uint32_t head;
+    uint32_t tail;
+    uint32_t high_water;
+    uint32_t dropped;
+} spsc_ring_t;
+
+/* Defines a ring of _size elements of _type. _size must be a power of two. */
+#define SPSC_RING_DEF(_name, _type, _size)                                      \
+    _Static_assert(((_size) & ((_size) - 1)) == 0 && (_size) > 0,               \
+                   #_name " size must be a power of two");                     \
+    static _type _name##_data[_size];                                           \
+    static spsc_ring_t _name = {                                                \
+        .p_buf = _name##_data,                                                  \
+        .elem_size = sizeof(_type),                                             \
+        .mask = (_size) - 1,                                                    \
+    }
+
+static inline uint32_t spsc_ring_capacity(spsc_ring_t const *p_ring)
+{
+    return p_ring->mask + 1;
+}
+
+static inline uint32_t spsc_ring_used(spsc_ring_t const *p_ring)
+{
+    uint32_t head = __atomic_load_n(&p_ring->head, __ATOMIC_ACQUIRE);
+    uint32_t tail = __atomic_load_n(&p_ring->tail, __ATOMIC_ACQUIRE);
+    return head - tail;
+}
+
+static inline uint32_t spsc_ring_free(spsc_ring_t const *p_ring)
+{
+    return spsc_ring_capacity(p_ring) - spsc_ring_used(p_ring);
+}
+
+static inline bool spsc_ring_is_empty(spsc_ring_t const *p_ring)
+{
+    return spsc_ring_used(p_ring) == 0;
+}
+
+/* Copies count elements between the ring and a flat buffer, starting at
+ * ring index pos and wrapping at the end of the storage. */
+static inline void spsc_ring_copy_out(spsc_ring_t const *p_ring, uint32_t pos, void *p_dst, uint32_t count)
+{
+    uint32_t start = pos & p_ring->mask;
+    uint32_t first = spsc_ring_capacity(p_ring) - start;
+    if (first > count) first = count;
+
+    uint8_t const *p_buf = p_ring->p_buf;
+    memcpy(p_dst, p_buf + start * p_ring->elem_size, first * p_ring->elem_size);
+    memcpy((uint8_t *)p_dst + first * p_ring->elem_size, p_buf, (count - first) * p_ring->elem_size);
+}
+
+static inline void spsc_ring_copy_in(spsc_ring_t *p_ring, uint32_t pos, void const *p_src, uint32_t count)
+{
+    uint32_t start = pos & p_ring->mask;
+    uint32_t first = spsc_ring_capacity(p_ring) - start;
+    if (first > count) first = count;
+
+    uint8_t *p_buf = p_ring->p_buf;
+    memcpy(p_buf + start * p_ring->elem_size, p_src, first * p_ring->elem_size);
+    memcpy(p_buf, (uint8_t const *)p_src + first * p_ring->elem_size, (count - first) * p_ring->elem_size);
+}
+
+/* Producer side. Stores as many of the count elements as fit and returns
+ * how many that was; the rest is added to the dropped counter. */
+static inline uint32_t spsc_ring_put(spsc_ring_t *p_ring, void const *p_src, uint32_t count)
+{
+    uint32_t head = p_ring->head;
+    uint32_t tail = __atomic_load_n(&p_ring->tail, __ATOMIC_ACQUIRE);
+    uint32_t space = spsc_ring_capacity(p_ring) - (head - tail);
+
+    if (count > space) {
+        p_ring->dropped += count - space;
+        count = space;
+    }
+    if (count == 0) return 0;
+
+    spsc_ring_copy_in(p_ring, head, p_src, count);
+    __atomic_store_n(&p_ring->head, head + count, __ATOMIC_RELEASE);
+
+    uint32_t used = head + count - tail;
+    if (used > p_ring->high_water) {
+        p_ring->high_water = used;
+    }
+    return count;
+}
+
+/* Producer side. Stores all count elements or, if they do not fit, none of
+ * them, and adds them to the dropped counter. */
+static inline bool spsc_ring_put_all(spsc_ring_t *p_ring, void const *p_src, uint32_t count)
+{
+    uint32_t tail = __atomic_load_n(&p_ring->tail, __ATOMIC_ACQUIRE);
+
+    if (count > spsc_ring_capacity(p_ring) - (p_ring->head - tail)) {
+        p_ring->dropped += count;
+        return false;
+    }
+    return spsc_ring_put(p_ring, p_src, count) == count;
+}
+
+/* Producer side, since the producer owns both counters. */
+static inline void spsc_ring_stats_reset(spsc_ring_t *p_ring)
+{
+    p_ring->high_water = p_ring->head - __atomic_load_n(&p_ring->tail, __ATOMIC_ACQUIRE);
+    p_ring->dropped = 0;
+}
+
+/* Consumer side. Copies up to count elements without removing them. */
+static inline uint32_t spsc_ring_peek(spsc_ring_t const *p_ring, void *p_dst, uint32_t count)
+{
+    uint32_t tail = p_ring->tail;
+    uint32_t head = __atomic_load_n(&p_ring->head, __ATOMIC_ACQUIRE);
+
+    if (count > head - tail) {
+        count = head - tail;
+    }
+    if (count > 0) {
+        spsc_ring_copy_out(p_ring, tail, p_dst, count);
+    }
+    return count;
+}
+
+/* Consumer side. Releases up to count elements back to the producer. */
+static inline uint32_t spsc_ring_skip(spsc_ring_t *p_ring, uint32_t count)
+{
+    uint32_t tail = p_ring->tail;
+    uint32_t head = __atomic_load_n(&p_ring->head, __ATOMIC_ACQUIRE);
+
+    if (count > head - tail) {
+        count = head - tail;
+    }
+    __atomic_store_n(&p_ring->tail, tail + count, __ATOMIC_RELEASE);
+    return count;
+}
+
+static inline uint32_t spsc_ring_get(spsc_ring_t *p_ring, void *p_dst, uint32_t count)
+{
+    count = spsc_ring_peek(p_ring, p_dst, count);
+    return spsc_ring_skip(p_ring, count);
+}
+
+#endif
@@ -2,18 +2,32 @@
 #define STORAGE_H
 
 #include "app_config.h"
+#include "color_correct.h"
+#include "hsv.h"
 #include <stdbool.h>
 
 void storage_init(void);
 
-void storage_save_current_hsv(const hsv_color_t *hsv);
+/* Colors are kept as 16-bit RGB duty cycles together with their HSV view.
+ * Records saved before the RGB was stored read back with it converted from
+ * the HSV through the brightness curve, as color_state_set_hsv() shows it. */
+void storage_save_current(const rgb16_t *p_rgb, const hsv_color_t *p_hsv);
 
-bool storage_get_last_hsv(hsv_color_t *hsv);
+bool storage_get_last(rgb16_t *p_rgb, hsv_color_t *p_hsv);
 
-bool storage_add_color(const char *name, const hsv_color_t *hsv);
+bool storage_add_color(const char *name, const rgb16_t *p_rgb, const hsv_color_t *p_hsv);
 bool storage_del_color(const char *name);
-bool storage_get_color(const char *name, hsv_color_t *hsv);
+bool storage_get_color(const char *name, rgb16_t *p_rgb, hsv_color_t *p_hsv);
 
-void storage_list_colors(void (*print_func)(const char *fmt, ...));
+/* Prints the saved colors, stopping early once print_func returns false. */
+void storage_list_colors(bool (*print_func)(const char *fmt, ...));
+
+/* LD2 calibration; records saved before it existed read as the default. */
+void storage_save_calibration(const color_calib_t *p_calib);
+void storage_get_calibration(color_calib_t *p_calib);
+
+/* Advances a pending flash update by one erase slice or write chunk.
+ * Returns true while more work remains. */
+bool storage_process(void);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,59 @@
+#ifndef STREAM_H
+#define STREAM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "app_config.h"
+
+/* Binary color stream. Each frame is COBS encoded and terminated by 0x00;
+ * decoded it reads
+ *
+ *   type(1) seq(2, LE) payload crc(2, LE)
+ *
+ * with the CRC-16/CCITT-FALSE of type, seq and payload. */
+#define STREAM_MAX_FRAME 16
+
+typedef enum {
+    STREAM_FRAME_RGB  = 0x01,   /* r, g, b: uint16 LE, 0..PWM_TOP_VALUE */
+    STREAM_FRAME_HSV  = 0x02,   /* h: uint16 LE 0..360, s, v: uint8 0..100 */
+    STREAM_FRAME_RGB_AT = 0x03, /* pts: uint32 LE ms, then r, g, b as RGB */
+    STREAM_FRAME_EXIT = 0x7F    /* no payload, back to the text CLI */
+} stream_frame_type_t;
+
+typedef struct {
+    stream_frame_type_t type;
+    uint16_t seq;
+    uint32_t pts;
+    union {
+        struct {
+            uint16_t r;
+            uint16_t g;
+            uint16_t b;
+        } rgb;
+        hsv_color_t hsv;
+    };
+} stream_frame_t;
+
+typedef struct {
+    uint32_t frames;
+    uint32_t crc_errors;
+    uint32_t malformed;
+    uint32_t lost;
+    uint32_t out_of_order;
+} stream_stats_t;
+
+/* Starts a new session: the decoder is cleared and the next sequence number
+ * is taken as is. Counters are kept. */
+void stream_reset(void);
+
+/* Feeds one byte. Returns true when it completes a valid, in-order frame. */
+bool stream_rx_byte(uint8_t byte, stream_frame_t *p_frame);
+
+void stream_stats_get(stream_stats_t *p_stats);
+
+void stream_stats_reset(void);
+
+uint16_t stream_crc16(const uint8_t *p_data, size_t len);
+
+#endif
@@ -0,0 +1,14 @@
+#ifndef TIMEBASE_H
+#define TIMEBASE_H
+
+#include <stdint.h>
+
+void timebase_init(void);
+
+uint32_t timebase_millis(void);
+
+void timebase_sleep(void);
+
+void timebase_sleep_until(uint32_t deadline_ms);
+
+#endif
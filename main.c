@@ -1,77 +1,36 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include "nrf_delay.h"
-#include "nrfx_gpiote.h"
 #include "app_config.h"
 #include "hsv.h"
 #include "pwm_leds.h"
+#include "color_state.h"
 #include "button.h"
 #include "storage.h"
 #include "usb_cli.h"
+#include "timebase.h"
+#include "scheduler.h"
+#include "isr_stats.h"
+#include "playout.h"
 #include "nrf_drv_clock.h"
 #include "nrfx_power.h"
 
-static volatile input_mode_t current_mode = MODE_NO_INPUT;
-hsv_color_t current_hsv;
-
-static volatile uint32_t last_button_time = 0;
-static volatile uint32_t first_click_time = 0;
-static volatile bool waiting_for_second_click = false;
-static volatile uint32_t system_ticks = 0;
-static uint32_t last_mode_blink_time = 0;
-static uint32_t last_value_change_time = 0;
-static bool mode_led_state = false;
+static input_mode_t current_mode = MODE_NO_INPUT;
 
 static uint32_t millis(void)
 {
-    return system_ticks;
-}
-
-void update_rgb_led(void)
-{
-    uint16_t r, g, b;
-    hsv_to_rgb_simple(current_hsv.h, current_hsv.s, current_hsv.v, &r, &g, &b);
-    pwm_set_rgb_values(r, g, b);
-}
-
-void update_hsv_state(hsv_color_t new_hsv)
-{
-    current_hsv = new_hsv;
-    update_rgb_led();
+    return timebase_millis();
 }
 
 static void update_mode_indicator(void)
 {
-    uint32_t current_time = millis();
-    uint32_t blink_interval;
-    
-    switch (current_mode) {
-        case MODE_NO_INPUT:
-            pwm_set_indicator_value(0);
-            break;
-            
-        case MODE_HUE:
-            blink_interval = MODE_BLINK_SLOW_MS;
-            if (current_time - last_mode_blink_time >= blink_interval) {
-                mode_led_state = !mode_led_state;
-                pwm_set_indicator_value(mode_led_state ? PWM_TOP_VALUE : 0);
-                last_mode_blink_time = current_time;
-            }
-            break;
-            
-        case MODE_SATURATION:
-            blink_interval = MODE_BLINK_FAST_MS;
-            if (current_time - last_mode_blink_time >= blink_interval) {
-                mode_led_state = !mode_led_state;
-                pwm_set_indicator_value(mode_led_state ? PWM_TOP_VALUE : 0);
-                last_mode_blink_time = current_time;
-            }
-            break;
-            
-        case MODE_BRIGHTNESS:
-            pwm_set_indicator_value(PWM_TOP_VALUE);
-            break;
-    }
+    static const pwm_indicator_pattern_t patterns[] = {
+        [MODE_NO_INPUT]   = PWM_INDICATOR_OFF,
+        [MODE_HUE]        = PWM_INDICATOR_SLOW_BLINK,
+        [MODE_SATURATION] = PWM_INDICATOR_FAST_BLINK,
+        [MODE_BRIGHTNESS] = PWM_INDICATOR_SOLID,
+    };
+    pwm_indicator_set_pattern(patterns[current_mode]);
 }
 
 static void switch_to_next_mode(void)
@@ -79,67 +38,63 @@ static void switch_to_next_mode(void)
     current_mode = (input_mode_t)((current_mode + 1) % 4);
     
     if (current_mode == MODE_NO_INPUT) {
-        storage_save_current_hsv(&current_hsv);
+        rgb16_t rgb;
+        hsv_color_t hsv;
+        color_state_get_rgb16(&rgb);
+        color_state_get_hsv(&hsv);
+        storage_save_current(&rgb, &hsv);
     }
 
-    last_mode_blink_time = millis();
-    mode_led_state = false;
     update_mode_indicator();
 }
 
-static void handle_value_change(void)
+static void handle_value_change(uint16_t steps)
 {
-    bool is_button_pressed = (nrf_gpio_pin_read(BUTTON_PIN) == 0);
-    
-    if (!is_button_pressed || current_mode == MODE_NO_INPUT) {
-        return;
-    }
-    
-    uint32_t current_time = millis();
-    if (current_time - last_value_change_time < VALUE_CHANGE_INTERVAL_MS) {
-        return;
-    }
-    last_value_change_time = current_time;
-    
+    hsv_color_t hsv;
+    color_state_get_hsv(&hsv);
+
     switch (current_mode) {
         case MODE_HUE:
-            current_hsv.h = (current_hsv.h + 1) % 360;
+            hsv.h = (hsv.h + steps) % 360;
             break;
         case MODE_SATURATION:
-            current_hsv.s = (current_hsv.s + 1) % 101;
+            hsv.s = (hsv.s + steps) % 101;
             break;
         case MODE_BRIGHTNESS:
-            current_hsv.v = (current_hsv.v + 1) % 101;
+            hsv.v = (hsv.v + steps) % 101;
             break;
         default:
-            break;
+            return;
     }
     
-    update_rgb_led();
+    color_state_set_hsv(&hsv, 0);
 }
 
-void button_event_handler(nrfx_gpiote_pin_t pin, nrf_gpiote_polarity_t action)
+static void handle_button_events(uint32_t current_time)
 {
-    if (pin != BUTTON_PIN) return;
-    
-    uint32_t current_time = millis();
-    
-    if (current_time - last_button_time < DEBOUNCE_MS) {
-        return;
-    }
-    last_button_time = current_time;
+    button_evt_t evt;
+
+    button_process(current_time);
     
-    if (waiting_for_second_click) {
-        if (current_time - first_click_time < DOUBLE_CLICK_TIMEOUT_MS) {
-            waiting_for_second_click = false;
-            switch_to_next_mode();
-        } else {
-            first_click_time = current_time;
-            waiting_for_second_click = true;
+    while (button_event_get(&evt)) {
+        switch (evt.type) {
+            case BUTTON_EVT_DOUBLE_CLICK:
+                switch_to_next_mode();
+                break;
+            case BUTTON_EVT_HOLD_START:
+            case BUTTON_EVT_HOLD_REPEAT:
+                handle_value_change(evt.steps);
+                break;
+            default:
+                break;
         }
+    }
+
+    uint32_t deadline;
+    if (button_next_deadline(&deadline)) {
+        sched_set(SCHED_BUTTON, deadline);
     } else {
-        first_click_time = current_time;
-        waiting_for_second_click = true;
+        sched_clear(SCHED_BUTTON);
     }
 }
 
@@ -154,44 +109,61 @@ int main(void)
     }
     nrf_drv_clock_hfclk_request(NULL);
     while(!nrf_drv_clock_hfclk_is_running()) {}
+    while(!nrf_drv_clock_lfclk_is_running()) {}
+
+    isr_stats_init();
+    timebase_init();
 
-    pwm_rgb_init();
-    pwm_indicator_init();
-    button_init(button_event_handler);
+    pwm_leds_init();
+    button_init();
     
     storage_init();
+
+    color_calib_t calib;
+    storage_get_calibration(&calib);
+    color_correct_set(&calib);
     
-    if (!storage_get_last_hsv(&current_hsv)) {
-        current_hsv.h = (DEFAULT_HUE_PERCENT * 360) / 100;
-        current_hsv.s = 100;
-        current_hsv.v = 100;
+    rgb16_t last_rgb;
+    hsv_color_t last_hsv;
+    if (storage_get_last(&last_rgb, &last_hsv)) {
+        color_state_restore(&last_rgb, &last_hsv, 0);
+    } else {
+        last_hsv.h = (DEFAULT_HUE_PERCENT * 360) / 100;
+        last_hsv.s = 100;
+        last_hsv.v = 100;
+        color_state_set_hsv(&last_hsv, 0);
     }
-    update_rgb_led();
 
     cli_init();
+    /* PWM0 and USBD hold their own HFCLK requests while they run, so the
+     * crystal can stop once the LEDs are dark and USB is suspended. */
+    nrf_drv_clock_hfclk_release();
 
     pwm_set_rgb_values(PWM_TOP_VALUE, PWM_TOP_VALUE, PWM_TOP_VALUE);
-    pwm_set_indicator_value(PWM_TOP_VALUE);
+    pwm_indicator_set_pattern(PWM_INDICATOR_SOLID);
     nrf_delay_ms(200);
     
-    update_rgb_led();
-    pwm_set_indicator_value(0);
-    
-    system_ticks = 0;
+    color_state_refresh();
+    update_mode_indicator();
     
     while (true) {
         cli_process();
-        update_mode_indicator();
-        handle_value_change();
-        
-        if (waiting_for_second_click) {
-            uint32_t current_time = millis();
-            if (current_time - first_click_time >= DOUBLE_CLICK_TIMEOUT_MS) {
-                waiting_for_second_click = false;
-            }
+
+        uint32_t current_time = millis();
+        handle_button_events(current_time);
+        playout_process(current_time);
+
+        if (storage_process()) {
+            sched_set(SCHED_STORAGE, current_time);
+        } else {
+            sched_clear(SCHED_STORAGE);
         }
         
-        nrf_delay_ms(1);
-        system_ticks++;
+        uint32_t deadline;
+        if (sched_next(current_time, &deadline)) {
+            timebase_sleep_until(deadline);
+        } else {
+            timebase_sleep();
+        }
     }
 }
\ No newline at end of file
@@ -1,8 +1,179 @@
 #include "button.h"
 #include "app_config.h"
+#include "timebase.h"
+#include "isr_stats.h"
+#include "spsc_ring.h"
+#include "nrf.h"
 #include "nrfx_gpiote.h"
 
-void button_init(button_handler_t handler)
+#define BUTTON_EDGE_QUEUE_SIZE  16
+#define BUTTON_EVT_QUEUE_SIZE   16
+
+typedef enum {
+    BUTTON_STATE_IDLE = 0,
+    BUTTON_STATE_PRESSED,
+    BUTTON_STATE_HOLDING,
+    BUTTON_STATE_WAIT_SECOND
+} button_state_t;
+
+typedef struct {
+    uint32_t time_ms;
+    bool pressed;
+} button_edge_t;
+
+SPSC_RING_DEF(m_edges, button_edge_t, BUTTON_EDGE_QUEUE_SIZE);
+SPSC_RING_DEF(m_events, button_evt_t, BUTTON_EVT_QUEUE_SIZE);
+
+/* Set by the producer when the edge queue was full. */
+static bool m_edges_lost = false;
+
+static button_state_t m_state = BUTTON_STATE_IDLE;
+static bool m_raw_pressed = false;
+static bool m_stable_pressed = false;
+static bool m_after_double = false;
+static uint32_t m_first_press_time;
+static uint32_t m_hold_start_time;
+
+static bool m_lockout_armed = false;
+static uint32_t m_lockout_end;
+static bool m_timer_armed = false;
+static uint32_t m_timer_deadline;
+
+static bool time_reached(uint32_t deadline, uint32_t now)
+{
+    return (int32_t)(now - deadline) >= 0;
+}
+
+static void event_put(button_evt_type_t type, uint16_t steps, uint32_t time_ms)
+{
+    button_evt_t evt = { .type = type, .steps = steps, .time_ms = time_ms };
+    spsc_ring_put(&m_events, &evt, 1);
+}
+
+static void timer_start(uint32_t deadline)
+{
+    m_timer_deadline = deadline;
+    m_timer_armed = true;
+}
+
+static void on_press(uint32_t time_ms)
+{
+    switch (m_state) {
+        case BUTTON_STATE_IDLE:
+            m_first_press_time = time_ms;
+            m_after_double = false;
+            break;
+        case BUTTON_STATE_WAIT_SECOND:
+            event_put(BUTTON_EVT_DOUBLE_CLICK, 0, time_ms);
+            m_after_double = true;
+            break;
+        default:
+            return;
+    }
+    m_state = BUTTON_STATE_PRESSED;
+    timer_start(time_ms + BUTTON_HOLD_DELAY_MS);
+}
+
+static void on_release(uint32_t time_ms)
+{
+    switch (m_state) {
+        case BUTTON_STATE_PRESSED:
+            if (m_after_double) {
+                m_state = BUTTON_STATE_IDLE;
+                m_timer_armed = false;
+            } else {
+                m_state = BUTTON_STATE_WAIT_SECOND;
+                timer_start(m_first_press_time + DOUBLE_CLICK_TIMEOUT_MS);
+            }
+            break;
+        case BUTTON_STATE_HOLDING:
+            event_put(BUTTON_EVT_RELEASE, 0, time_ms);
+            m_state = BUTTON_STATE_IDLE;
+            m_timer_armed = false;
+            break;
+        default:
+            break;
+    }
+}
+
+/* Holding repeats every VALUE_CHANGE_INTERVAL_MS; the step grows by one every
+ * BUTTON_ACCEL_PERIOD_MS, so a full hue sweep takes about two seconds. */
+static void on_timer(uint32_t time_ms)
+{
+    uint32_t steps;
+
+    switch (m_state) {
+        case BUTTON_STATE_PRESSED:
+            m_state = BUTTON_STATE_HOLDING;
+            m_hold_start_time = time_ms;
+            event_put(BUTTON_EVT_HOLD_START, 1, time_ms);
+            timer_start(time_ms + VALUE_CHANGE_INTERVAL_MS);
+            break;
+        case BUTTON_STATE_HOLDING:
+            steps = 1 + (time_ms - m_hold_start_time) / BUTTON_ACCEL_PERIOD_MS;
+            if (steps > BUTTON_REPEAT_MAX_STEPS) {
+                steps = BUTTON_REPEAT_MAX_STEPS;
+            }
+            event_put(BUTTON_EVT_HOLD_REPEAT, (uint16_t)steps, time_ms);
+            timer_start(time_ms + VALUE_CHANGE_INTERVAL_MS);
+            break;
+        case BUTTON_STATE_WAIT_SECOND:
+            event_put(BUTTON_EVT_CLICK, 0, m_first_press_time);
+            m_state = BUTTON_STATE_IDLE;
+            m_timer_armed = false;
+            break;
+        default:
+            m_timer_armed = false;
+            break;
+    }
+}
+
+static void commit(bool pressed, uint32_t time_ms)
+{
+    m_stable_pressed = pressed;
+    m_lockout_armed = true;
+    m_lockout_end = time_ms + DEBOUNCE_MS;
+
+    if (pressed) {
+        on_press(time_ms);
+    } else {
+        on_release(time_ms);
+    }
+}
+
+/* Leading-edge debounce: the first edge is taken at once, further edges are
+ * only recorded until the lockout ends, then the final level is committed. */
+static void on_edge(button_edge_t const *p_edge)
+{
+    m_raw_pressed = p_edge->pressed;
+    if (!m_lockout_armed && m_raw_pressed != m_stable_pressed) {
+        commit(m_raw_pressed, p_edge->time_ms);
+    }
+}
+
+static void on_lockout_end(uint32_t time_ms)
+{
+    m_lockout_armed = false;
+    if (m_raw_pressed != m_stable_pressed) {
+        commit(m_raw_pressed, time_ms);
+    }
+}
+
+static bool pin_pressed(void)
+{
+    return nrf_gpio_pin_read(BUTTON_PIN) == 0;
+}
+
+static void gpiote_event_handler(nrfx_gpiote_pin_t pin, nrf_gpiote_polarity_t action)
+{
+    if (pin != BUTTON_PIN) return;
+
+    uint32_t start = isr_stats_begin();
+    button_edge(pin_pressed(), timebase_millis());
+    isr_stats_end(ISR_STATS_GPIOTE, start);
+}
+
+void button_init(void)
 {
     nrfx_err_t err_code;
     
@@ -15,12 +186,76 @@ void button_init(button_handler_t handler)
     
     nrf_gpio_cfg_input(BUTTON_PIN, NRF_GPIO_PIN_PULLUP);
     
-    nrfx_gpiote_in_config_t button_config = NRFX_GPIOTE_CONFIG_IN_SENSE_HITOLO(true);
+    nrfx_gpiote_in_config_t button_config = NRFX_GPIOTE_CONFIG_IN_SENSE_TOGGLE(false);
     button_config.pull = NRF_GPIO_PIN_PULLUP;
     
-    err_code = nrfx_gpiote_in_init(BUTTON_PIN, &button_config, handler);
+    err_code = nrfx_gpiote_in_init(BUTTON_PIN, &button_config, gpiote_event_handler);
     
     if (err_code == NRFX_SUCCESS) {
         nrfx_gpiote_in_event_enable(BUTTON_PIN, true);
     }
-}
\ No newline at end of file
+}
+
+/* Single producer (GPIOTE ISR), single consumer (button_process). An edge
+ * that does not fit is only flagged; button_process() reads the pin once
+ * the queue has drained. */
+void button_edge(bool pressed, uint32_t time_ms)
+{
+    button_edge_t edge = { .time_ms = time_ms, .pressed = pressed };
+    if (spsc_ring_put(&m_edges, &edge, 1) == 0) {
+        __atomic_store_n(&m_edges_lost, true, __ATOMIC_RELEASE);
+    }
+}
+
+bool button_next_deadline(uint32_t *p_deadline_ms)
+{
+    if (m_lockout_armed && m_timer_armed) {
+        bool lockout_first = (int32_t)(m_lockout_end - m_timer_deadline) <= 0;
+        *p_deadline_ms = lockout_first ? m_lockout_end : m_timer_deadline;
+    } else if (m_lockout_armed) {
+        *p_deadline_ms = m_lockout_end;
+    } else if (m_timer_armed) {
+        *p_deadline_ms = m_timer_deadline;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+/* Edges and timers are handled strictly in time order, with a timer that
+ * expires at the same millisecond as an edge going first. After an overflow
+ * the edges that were lost are replaced by the current pin level at now_ms,
+ * so a dropped release cannot leave the state machine holding. */
+void button_process(uint32_t now_ms)
+{
+    for (;;) {
+        uint32_t deadline;
+        bool timer_due = button_next_deadline(&deadline) && time_reached(deadline, now_ms);
+        button_edge_t edge;
+        bool edge_pending = spsc_ring_peek(&m_edges, &edge, 1) == 1 &&
+                            time_reached(edge.time_ms, now_ms);
+
+        if (timer_due && (!edge_pending || time_reached(deadline, edge.time_ms))) {
+            if (m_lockout_armed && m_lockout_end == deadline) {
+                on_lockout_end(deadline);
+            } else {
+                on_timer(deadline);
+            }
+        } else if (edge_pending) {
+            spsc_ring_skip(&m_edges, 1);
+            on_edge(&edge);
+        } else if (spsc_ring_is_empty(&m_edges) &&
+                   __atomic_exchange_n(&m_edges_lost, false, __ATOMIC_ACQ_REL)) {
+            edge.time_ms = now_ms;
+            edge.pressed = pin_pressed();
+            on_edge(&edge);
+        } else {
+            break;
+        }
+    }
+}
+
+bool button_event_get(button_evt_t *p_evt)
+{
+    return spsc_ring_get(&m_events, p_evt, 1) == 1;
+}
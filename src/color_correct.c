@@ -0,0 +1,62 @@
+#include "color_correct.h"
+#include <string.h>
+
+#define CALIB_DEFAULT {                                      \
+    .matrix = { { COLOR_Q15_ONE, 0, 0 },                     \
+                { 0, COLOR_Q15_ONE, 0 },                     \
+                { 0, 0, COLOR_Q15_ONE } },                   \
+    .gain = { COLOR_Q15_ONE, COLOR_Q15_ONE, COLOR_Q15_ONE }  \
+}
+
+static color_calib_t const m_default = CALIB_DEFAULT;
+static color_calib_t m_calib = CALIB_DEFAULT;
+/* Gains folded into the matrix, so a conversion is nine multiplies. */
+static int16_t m_effective[3][3];
+static bool m_identity = true;
+
+void color_correct_default(color_calib_t *p_calib)
+{
+    *p_calib = m_default;
+}
+
+void color_correct_set(const color_calib_t *p_calib)
+{
+    m_calib = *p_calib;
+    m_identity = memcmp(&m_calib, &m_default, sizeof(m_default)) == 0;
+
+    for (uint8_t i = 0; i < 3; i++) {
+        for (uint8_t j = 0; j < 3; j++) {
+            int32_t product = (int32_t)m_calib.gain[i] * m_calib.matrix[i][j];
+            m_effective[i][j] = (int16_t)((product + (1 << 14)) >> 15);
+        }
+    }
+}
+
+void color_correct_get(color_calib_t *p_calib)
+{
+    *p_calib = m_calib;
+}
+
+static uint16_t clamp_q15(int32_t sum, uint16_t max)
+{
+    if (sum <= 0) {
+        return 0;
+    }
+    uint32_t value = ((uint32_t)sum + (1u << 14)) >> 15;
+    return value > max ? max : (uint16_t)value;
+}
+
+void color_correct_apply(uint16_t *p_r, uint16_t *p_g, uint16_t *p_b, uint16_t max)
+{
+    if (m_identity) {
+        return;
+    }
+
+    int32_t r = *p_r;
+    int32_t g = *p_g;
+    int32_t b = *p_b;
+
+    *p_r = clamp_q15(m_effective[0][0] * r + m_effective[0][1] * g + m_effective[0][2] * b, max);
+    *p_g = clamp_q15(m_effective[1][0] * r + m_effective[1][1] * g + m_effective[1][2] * b, max);
+    *p_b = clamp_q15(m_effective[2][0] * r + m_effective[2][1] * g + m_effective[2][2] * b, max);
+}
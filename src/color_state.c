@@ -0,0 +1,120 @@
+#include "color_state.h"
+#include "curve.h"
+#include "pwm_leds.h"
+#include <stdbool.h>
+
+static rgb16_t m_rgb;
+static hsv_color_t m_hsv;
+static bool m_hsv_valid = false;
+/* Whether m_rgb was made from m_hsv, so a new curve has to redo it. */
+static bool m_from_hsv = false;
+
+/* Chroma of the last converted hue and saturation, so holding the button
+ * in MODE_BRIGHTNESS only rescales it. */
+static hsv_chroma_t m_chroma;
+static bool m_chroma_valid = false;
+static uint16_t m_chroma_h;
+static uint8_t m_chroma_s;
+
+uint16_t color_from_counts(uint16_t counts)
+{
+    return (uint16_t)(((uint32_t)counts * UINT16_MAX + PWM_TOP_VALUE / 2) / PWM_TOP_VALUE);
+}
+
+uint16_t color_to_counts(uint16_t value)
+{
+    return (uint16_t)(((uint32_t)value * PWM_TOP_VALUE + UINT16_MAX / 2) / UINT16_MAX);
+}
+
+static void curve_rgb(rgb16_t *p_rgb)
+{
+    curve_t curve = curve_selected();
+
+    p_rgb->r = curve_apply(curve, p_rgb->r);
+    p_rgb->g = curve_apply(curve, p_rgb->g);
+    p_rgb->b = curve_apply(curve, p_rgb->b);
+}
+
+void color_from_hsv(const hsv_color_t *p_hsv, rgb16_t *p_rgb)
+{
+    hsv_to_rgb16(p_hsv->h, p_hsv->s, p_hsv->v, &p_rgb->r, &p_rgb->g, &p_rgb->b);
+    curve_rgb(p_rgb);
+}
+
+void color_to_hsv(const rgb16_t *p_rgb, hsv_color_t *p_hsv)
+{
+    curve_t curve = curve_selected();
+
+    rgb_to_hsv_simple(color_to_counts(curve_invert(curve, p_rgb->r)),
+                      color_to_counts(curve_invert(curve, p_rgb->g)),
+                      color_to_counts(curve_invert(curve, p_rgb->b)),
+                      &p_hsv->h, &p_hsv->s, &p_hsv->v);
+}
+
+static void show(uint32_t fade_ms)
+{
+    pwm_fade_rgb16(m_rgb.r, m_rgb.g, m_rgb.b, fade_ms);
+}
+
+static void hsv_to_state(const hsv_color_t *p_hsv)
+{
+    if (!m_chroma_valid || p_hsv->h != m_chroma_h || p_hsv->s != m_chroma_s) {
+        hsv_chroma_init(&m_chroma, p_hsv->h, p_hsv->s);
+        m_chroma_h = p_hsv->h;
+        m_chroma_s = p_hsv->s;
+        m_chroma_valid = true;
+    }
+    hsv_chroma_apply(&m_chroma, p_hsv->v, &m_rgb);
+    curve_rgb(&m_rgb);
+    m_from_hsv = true;
+}
+
+void color_state_set_rgb16(const rgb16_t *p_rgb, uint32_t fade_ms)
+{
+    m_rgb = *p_rgb;
+    m_hsv_valid = false;
+    m_from_hsv = false;
+    show(fade_ms);
+}
+
+void color_state_set_hsv(const hsv_color_t *p_hsv, uint32_t fade_ms)
+{
+    hsv_to_state(p_hsv);
+    m_hsv = *p_hsv;
+    m_hsv_valid = true;
+    show(fade_ms);
+}
+
+void color_state_restore(const rgb16_t *p_rgb, const hsv_color_t *p_hsv, uint32_t fade_ms)
+{
+    m_rgb = *p_rgb;
+    m_hsv = *p_hsv;
+    m_hsv_valid = true;
+    m_from_hsv = false;
+    show(fade_ms);
+}
+
+void color_state_get_rgb16(rgb16_t *p_rgb)
+{
+    *p_rgb = m_rgb;
+}
+
+void color_state_get_hsv(hsv_color_t *p_hsv)
+{
+    if (!m_hsv_valid) {
+        color_to_hsv(&m_rgb, &m_hsv);
+        m_hsv_valid = true;
+    }
+    *p_hsv = m_hsv;
+}
+
+void color_state_refresh(void)
+{
+    if (m_from_hsv) {
+        hsv_to_state(&m_hsv);
+    } else {
+        /* The duty cycles stay; their HSV view moved with the curve. */
+        m_hsv_valid = false;
+    }
+    show(0);
+}
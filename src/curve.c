@@ -0,0 +1,58 @@
+#include "curve.h"
+#include "app_config.h"
+
+static uint16_t const * const m_tables[CURVE_COUNT] = {
+    [CURVE_LINEAR]    = NULL,
+    [CURVE_GAMMA_22]  = curve_table_gamma_22,
+    [CURVE_CIE_LSTAR] = curve_table_cie_lstar,
+};
+
+static curve_t m_curve = COLOR_CURVE_DEFAULT;
+
+uint16_t curve_apply(curve_t curve, uint16_t x)
+{
+    uint16_t const *p_table = m_tables[curve];
+
+    if (p_table == NULL) {
+        return x;
+    }
+    return p_table[((uint32_t)x + (1u << (CURVE_INDEX_SHIFT - 1))) >> CURVE_INDEX_SHIFT];
+}
+
+uint16_t curve_invert(curve_t curve, uint16_t y)
+{
+    uint16_t const *p_table = m_tables[curve];
+
+    if (p_table == NULL) {
+        return y;
+    }
+    /* First entry not below y, so a flat start inverts to 0; the tables
+     * are monotonic. */
+    uint32_t low = 0;
+    uint32_t high = CURVE_TABLE_SIZE - 1;
+    while (low < high) {
+        uint32_t mid = (low + high) / 2;
+        if (p_table[mid] < y) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    if (low > 0 && y - p_table[low - 1] < p_table[low] - y) {
+        low--;
+    }
+    uint32_t x = low << CURVE_INDEX_SHIFT;
+    return (uint16_t)(x > UINT16_MAX ? UINT16_MAX : x);
+}
+
+void curve_select(curve_t curve)
+{
+    if (curve < CURVE_COUNT) {
+        m_curve = curve;
+    }
+}
+
+curve_t curve_selected(void)
+{
+    return m_curve;
+}
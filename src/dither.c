@@ -0,0 +1,36 @@
+#include "dither.h"
+
+_Static_assert(DITHER_MAX <= UINT16_MAX, "dither range must fit the PWM value type");
+
+uint16_t dither_from_duty16(uint16_t duty)
+{
+    return (uint16_t)(((uint32_t)duty * DITHER_MAX + UINT16_MAX / 2) / UINT16_MAX);
+}
+
+static uint16_t dither_step(uint16_t target, uint32_t *p_acc)
+{
+    *p_acc += target % DITHER_SCALE;
+    if (*p_acc >= DITHER_SCALE) {
+        *p_acc -= DITHER_SCALE;
+        return target / DITHER_SCALE + 1;
+    }
+    return target / DITHER_SCALE;
+}
+
+void dither_fill(nrf_pwm_values_individual_t *p_sets, uint16_t sets,
+                 nrf_pwm_values_individual_t const *p_target)
+{
+    /* Starting half way rounds the sum to nearest and centres the extra
+     * counts in the sequence. */
+    uint32_t acc[NRF_PWM_CHANNEL_COUNT] = {
+        DITHER_SCALE / 2, DITHER_SCALE / 2, DITHER_SCALE / 2, DITHER_SCALE / 2
+    };
+
+    for (uint16_t i = 0; i < sets; i++) {
+        nrf_pwm_values_individual_t *p_set = &p_sets[i];
+        p_set->channel_0 = dither_step(p_target->channel_0, &acc[0]);
+        p_set->channel_1 = dither_step(p_target->channel_1, &acc[1]);
+        p_set->channel_2 = dither_step(p_target->channel_2, &acc[2]);
+        p_set->channel_3 = dither_step(p_target->channel_3, &acc[3]);
+    }
+}
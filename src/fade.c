@@ -0,0 +1,39 @@
+#include "fade.h"
+
+void fade_plan(uint32_t periods, uint16_t max_steps, uint16_t *p_steps, uint32_t *p_repeats)
+{
+    if (periods < 2 || max_steps == 0) {
+        *p_steps = 1;
+        *p_repeats = 0;
+        return;
+    }
+
+    uint32_t per_step = (periods + max_steps - 1) / max_steps;
+    uint32_t steps = (periods + per_step / 2) / per_step;
+
+    *p_steps = (uint16_t)steps;
+    *p_repeats = per_step - 1;
+}
+
+static uint16_t ramp_point(uint16_t from, uint16_t to, uint32_t i, uint16_t steps)
+{
+    int32_t num = ((int32_t)to - (int32_t)from) * (int32_t)i;
+    int32_t half = steps / 2;
+
+    num += (num >= 0) ? half : -half;
+    return (uint16_t)((int32_t)from + num / steps);
+}
+
+void fade_ramp_build(nrf_pwm_values_individual_t *p_ramp,
+                     nrf_pwm_values_individual_t const *p_from,
+                     nrf_pwm_values_individual_t const *p_to,
+                     uint16_t steps)
+{
+    for (uint32_t i = 1; i <= steps; i++) {
+        nrf_pwm_values_individual_t *p_step = &p_ramp[i - 1];
+        p_step->channel_0 = ramp_point(p_from->channel_0, p_to->channel_0, i, steps);
+        p_step->channel_1 = ramp_point(p_from->channel_1, p_to->channel_1, i, steps);
+        p_step->channel_2 = ramp_point(p_from->channel_2, p_to->channel_2, i, steps);
+        p_step->channel_3 = ramp_point(p_from->channel_3, p_to->channel_3, i, steps);
+    }
+}
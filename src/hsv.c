@@ -1,48 +1,237 @@
 #include "hsv.h"
-#include "app_config.h"
 
-void hsv_to_rgb_simple(uint16_t h, uint8_t s, uint8_t v, uint16_t *r, uint16_t *g, uint16_t *b)
+#if defined(__ARM_FEATURE_DSP) && !HSV_HUE_LUT
+#include "nrf.h"
+#define HSV_BATCH_DSP 1
+#else
+#define HSV_BATCH_DSP 0
+#endif
+
+#if HSV_HUE_LUT
+/* Channel levels are v * ((100 - s) * 65535 + s * ramp) with the ramp of
+ * the hue degree fetched from hsv_hue_ramp. */
+#define HSV_UNITS_FULL (100u * 100u * UINT16_MAX)
+#else
+/* Channel levels of a hue sector are computed in units of 1/6000 percent
+ * of brightness, which keeps every intermediate an exact integer. */
+#define HSV_UNITS_FULL 600000u
+#endif
+
+/* 2^32 * full / HSV_UNITS_FULL rounded, turning units into an output range
+ * with one multiply; the error is below 1e-4 of an output step, 0.08 with
+ * HSV_HUE_LUT. */
+#define HSV_UNITS_TO(_full) \
+    ((uint32_t)((((uint64_t)(_full) << 32) + HSV_UNITS_FULL / 2) / HSV_UNITS_FULL))
+
+static inline uint16_t units_scale(uint32_t units, uint32_t scale)
 {
-    h = h % 360;
-    
-    if (s == 0) {
-        *r = *g = *b = (v * PWM_TOP_VALUE) / 100;
-        return;
+    return (uint16_t)(((uint64_t)units * scale + (1ull << 31)) >> 32);
+}
+
+#if HSV_HUE_LUT
+/* Level of each channel per percent of v. */
+static inline void hue_basis(uint16_t h, uint8_t s, uint32_t basis[3])
+{
+    const uint16_t *p_ramp = hsv_hue_ramp[h % HSV_HUE_DEGREES];
+    for (uint8_t c = 0; c < 3; c++) {
+        basis[c] = (100u - s) * UINT16_MAX + (uint32_t)s * p_ramp[c];
     }
-    
-    uint8_t sector = h / 60;
-    uint16_t remainder = (h % 60) * 6;
-    
-    uint32_t p = ((uint32_t)v * (100 - s)) / 100;
-    uint32_t q = ((uint32_t)v * (100 - ((s * remainder) / 360))) / 100;
-    uint32_t t = ((uint32_t)v * (100 - ((s * (360 - remainder)) / 360))) / 100;
-    
-    uint16_t v_pwm = (v * PWM_TOP_VALUE) / 100;
-    uint16_t p_pwm = (p * PWM_TOP_VALUE) / 100;
-    uint16_t q_pwm = (q * PWM_TOP_VALUE) / 100;
-    uint16_t t_pwm = (t * PWM_TOP_VALUE) / 100;
-    
-    switch(sector) {
+}
+
+static void hsv_to_rgb_scaled(uint16_t h, uint8_t s, uint8_t v, uint32_t scale,
+                              uint16_t *r, uint16_t *g, uint16_t *b)
+{
+    uint32_t basis[3];
+    hue_basis(h, s, basis);
+    *r = units_scale(v * basis[0], scale);
+    *g = units_scale(v * basis[1], scale);
+    *b = units_scale(v * basis[2], scale);
+}
+#else
+static void hsv_to_rgb_scaled(uint16_t h, uint8_t s, uint8_t v, uint32_t scale,
+                              uint16_t *r, uint16_t *g, uint16_t *b)
+{
+    h = h % 360;
+
+    uint32_t f = h % 60;
+    uint16_t v_out = units_scale((uint32_t)v * 6000, scale);
+    uint16_t p_out = units_scale((uint32_t)v * (100 - s) * 60, scale);
+    uint16_t q_out = units_scale((uint32_t)v * (6000 - s * f), scale);
+    uint16_t t_out = units_scale((uint32_t)v * (6000 - s * (60 - f)), scale);
+
+    switch (h / 60) {
         case 0:
-            *r = v_pwm; *g = t_pwm; *b = p_pwm;
+            *r = v_out; *g = t_out; *b = p_out;
             break;
         case 1:
-            *r = q_pwm; *g = v_pwm; *b = p_pwm;
+            *r = q_out; *g = v_out; *b = p_out;
             break;
         case 2:
-            *r = p_pwm; *g = v_pwm; *b = t_pwm;
+            *r = p_out; *g = v_out; *b = t_out;
             break;
         case 3:
-            *r = p_pwm; *g = q_pwm; *b = v_pwm;
+            *r = p_out; *g = q_out; *b = v_out;
             break;
         case 4:
-            *r = t_pwm; *g = p_pwm; *b = v_pwm;
+            *r = t_out; *g = p_out; *b = v_out;
             break;
         default:
-            *r = v_pwm; *g = p_pwm; *b = q_pwm;
+            *r = v_out; *g = p_out; *b = q_out;
             break;
     }
 }
+#endif
+
+void hsv_to_rgb_simple(uint16_t h, uint8_t s, uint8_t v, uint16_t *r, uint16_t *g, uint16_t *b)
+{
+    hsv_to_rgb_scaled(h, s, v, HSV_UNITS_TO(PWM_TOP_VALUE), r, g, b);
+}
+
+void hsv_to_rgb16(uint16_t h, uint8_t s, uint8_t v, uint16_t *r, uint16_t *g, uint16_t *b)
+{
+    hsv_to_rgb_scaled(h, s, v, HSV_UNITS_TO(UINT16_MAX), r, g, b);
+}
+
+_Static_assert(sizeof(rgb16_t) == 3 * sizeof(uint16_t), "rgb16_t must stay packed");
+
+#if !HSV_HUE_LUT
+/* Which of the v, p, q, t levels goes to r, g and b in each hue sector. */
+enum { LEVEL_V, LEVEL_P, LEVEL_Q, LEVEL_T };
+static const uint8_t m_sector_levels[6][3] = {
+    { LEVEL_V, LEVEL_T, LEVEL_P },
+    { LEVEL_Q, LEVEL_V, LEVEL_P },
+    { LEVEL_P, LEVEL_V, LEVEL_T },
+    { LEVEL_P, LEVEL_Q, LEVEL_V },
+    { LEVEL_T, LEVEL_P, LEVEL_V },
+    { LEVEL_V, LEVEL_P, LEVEL_Q },
+};
+
+static inline void hue_basis(uint16_t h, uint8_t s, uint32_t basis[3])
+{
+    h = h % 360;
+
+    uint32_t f = h % 60;
+    uint32_t levels[4];
+    levels[LEVEL_V] = 6000;
+    levels[LEVEL_P] = 6000 - s * 60;
+    levels[LEVEL_Q] = 6000 - s * f;
+    levels[LEVEL_T] = 6000 - s * (60 - f);
+
+    const uint8_t *p_levels = m_sector_levels[h / 60];
+    for (uint8_t c = 0; c < 3; c++) {
+        basis[c] = levels[p_levels[c]];
+    }
+}
+#endif
+
+#if HSV_HUE_LUT
+void hsv_to_rgb_batch(const hsv_color_t *p_hsv, rgb16_t *p_rgb, size_t n)
+{
+    const uint32_t scale = HSV_UNITS_TO(UINT16_MAX);
+
+    for (size_t i = 0; i < n; i++) {
+        uint32_t basis[3];
+        uint32_t v = p_hsv[i].v;
+        hue_basis(p_hsv[i].h, p_hsv[i].s, basis);
+        p_rgb[i].r = units_scale(v * basis[0], scale);
+        p_rgb[i].g = units_scale(v * basis[1], scale);
+        p_rgb[i].b = units_scale(v * basis[2], scale);
+    }
+}
+#elif HSV_BATCH_DSP
+/* Both 16-bit halves set to x. */
+#define HSV_PAIR(_x) ((uint32_t)(_x) * 0x10001u)
+
+/* Hue offsets of r, g and b, see hsv_to_rgb_batch() in hsv.h. */
+static const uint32_t m_channel_offset[3] = { HSV_PAIR(300), HSV_PAIR(180), HSV_PAIR(60) };
+
+void hsv_to_rgb_batch(const hsv_color_t *p_hsv, rgb16_t *p_rgb, size_t n)
+{
+    const uint32_t scale = HSV_UNITS_TO(UINT16_MAX);
+    size_t i = 0;
+
+    for (; i + 1 < n; i += 2) {
+        const hsv_color_t *p_in = &p_hsv[i];
+        uint32_t hue = __PKHBT(p_in[0].h % 360, p_in[1].h % 360, 16);
+        uint32_t vs[2] = { (uint32_t)p_in[0].v * p_in[0].s, (uint32_t)p_in[1].v * p_in[1].s };
+        uint32_t v_vs[2] = { __PKHBT(p_in[0].v, vs[0], 16), __PKHBT(p_in[1].v, vs[1], 16) };
+        uint16_t out[2][3];
+
+        for (uint8_t c = 0; c < 3; c++) {
+            /* Both halves are the same channel of the two colors. */
+            uint32_t hh = __UADD16(hue, m_channel_offset[c]);
+            hh = __SEL(__USUB16(hh, HSV_PAIR(360)), hh);
+            uint32_t fall = __SSUB16(HSV_PAIR(240), hh);
+            (void)__SSUB16(fall, hh);
+            uint32_t d = __SEL(hh, fall);
+            uint32_t y = __USAT16(__SSUB16(HSV_PAIR(60), __USAT16(d, 15)), 15);
+
+            out[0][c] = units_scale((uint32_t)__SMLAD(v_vs[0], __PKHBT(6000, y, 16),
+                                                      -60 * (int32_t)vs[0]), scale);
+            out[1][c] = units_scale((uint32_t)__SMLAD(v_vs[1], __PKHBT(6000, y, 0),
+                                                      -60 * (int32_t)vs[1]), scale);
+        }
+        for (uint8_t k = 0; k < 2; k++) {
+            p_rgb[i + k].r = out[k][0];
+            p_rgb[i + k].g = out[k][1];
+            p_rgb[i + k].b = out[k][2];
+        }
+    }
+    if (i < n) {
+        hsv_to_rgb16(p_hsv[i].h, p_hsv[i].s, p_hsv[i].v, &p_rgb[i].r, &p_rgb[i].g, &p_rgb[i].b);
+    }
+}
+#else
+static const uint16_t m_channel_offset[3] = { 300, 180, 60 };
+
+void hsv_to_rgb_batch(const hsv_color_t *p_hsv, rgb16_t *p_rgb, size_t n)
+{
+    const uint32_t scale = HSV_UNITS_TO(UINT16_MAX);
+
+    for (size_t i = 0; i < n; i++) {
+        uint32_t h = p_hsv[i].h % 360;
+        uint32_t vs = (uint32_t)p_hsv[i].v * p_hsv[i].s;
+        uint32_t p_units = (uint32_t)p_hsv[i].v * 6000 - 60 * vs;
+        uint16_t out[3];
+
+        for (uint8_t c = 0; c < 3; c++) {
+            int32_t hh = (int32_t)(h + m_channel_offset[c]);
+            hh = hh >= 360 ? hh - 360 : hh;
+            int32_t d = MIN(hh, 240 - hh);
+            uint32_t y = d <= 0 ? 60 : (d >= 60 ? 0 : (uint32_t)(60 - d));
+            out[c] = units_scale(p_units + vs * y, scale);
+        }
+        p_rgb[i].r = out[0];
+        p_rgb[i].g = out[1];
+        p_rgb[i].b = out[2];
+    }
+}
+#endif
+
+void hsv_chroma_init(hsv_chroma_t *p_chroma, uint16_t h, uint8_t s)
+{
+    uint32_t basis[3];
+    hue_basis(h, s, basis);
+    for (uint8_t c = 0; c < 3; c++) {
+        p_chroma->level[c] = (uint64_t)basis[c] * HSV_UNITS_TO(UINT16_MAX);
+    }
+}
+
+void hsv_chroma_apply(const hsv_chroma_t *p_chroma, uint8_t v, rgb16_t *p_rgb)
+{
+    p_rgb->r = (uint16_t)((v * p_chroma->level[0] + (1ull << 31)) >> 32);
+    p_rgb->g = (uint16_t)((v * p_chroma->level[1] + (1ull << 31)) >> 32);
+    p_rgb->b = (uint16_t)((v * p_chroma->level[2] + (1ull << 31)) >> 32);
+}
+
+/* 60 * num / delta rounded half away from zero, num in -delta..delta. */
+static int32_t hue_offset(int32_t num, uint32_t delta)
+{
+    if (num < 0) {
+        return -(int32_t)hsv_div_round((uint32_t)(-num) * 60, delta);
+    }
+    return (int32_t)hsv_div_round((uint32_t)num * 60, delta);
+}
 
 void rgb_to_hsv_simple(uint16_t r, uint16_t g, uint16_t b, uint16_t *h, uint8_t *s, uint8_t *v)
 {
@@ -54,12 +243,12 @@ void rgb_to_hsv_simple(uint16_t r, uint16_t g, uint16_t b, uint16_t *h, uint8_t
     uint32_t min_val = MIN(r, MIN(g, b));
     uint32_t delta = max_val - min_val;
 
-    *v = max_val / 10; 
+    *v = (uint8_t)hsv_div_round(max_val * 100, PWM_TOP_VALUE);
 
     if (max_val == 0) {
         *s = 0;
     } else {
-        *s = (delta * 100) / max_val;
+        *s = (uint8_t)hsv_div_round(delta * 100, max_val);
     }
 
     if (delta == 0) {
@@ -67,12 +256,11 @@ void rgb_to_hsv_simple(uint16_t r, uint16_t g, uint16_t b, uint16_t *h, uint8_t
     } else {
         int32_t hue_temp;
         if (max_val == r) {
-            hue_temp = ((int32_t)(g - b) * 60) / (int32_t)delta;
-            if (g < b) hue_temp += 360;
+            hue_temp = hue_offset((int32_t)g - (int32_t)b, delta);
         } else if (max_val == g) {
-            hue_temp = ((int32_t)(b - r) * 60) / (int32_t)delta + 120;
+            hue_temp = hue_offset((int32_t)b - (int32_t)r, delta) + 120;
         } else {
-            hue_temp = ((int32_t)(r - g) * 60) / (int32_t)delta + 240;
+            hue_temp = hue_offset((int32_t)r - (int32_t)g, delta) + 240;
         }
         
         if (hue_temp < 0) hue_temp += 360;
@@ -80,4 +268,4 @@ void rgb_to_hsv_simple(uint16_t r, uint16_t g, uint16_t b, uint16_t *h, uint8_t
         
         *h = (uint16_t)hue_temp;
     }
-}
\ No newline at end of file
+}
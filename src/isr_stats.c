@@ -0,0 +1,47 @@
+#include "isr_stats.h"
+#include "nrf.h"
+
+#include <string.h>
+
+static volatile isr_stats_t m_stats[ISR_STATS_SOURCE_COUNT];
+
+void isr_stats_init(void)
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+uint32_t isr_stats_begin(void)
+{
+    return DWT->CYCCNT;
+}
+
+/* Interrupt handlers share one priority level, so they never preempt each
+ * other and the update needs no critical section. The USBD slot is only
+ * written from thread context. */
+void isr_stats_end(isr_stats_source_t source, uint32_t start)
+{
+    uint32_t cycles = DWT->CYCCNT - start;
+
+    m_stats[source].count++;
+    if (cycles > m_stats[source].max_cycles) {
+        m_stats[source].max_cycles = cycles;
+    }
+}
+
+void isr_stats_get(isr_stats_source_t source, isr_stats_t *p_stats)
+{
+    p_stats->count = m_stats[source].count;
+    p_stats->max_cycles = m_stats[source].max_cycles;
+}
+
+void isr_stats_reset(void)
+{
+    memset((void *)m_stats, 0, sizeof(m_stats));
+}
+
+uint32_t isr_stats_cycles_to_us(uint32_t cycles)
+{
+    return cycles / (SystemCoreClock / 1000000);
+}
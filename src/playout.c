@@ -0,0 +1,219 @@
+#include "playout.h"
+#include "app_config.h"
+#include "pwm_leds.h"
+#include "scheduler.h"
+#include "spsc_ring.h"
+
+#include <string.h>
+
+typedef struct {
+    uint32_t due_ms;
+    uint16_t rgb[3];
+} playout_frame_t;
+
+SPSC_RING_DEF(m_frames, playout_frame_t, STREAM_JITTER_DEPTH);
+
+static bool m_active = false;
+static bool m_offset_valid;
+static uint32_t m_offset;
+static uint32_t m_offset_start;
+
+/* Fastest transit of the current window and, from the first window on,
+ * the one the offset was last matched to. */
+static bool m_window_valid;
+static uint32_t m_window_start;
+static uint32_t m_window_min;
+static bool m_transit_valid;
+static uint32_t m_transit_ref;
+
+static uint16_t m_out[3];
+static uint16_t m_newest[3];
+static bool m_have_newest;
+
+static uint32_t m_last_due;
+static uint32_t m_interval;
+static bool m_expect_valid;
+static bool m_underrun;
+
+/* A late frame is blended in over one frame interval instead of snapping. */
+static bool m_ramp_active;
+static uint16_t m_ramp_from[3];
+static uint16_t m_ramp_to[3];
+static uint32_t m_ramp_start;
+static uint32_t m_ramp_len;
+
+static playout_stats_t m_stats;
+
+static bool time_reached(uint32_t deadline, uint32_t now)
+{
+    return (int32_t)(now - deadline) >= 0;
+}
+
+static void output(const uint16_t rgb[3])
+{
+    memcpy(m_out, rgb, sizeof(m_out));
+    pwm_set_rgb_values(rgb[0], rgb[1], rgb[2]);
+}
+
+static void frame_shown(uint32_t due_ms)
+{
+    if (m_expect_valid && due_ms != m_last_due) {
+        m_interval = due_ms - m_last_due;
+    }
+    m_last_due = due_ms;
+    m_expect_valid = true;
+    m_underrun = false;
+    m_stats.played++;
+}
+
+void playout_start(void)
+{
+    spsc_ring_skip(&m_frames, spsc_ring_used(&m_frames));
+    m_active = true;
+    m_offset_valid = false;
+    m_window_valid = false;
+    m_transit_valid = false;
+    m_have_newest = false;
+    m_expect_valid = false;
+    m_underrun = false;
+    m_ramp_active = false;
+    m_interval = 1;
+}
+
+/* Moves the offset by at most 1 ms per window towards the clock drift. */
+static void drift_track(uint32_t pts_ms, uint32_t now_ms)
+{
+    uint32_t transit = now_ms - pts_ms;
+
+    if (!m_window_valid) {
+        m_window_valid = true;
+        m_window_start = now_ms;
+        m_window_min = transit;
+    } else if ((int32_t)(transit - m_window_min) < 0) {
+        m_window_min = transit;
+    }
+    if (now_ms - m_window_start < STREAM_DRIFT_WINDOW_MS) {
+        return;
+    }
+    m_window_valid = false;
+
+    if (!m_transit_valid) {
+        m_transit_ref = m_window_min;
+        m_transit_valid = true;
+        return;
+    }
+    int32_t moved = (int32_t)(m_window_min - m_transit_ref);
+    int32_t step = (moved > 0) - (moved < 0);
+    m_transit_ref += step;
+    m_offset += step;
+}
+
+bool playout_push(uint32_t pts_ms, const uint16_t rgb[3], uint32_t now_ms)
+{
+    if (!m_active) return false;
+
+    if (!m_offset_valid) {
+        m_offset = now_ms + STREAM_JITTER_LATENCY_MS - pts_ms;
+        m_offset_start = m_offset;
+        m_offset_valid = true;
+    }
+    drift_track(pts_ms, now_ms);
+    memcpy(m_newest, rgb, sizeof(m_newest));
+    m_have_newest = true;
+
+    playout_frame_t frame = { .due_ms = pts_ms + m_offset };
+    memcpy(frame.rgb, rgb, sizeof(frame.rgb));
+
+    if (time_reached(frame.due_ms, now_ms)) {
+        /* Everything queued before it is overdue as well. */
+        playout_process(now_ms);
+        m_stats.late++;
+        memcpy(m_ramp_from, m_out, sizeof(m_ramp_from));
+        memcpy(m_ramp_to, frame.rgb, sizeof(m_ramp_to));
+        m_ramp_start = now_ms;
+        m_ramp_len = m_interval;
+        m_ramp_active = true;
+        frame_shown(frame.due_ms);
+        playout_process(now_ms);
+        return true;
+    }
+
+    if (spsc_ring_put(&m_frames, &frame, 1) != 1) {
+        m_stats.overflows++;
+        return false;
+    }
+    playout_process(now_ms);
+    return true;
+}
+
+bool playout_stop(uint16_t rgb[3])
+{
+    spsc_ring_skip(&m_frames, spsc_ring_used(&m_frames));
+    m_active = false;
+    m_ramp_active = false;
+    sched_clear(SCHED_PLAYOUT);
+
+    if (!m_have_newest) return false;
+    output(m_newest);
+    memcpy(rgb, m_newest, sizeof(m_newest));
+    return true;
+}
+
+void playout_process(uint32_t now_ms)
+{
+    if (!m_active) return;
+
+    playout_frame_t frame;
+    bool shown = false;
+    while (spsc_ring_peek(&m_frames, &frame, 1) == 1 && time_reached(frame.due_ms, now_ms)) {
+        spsc_ring_skip(&m_frames, 1);
+        frame_shown(frame.due_ms);
+        shown = true;
+    }
+
+    if (shown) {
+        m_ramp_active = false;
+        output(frame.rgb);
+    } else if (m_ramp_active) {
+        uint32_t elapsed = now_ms - m_ramp_start;
+        if (elapsed >= m_ramp_len) {
+            m_ramp_active = false;
+            output(m_ramp_to);
+        } else {
+            uint16_t rgb[3];
+            for (int i = 0; i < 3; i++) {
+                int32_t delta = (int32_t)m_ramp_to[i] - m_ramp_from[i];
+                rgb[i] = (uint16_t)(m_ramp_from[i] + delta * (int32_t)elapsed / (int32_t)m_ramp_len);
+            }
+            output(rgb);
+        }
+    }
+
+    bool queued = spsc_ring_peek(&m_frames, &frame, 1) == 1;
+    uint32_t expect = m_last_due + m_interval;
+    if (!queued && m_expect_valid && !m_underrun && time_reached(expect, now_ms)) {
+        m_stats.underruns++;
+        m_underrun = true;
+    }
+
+    if (m_ramp_active) {
+        sched_set(SCHED_PLAYOUT, now_ms + 1);
+    } else if (queued) {
+        sched_set(SCHED_PLAYOUT, frame.due_ms);
+    } else if (m_expect_valid && !m_underrun) {
+        sched_set(SCHED_PLAYOUT, expect);
+    } else {
+        sched_clear(SCHED_PLAYOUT);
+    }
+}
+
+void playout_stats_get(playout_stats_t *p_stats)
+{
+    *p_stats = m_stats;
+    p_stats->drift_ms = m_offset_valid ? (int32_t)(m_offset - m_offset_start) : 0;
+}
+
+void playout_stats_reset(void)
+{
+    memset(&m_stats, 0, sizeof(m_stats));
+}
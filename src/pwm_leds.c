@@ -1,76 +1,511 @@
 #include "pwm_leds.h"
+#include "fade.h"
+#include "dither.h"
+#include "color_correct.h"
+#include "isr_stats.h"
 #include "nrfx_pwm.h"
+#include "nrf_drv_clock.h"
 
-static nrfx_pwm_t m_pwm_rgb = NRFX_PWM_INSTANCE(0);
-static nrfx_pwm_t m_pwm_indicator = NRFX_PWM_INSTANCE(1);
+/* PWM0 drives all LEDs: LD2 red, blue and green on channels 0-2 and LD1 on
+ * channel 3. It plays two sequences that alternate, so while EasyDMA reads
+ * one buffer the other is idle. A new color is staged in m_rgb_pending and
+ * copied by the SEQEND handler into whichever buffer just finished, which
+ * makes every change land whole on a period boundary.
+ *
+ * m_rgb_update counts staged colors times two and is odd while the thread is
+ * writing m_rgb_pending; the handler skips a round rather than copy a half
+ * written color. The SEQEND interrupts only run while the buffers have to
+ * change: until both hold the latest update, during a fade, and while LD1
+ * plays a timed pattern.
+ *
+ * A fade swaps sequence 0 for a precomputed ramp while sequence 1 is playing.
+ * EasyDMA then plays the whole ramp on its own and the handler runs once at
+ * the start of the ramp, to park the target in buffer 1, and once at the end,
+ * to put buffer 0 back. Updates staged during a fade wait for it to end, and
+ * LD1 holds still.
+ *
+ * LD1 patterns run on a clock of PWM periods. Each refilled buffer gets the
+ * LD1 value for the moment it will start and plays for as long as that value
+ * lasts, at most LED_CHUNK_MAX_PERIODS so a staged color waits for no more
+ * than two short chunks.
+ *
+ * In dithered mode a color with a sub-count part, kept in 1/DITHER_SCALE
+ * counts, fills its buffer with PWM_DITHER_PERIODS value sets that spread it
+ * over the sequence by sigma-delta, so EasyDMA plays a duty cycle finer than
+ * one count. Such buffers play whole sequences, and LD1 changes land on their
+ * boundaries, so the next color can wait up to two sequences. Whole-count
+ * colors, which is everything staged through the counts API, keep a single
+ * set and the latency of plain PWM.
+ *
+ * When every channel is dark and nothing is pending the handler stops the
+ * PWM, which takes effect at the end of the period, and releases its HFCLK
+ * request. Stopped pins sit at the level of a zero duty cycle. The next
+ * non-zero color or pattern starts playback again from dark buffers. */
+#define LED_CHUNK_MAX_PERIODS 4
 
-static nrf_pwm_values_individual_t pwm_rgb_values;
-static nrf_pwm_sequence_t const pwm_rgb_seq = {
-    .values.p_individual = &pwm_rgb_values,
-    .length = NRF_PWM_VALUES_LENGTH(pwm_rgb_values),
-    .repeats = 0,
-    .end_delay = 0
+#define LED_SEQEND_INT_MASK (NRF_PWM_INT_SEQEND0_MASK | NRF_PWM_INT_SEQEND1_MASK)
+#define LED_PLAYBACK_FLAGS  (NRFX_PWM_FLAG_LOOP |            \
+                             NRFX_PWM_FLAG_SIGNAL_END_SEQ0 | \
+                             NRFX_PWM_FLAG_SIGNAL_END_SEQ1 | \
+                             NRFX_PWM_FLAG_NO_EVT_FINISHED)
+
+/* One period is PWM_TOP_VALUE ticks of the 1 MHz base clock. */
+#define PWM_PERIODS(_ms) (((_ms) * 1000u) / PWM_TOP_VALUE)
+
+typedef enum {
+    LED_PWM_STOPPED,
+    LED_PWM_RUNNING,
+    LED_PWM_STOPPING
+} led_pwm_state_t;
+
+static nrfx_pwm_t m_pwm = NRFX_PWM_INSTANCE(0);
+static led_pwm_state_t m_pwm_state = LED_PWM_STOPPED;
+
+static nrf_pwm_values_individual_t m_values[2][PWM_DITHER_PERIODS];
+static nrf_pwm_sequence_t m_seq[2] = {
+    {
+        .values.p_individual = m_values[0],
+        .length = NRF_PWM_VALUES_LENGTH(m_values[0][0]),
+        .repeats = 0,
+        .end_delay = 0
+    },
+    {
+        .values.p_individual = m_values[1],
+        .length = NRF_PWM_VALUES_LENGTH(m_values[1][0]),
+        .repeats = 0,
+        .end_delay = 0
+    },
 };
+/* Value sets in each buffer, position on the LD1 pattern clock where it
+ * starts, and for how many periods it plays. */
+static uint16_t m_seq_sets[2] = { 1, 1 };
+static uint32_t m_seq_pos[2];
+static uint32_t m_seq_len[2];
+static bool m_dither = true;
+
+/* In 1/DITHER_SCALE counts. */
+static nrf_pwm_values_individual_t m_rgb_pending;
+static uint32_t m_rgb_update;
+static uint32_t m_rgb_buffer_update[2];
+static uint32_t m_rgb_live;
+static uint32_t m_rgb_pending_periods;
 
-static nrf_pwm_values_individual_t pwm_indicator_values;
-static nrf_pwm_sequence_t const pwm_indicator_seq = {
-    .values.p_individual = &pwm_indicator_values,
-    .length = NRF_PWM_VALUES_LENGTH(pwm_indicator_values),
-    .repeats = 0,
+static nrf_pwm_values_individual_t m_fade_ramp[PWM_FADE_MAX_STEPS];
+static nrf_pwm_values_individual_t m_fade_target;
+static nrf_pwm_sequence_t m_fade_seq = {
+    .values.p_individual = m_fade_ramp,
     .end_delay = 0
 };
+static uint32_t m_fade_update;
+static bool m_fade_playing;
+
+/* A pattern steps through count values, each held step_periods, and then
+ * holds the last one rest_periods longer. step_periods 0 holds the first
+ * value for good. */
+typedef struct {
+    uint16_t const *p_values;
+    uint16_t count;
+    uint16_t step_periods;
+    uint16_t rest_periods;
+} indicator_pattern_t;
+
+#define INDICATOR_BREATHE_STEPS        128
+#define INDICATOR_BREATHE_STEP_PERIODS 12
+
+static uint16_t const m_indicator_on = PWM_TOP_VALUE;
+static uint16_t const m_indicator_off = 0;
+static uint16_t const m_indicator_blink[2] = { PWM_TOP_VALUE, 0 };
+static uint16_t m_indicator_breathe[INDICATOR_BREATHE_STEPS];
+
+static indicator_pattern_t const m_indicator_patterns[PWM_INDICATOR_PATTERN_COUNT] = {
+    [PWM_INDICATOR_OFF]        = { &m_indicator_off, 1, 0, 0 },
+    [PWM_INDICATOR_SLOW_BLINK] = { m_indicator_blink, 2, PWM_PERIODS(MODE_BLINK_SLOW_MS), 0 },
+    [PWM_INDICATOR_FAST_BLINK] = { m_indicator_blink, 2, PWM_PERIODS(MODE_BLINK_FAST_MS), 0 },
+    [PWM_INDICATOR_SOLID]      = { &m_indicator_on, 1, 0, 0 },
+    [PWM_INDICATOR_BREATHING]  = { m_indicator_breathe, INDICATOR_BREATHE_STEPS,
+                                   INDICATOR_BREATHE_STEP_PERIODS,
+                                   PWM_PERIODS(MODE_BREATHE_MS) -
+                                   INDICATOR_BREATHE_STEPS * INDICATOR_BREATHE_STEP_PERIODS },
+};
+
+/* Requested by the thread, adopted by the handler at the next refill. */
+static pwm_indicator_pattern_t m_indicator_request = PWM_INDICATOR_OFF;
+static pwm_indicator_pattern_t m_indicator_pattern = PWM_INDICATOR_OFF;
+
+/* LD1 value at pos on the pattern clock, and in *p_left how many periods it
+ * stays, 0 if it never changes. */
+static uint16_t indicator_at(indicator_pattern_t const *p_pattern, uint32_t pos, uint32_t *p_left)
+{
+    if (p_pattern->step_periods == 0) {
+        *p_left = 0;
+        return p_pattern->p_values[0];
+    }
+
+    uint32_t cycle = p_pattern->count * p_pattern->step_periods + p_pattern->rest_periods;
+    pos %= cycle;
+
+    uint32_t step = pos / p_pattern->step_periods;
+    if (step >= p_pattern->count) {
+        step = p_pattern->count - 1;
+    }
+    uint32_t end = (step + 1) * p_pattern->step_periods;
+    if (step == p_pattern->count - 1u) {
+        end = cycle;
+    }
+    *p_left = end - pos;
+    return p_pattern->p_values[step];
+}
+
+/* Fills a buffer with a color in 1/DITHER_SCALE counts; LD1 is set after.
+ * Only a color with a sub-count part is worth a dither sequence. */
+static void fill_rgb(uint8_t buffer, nrf_pwm_values_individual_t const *p_rgb)
+{
+    uint16_t fraction = (p_rgb->channel_0 | p_rgb->channel_1 | p_rgb->channel_2) % DITHER_SCALE;
+    uint16_t sets = 1;
+
+    if (fraction != 0 && __atomic_load_n(&m_dither, __ATOMIC_RELAXED)) {
+        sets = PWM_DITHER_PERIODS;
+    }
+
+    dither_fill(m_values[buffer], sets, p_rgb);
+    m_seq_sets[buffer] = sets;
+}
+
+static bool is_dark(uint8_t buffer)
+{
+    uint16_t lit = 0;
+
+    for (uint16_t i = 0; i < m_seq_sets[buffer]; i++) {
+        nrf_pwm_values_individual_t const *p_set = &m_values[buffer][i];
+        lit |= p_set->channel_0 | p_set->channel_1 | p_set->channel_2 | p_set->channel_3;
+    }
+    return lit == 0;
+}
+
+/* Whether the staged state lights anything. A color still being written
+ * counts as dark: the writer looks at the PWM state once it is done. */
+static bool needs_output(void)
+{
+    uint32_t update = __atomic_load_n(&m_rgb_update, __ATOMIC_ACQUIRE);
+    pwm_indicator_pattern_t pattern = __atomic_load_n(&m_indicator_request, __ATOMIC_ACQUIRE);
+
+    if (pattern != PWM_INDICATOR_OFF) {
+        return true;
+    }
+    return (update & 1) == 0 &&
+           (m_rgb_pending.channel_0 | m_rgb_pending.channel_1 | m_rgb_pending.channel_2) != 0;
+}
+
+/* Restarts from the dark buffers left by the stop; the handler brings them
+ * up to date within two sequences. */
+static void pwm_start(void)
+{
+    nrf_drv_clock_hfclk_request(NULL);
+
+    for (uint8_t i = 0; i < 2; i++) {
+        m_seq[i].repeats = 0;
+        m_seq_len[i] = m_seq_sets[i];
+    }
+    m_seq_pos[0] = 0;
+    m_seq_pos[1] = m_seq_len[0];
+    __atomic_store_n(&m_pwm_state, LED_PWM_RUNNING, __ATOMIC_RELEASE);
+    nrfx_pwm_complex_playback(&m_pwm, &m_seq[0], &m_seq[1], 1, LED_PLAYBACK_FLAGS);
+}
 
-void pwm_rgb_init(void)
+static void pwm_stopped(void)
+{
+    __atomic_store_n(&m_pwm_state, LED_PWM_STOPPED, __ATOMIC_RELEASE);
+    nrf_drv_clock_hfclk_release();
+
+    if (needs_output()) {
+        pwm_start();
+    }
+}
+
+/* Runs while sequence 1 plays from buffer 1, so the ramp starts from exactly
+ * the color on the LED. Returns the ramp length in periods. */
+static uint32_t fade_start(uint32_t update, uint16_t indicator)
+{
+    uint16_t steps;
+    uint32_t repeats;
+    nrf_pwm_values_individual_t to;
+
+    /* The ramp moves in whole counts and buffer 1 takes over the dither. */
+    m_fade_target = m_rgb_pending;
+    dither_fill(&to, 1, &m_fade_target);
+    to.channel_3 = indicator;
+
+    fade_plan(m_rgb_pending_periods, PWM_FADE_MAX_STEPS, &steps, &repeats);
+    fade_ramp_build(m_fade_ramp, &m_values[1][0], &to, steps);
+    m_fade_seq.length = steps * NRF_PWM_VALUES_LENGTH(m_fade_ramp[0]);
+    m_fade_seq.repeats = repeats;
+    m_fade_update = update;
+    m_fade_playing = true;
+    /* While the ramp plays the LED is at least as new as buffer 1. */
+    m_rgb_buffer_update[0] = m_rgb_buffer_update[1];
+
+    nrfx_pwm_sequence_update(&m_pwm, 0, &m_fade_seq);
+    return steps * (repeats + 1);
+}
+
+static void pwm_refill(nrfx_pwm_evt_type_t event_type)
+{
+    uint8_t idle;
+
+    if (event_type == NRFX_PWM_EVT_END_SEQ0) {
+        idle = 0;
+    } else if (event_type == NRFX_PWM_EVT_END_SEQ1) {
+        idle = 1;
+    } else {
+        if (event_type == NRFX_PWM_EVT_STOPPED) {
+            pwm_stopped();
+        }
+        return;
+    }
+
+    uint8_t playing = idle ^ 1;
+    uint32_t update = __atomic_load_n(&m_rgb_update, __ATOMIC_ACQUIRE);
+    uint32_t pos = m_seq_pos[playing] + m_seq_len[playing];
+
+    pwm_indicator_pattern_t request = __atomic_load_n(&m_indicator_request, __ATOMIC_ACQUIRE);
+    if (request != m_indicator_pattern) {
+        m_indicator_pattern = request;
+        pos = 0;
+    }
+    indicator_pattern_t const *p_pattern = &m_indicator_patterns[m_indicator_pattern];
+    uint32_t left;
+    uint16_t indicator = indicator_at(p_pattern, pos, &left);
+    if (m_fade_playing && idle == 0) {
+        m_fade_playing = false;
+        m_seq_len[0] = 0;
+    }
+
+    if (m_fade_playing) {
+        fill_rgb(1, &m_fade_target);
+        m_rgb_buffer_update[1] = m_fade_update;
+    } else if ((update & 1) == 0 && m_rgb_buffer_update[idle] != update) {
+        if (m_rgb_pending_periods == 0 || update == m_fade_update) {
+            fill_rgb(idle, &m_rgb_pending);
+            m_rgb_buffer_update[idle] = update;
+        } else if (idle == 0) {
+            m_seq_pos[0] = pos;
+            m_seq_len[0] = fade_start(update, indicator);
+            return;
+        }
+    }
+
+    /* Whole sequences only, as long as the LD1 value lasts but never
+     * longer than a chunk, and at least one. */
+    uint16_t sets = m_seq_sets[idle];
+    uint32_t len = (left == 0) ? sets : left;
+    if (len > LED_CHUNK_MAX_PERIODS) {
+        len = LED_CHUNK_MAX_PERIODS;
+    }
+    len -= len % sets;
+    if (len == 0) {
+        len = sets;
+    }
+
+    for (uint16_t i = 0; i < sets; i++) {
+        m_values[idle][i].channel_3 = indicator;
+    }
+    uint16_t length = sets * NRF_PWM_VALUES_LENGTH(m_values[idle][0]);
+    if (m_seq_len[idle] != len || m_seq[idle].length != length) {
+        m_seq[idle].length = length;
+        m_seq[idle].repeats = len / sets - 1;
+        nrfx_pwm_sequence_update(&m_pwm, idle, &m_seq[idle]);
+    }
+    m_seq_pos[idle] = pos;
+    m_seq_len[idle] = len;
+
+    __atomic_store_n(&m_rgb_live, m_rgb_buffer_update[playing] >> 1, __ATOMIC_RELEASE);
+
+    bool settled = !m_fade_playing && left == 0 &&
+                   m_rgb_buffer_update[0] == update && m_rgb_buffer_update[1] == update &&
+                   m_seq_len[0] == m_seq_sets[0] && m_seq_len[1] == m_seq_sets[1] &&
+                   m_values[0][0].channel_3 == m_values[1][0].channel_3;
+    if (settled) {
+        nrf_pwm_int_disable(m_pwm.p_registers, LED_SEQEND_INT_MASK);
+        if (is_dark(0)) {
+            __atomic_store_n(&m_pwm_state, LED_PWM_STOPPING, __ATOMIC_RELEASE);
+            nrfx_pwm_stop(&m_pwm, false);
+        }
+    }
+}
+
+static void pwm_handler(nrfx_pwm_evt_type_t event_type)
+{
+    uint32_t start = isr_stats_begin();
+    pwm_refill(event_type);
+    isr_stats_end(ISR_STATS_PWM, start);
+}
+
+/* Called by the thread after it staged a color or pattern. The staged state
+ * is published before the PWM state is read and the handler does it the
+ * other way round, so a stop racing with a new color always restarts. */
+static void output_kick(void)
+{
+    NRF_PWM_Type *p_reg = m_pwm.p_registers;
+
+    switch (__atomic_load_n(&m_pwm_state, __ATOMIC_ACQUIRE)) {
+        case LED_PWM_STOPPED:
+            if (needs_output()) {
+                pwm_start();
+            } else {
+                /* Dark is what the stopped LED shows, so the update is live. */
+                uint32_t update = m_rgb_update;
+                for (uint8_t i = 0; i < 2; i++) {
+                    m_rgb_buffer_update[i] = update;
+                }
+                __atomic_store_n(&m_rgb_live, update >> 1, __ATOMIC_RELEASE);
+            }
+            break;
+
+        case LED_PWM_RUNNING:
+            /* Events left over from while the interrupts were off would
+             * make the handler refill a buffer that is playing. */
+            if (!nrf_pwm_int_enable_check(p_reg, LED_SEQEND_INT_MASK)) {
+                nrf_pwm_event_clear(p_reg, NRF_PWM_EVENT_SEQEND0);
+                nrf_pwm_event_clear(p_reg, NRF_PWM_EVENT_SEQEND1);
+                nrf_pwm_int_enable(p_reg, LED_SEQEND_INT_MASK);
+            }
+            break;
+
+        case LED_PWM_STOPPING:
+            /* pwm_stopped() looks at the staged state again. */
+            break;
+    }
+}
+
+void pwm_leds_init(void)
 {
     nrfx_pwm_config_t pwm_config = NRFX_PWM_DEFAULT_CONFIG;
     pwm_config.output_pins[0] = LED_2_RED;
     pwm_config.output_pins[1] = LED_2_BLUE;
     pwm_config.output_pins[2] = LED_2_GREEN;
-    pwm_config.output_pins[3] = NRFX_PWM_PIN_NOT_USED;
+    pwm_config.output_pins[3] = LED_1_GREEN;
     pwm_config.base_clock = NRF_PWM_CLK_1MHz;
     pwm_config.count_mode = NRF_PWM_MODE_UP;
     pwm_config.top_value = PWM_TOP_VALUE;
     pwm_config.load_mode = NRF_PWM_LOAD_INDIVIDUAL;
     pwm_config.step_mode = NRF_PWM_STEP_AUTO;
-    
-    nrfx_pwm_init(&m_pwm_rgb, &pwm_config, NULL);
-    
-    pwm_rgb_values.channel_0 = 0;
-    pwm_rgb_values.channel_1 = 0;
-    pwm_rgb_values.channel_2 = 0;
-    pwm_rgb_values.channel_3 = 0;
-    
-    nrfx_pwm_simple_playback(&m_pwm_rgb, &pwm_rgb_seq, 1, NRFX_PWM_FLAG_LOOP);
+
+    nrfx_pwm_init(&m_pwm, &pwm_config, pwm_handler);
+
+    /* Quadratic rise and mirrored fall, which looks closer to linear to
+     * the eye than a linear duty ramp. */
+    uint32_t half = INDICATOR_BREATHE_STEPS / 2;
+    for (uint32_t i = 0; i < half; i++) {
+        uint16_t value = (uint16_t)((PWM_TOP_VALUE * (i + 1) * (i + 1)) / (half * half));
+        m_indicator_breathe[i] = value;
+        m_indicator_breathe[INDICATOR_BREATHE_STEPS - 1 - i] = value;
+    }
+    m_indicator_breathe[INDICATOR_BREATHE_STEPS - 1] = 0;
 }
 
-void pwm_indicator_init(void)
+/* r, g and b are in 1/DITHER_SCALE counts. */
+static uint32_t stage_rgb(uint16_t r, uint16_t g, uint16_t b, uint32_t fade_periods)
 {
-    nrfx_pwm_config_t pwm_config = NRFX_PWM_DEFAULT_CONFIG;
-    pwm_config.output_pins[0] = LED_1_GREEN;
-    pwm_config.output_pins[1] = NRFX_PWM_PIN_NOT_USED;
-    pwm_config.output_pins[2] = NRFX_PWM_PIN_NOT_USED;
-    pwm_config.output_pins[3] = NRFX_PWM_PIN_NOT_USED;
-    pwm_config.base_clock = NRF_PWM_CLK_1MHz;
-    pwm_config.count_mode = NRF_PWM_MODE_UP;
-    pwm_config.top_value = PWM_TOP_VALUE;
-    pwm_config.load_mode = NRF_PWM_LOAD_INDIVIDUAL;
-    pwm_config.step_mode = NRF_PWM_STEP_AUTO;
-    
-    nrfx_pwm_init(&m_pwm_indicator, &pwm_config, NULL);
-    
-    pwm_indicator_values.channel_0 = 0;
-    nrfx_pwm_simple_playback(&m_pwm_indicator, &pwm_indicator_seq, 1, NRFX_PWM_FLAG_LOOP);
+    uint32_t update = m_rgb_update;
+
+    __atomic_store_n(&m_rgb_update, update + 1, __ATOMIC_RELAXED);
+    __atomic_signal_fence(__ATOMIC_SEQ_CST);
+    m_rgb_pending.channel_0 = r;
+    m_rgb_pending.channel_1 = b;
+    m_rgb_pending.channel_2 = g;
+    m_rgb_pending.channel_3 = 0;
+    m_rgb_pending_periods = fade_periods;
+    __atomic_store_n(&m_rgb_update, update + 2, __ATOMIC_RELEASE);
+
+    output_kick();
+    return (update + 2) >> 1;
+}
+
+_Static_assert(DITHER_MAX <= COLOR_CORRECT_MAX_INPUT, "calibration must take the dither range");
+
+static uint16_t round_to_count(uint16_t value)
+{
+    uint32_t counts = (value + DITHER_SCALE / 2u) / DITHER_SCALE;
+    return (uint16_t)(counts * DITHER_SCALE);
+}
+
+/* Public entry points go through the LD2 calibration first. The counts API
+ * rounds its result back to whole counts so it never dithers: streamed and
+ * scheduled frames must land within two periods. Restaging the color already
+ * staged with the same fade length changes nothing on the LED, so it is
+ * skipped and its update number returned. */
+static uint32_t stage_color(uint16_t r, uint16_t g, uint16_t b, uint32_t fade_periods,
+                            bool whole_counts)
+{
+    color_correct_apply(&r, &g, &b, DITHER_MAX);
+    if (whole_counts) {
+        r = round_to_count(r);
+        g = round_to_count(g);
+        b = round_to_count(b);
+    }
+    if (r == m_rgb_pending.channel_0 && g == m_rgb_pending.channel_2 &&
+        b == m_rgb_pending.channel_1 && fade_periods == m_rgb_pending_periods) {
+        return m_rgb_update >> 1;
+    }
+    return stage_rgb(r, g, b, fade_periods);
 }
 
-void pwm_set_rgb_values(uint16_t r, uint16_t g, uint16_t b)
+static uint32_t fade_ms_to_periods(uint32_t fade_ms)
 {
-    pwm_rgb_values.channel_0 = r;
-    pwm_rgb_values.channel_1 = b;
-    pwm_rgb_values.channel_2 = g;
-    pwm_rgb_values.channel_3 = 0;
+    uint32_t periods = PWM_PERIODS(fade_ms);
+    return periods >= 2 ? periods : 0;
 }
 
-void pwm_set_indicator_value(uint16_t value)
+uint32_t pwm_set_rgb_values(uint16_t r, uint16_t g, uint16_t b)
 {
-    pwm_indicator_values.channel_0 = value;
-}
\ No newline at end of file
+    return stage_color(r * DITHER_SCALE, g * DITHER_SCALE, b * DITHER_SCALE, 0, true);
+}
+
+uint32_t pwm_fade_rgb(uint16_t r, uint16_t g, uint16_t b, uint32_t fade_ms)
+{
+    return stage_color(r * DITHER_SCALE, g * DITHER_SCALE, b * DITHER_SCALE,
+                       fade_ms_to_periods(fade_ms), true);
+}
+
+uint32_t pwm_set_rgb16(uint16_t r, uint16_t g, uint16_t b)
+{
+    return stage_color(dither_from_duty16(r), dither_from_duty16(g), dither_from_duty16(b), 0, false);
+}
+
+uint32_t pwm_fade_rgb16(uint16_t r, uint16_t g, uint16_t b, uint32_t fade_ms)
+{
+    return stage_color(dither_from_duty16(r), dither_from_duty16(g), dither_from_duty16(b),
+                       fade_ms_to_periods(fade_ms), false);
+}
+
+uint32_t pwm_set_dither(bool enable)
+{
+    __atomic_store_n(&m_dither, enable, __ATOMIC_RELAXED);
+    /* Restaging the color makes the handler refill both buffers. */
+    return stage_rgb(m_rgb_pending.channel_0, m_rgb_pending.channel_2, m_rgb_pending.channel_1, 0);
+}
+
+bool pwm_dither_enabled(void)
+{
+    return m_dither;
+}
+
+uint32_t pwm_rgb_live_update(void)
+{
+    return __atomic_load_n(&m_rgb_live, __ATOMIC_ACQUIRE);
+}
+
+bool pwm_rgb_is_live(uint32_t update)
+{
+    return (int32_t)(pwm_rgb_live_update() - update) >= 0;
+}
+
+void pwm_indicator_set_pattern(pwm_indicator_pattern_t pattern)
+{
+    if (pattern >= PWM_INDICATOR_PATTERN_COUNT || pattern == m_indicator_request) {
+        return;
+    }
+
+    __atomic_store_n(&m_indicator_request, pattern, __ATOMIC_RELEASE);
+    output_kick();
+}
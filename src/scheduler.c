@@ -0,0 +1,37 @@
+#include "scheduler.h"
+
+static uint32_t m_deadlines[SCHED_SLOT_COUNT];
+static uint32_t m_armed_mask = 0;
+
+void sched_set(sched_slot_t slot, uint32_t deadline_ms)
+{
+    m_deadlines[slot] = deadline_ms;
+    m_armed_mask |= (1UL << slot);
+}
+
+void sched_clear(sched_slot_t slot)
+{
+    m_armed_mask &= ~(1UL << slot);
+}
+
+bool sched_next(uint32_t now_ms, uint32_t *p_deadline_ms)
+{
+    bool found = false;
+    int32_t earliest = 0;
+
+    for (uint32_t slot = 0; slot < SCHED_SLOT_COUNT; slot++) {
+        if (!(m_armed_mask & (1UL << slot))) continue;
+
+        /* Signed distance keeps the ordering correct across millis() wrap. */
+        int32_t distance = (int32_t)(m_deadlines[slot] - now_ms);
+        if (!found || distance < earliest) {
+            earliest = distance;
+            found = true;
+        }
+    }
+
+    if (found) {
+        *p_deadline_ms = now_ms + (uint32_t)earliest;
+    }
+    return found;
+}
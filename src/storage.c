@@ -1,10 +1,16 @@
 #include "storage.h"
+#include "color_state.h"
 #include "nrfx_nvmc.h"
 #include <string.h>
 #include <stdio.h>
 
 #define FLASH_STORAGE_ADDR 0x00060000 
 #define STORAGE_MAGIC      0xCAFEBABE
+#define CALIB_MAGIC        0xCA11B0A7
+#define COLORS_MAGIC       0xC0104016
+
+#define ERASE_SLICE_MS     2
+#define WRITE_CHUNK_WORDS  16
 
 typedef struct {
     char name[COLOR_NAME_MAX_LEN];
@@ -20,55 +26,124 @@ typedef struct {
     color_entry_t saved_colors[MAX_SAVED_COLORS];
 } flash_data_t;
 
+/* Appended after flash_data_t with its own magic, so images written before
+ * it existed read as uncalibrated and older firmware ignores it. */
+typedef struct {
+    uint32_t magic;
+    color_calib_t calib;
+} calib_record_t;
+
+/* The 16-bit duty cycles behind last_state and each saved entry, appended
+ * the same way. The HSV fields are still written for older firmware;
+ * without this record they are converted once at boot. */
+typedef struct {
+    uint32_t magic;
+    rgb16_t last_state;
+    rgb16_t saved_colors[MAX_SAVED_COLORS];
+} colors_record_t;
+
+typedef struct {
+    flash_data_t data;
+    calib_record_t calib;
+    colors_record_t colors;
+} flash_image_t;
+
+typedef enum {
+    SYNC_IDLE = 0,
+    SYNC_ERASE,
+    SYNC_WRITE
+} sync_state_t;
+
+#define FLASH_IMAGE_WORDS ((sizeof(flash_image_t) + 3) / 4)
+
 static flash_data_t m_ram_data __attribute__((aligned(4)));
+static calib_record_t m_ram_calib __attribute__((aligned(4)));
+static colors_record_t m_ram_colors __attribute__((aligned(4)));
+static flash_image_t m_write_image __attribute__((aligned(4)));
 
+static sync_state_t m_sync_state = SYNC_IDLE;
+static bool m_dirty = false;
+static uint32_t m_write_offset;
+
+/* The flash update itself runs in storage_process(), one short step per
+ * main loop pass, so no caller ever blocks for a whole page erase. */
 static void flash_sync(void) {
-    nrfx_nvmc_page_erase(FLASH_STORAGE_ADDR);
-    
-    uint32_t *p_src = (uint32_t *)&m_ram_data;
-    uint32_t words_to_write = sizeof(flash_data_t) / 4;
-    if (sizeof(flash_data_t) % 4 != 0) words_to_write++;
+    m_dirty = true;
+}
 
-    nrfx_nvmc_words_write(FLASH_STORAGE_ADDR, p_src, words_to_write);
-    
-    while (!nrfx_nvmc_write_done_check()) {}
+/* Through the brightness curve, so an old color shows as it did when the
+ * HSV path set it. */
+static void to_rgb16(const hsv_color_t *p_hsv, rgb16_t *p_rgb) {
+    color_from_hsv(p_hsv, p_rgb);
 }
 
 void storage_init(void) {
-    flash_data_t *p_flash = (flash_data_t *)FLASH_STORAGE_ADDR;
+    flash_image_t *p_flash = (flash_image_t *)FLASH_STORAGE_ADDR;
     
-    if (p_flash->magic == STORAGE_MAGIC) {
-        memcpy(&m_ram_data, p_flash, sizeof(flash_data_t));
+    if (p_flash->data.magic == STORAGE_MAGIC) {
+        memcpy(&m_ram_data, &p_flash->data, sizeof(flash_data_t));
     } else {
         memset(&m_ram_data, 0, sizeof(flash_data_t));
         m_ram_data.magic = STORAGE_MAGIC;
     }
+
+    if (p_flash->data.magic == STORAGE_MAGIC && p_flash->calib.magic == CALIB_MAGIC) {
+        memcpy(&m_ram_calib, &p_flash->calib, sizeof(calib_record_t));
+    } else {
+        m_ram_calib.magic = CALIB_MAGIC;
+        color_correct_default(&m_ram_calib.calib);
+    }
+
+    if (p_flash->data.magic == STORAGE_MAGIC && p_flash->colors.magic == COLORS_MAGIC) {
+        memcpy(&m_ram_colors, &p_flash->colors, sizeof(colors_record_t));
+    } else {
+        m_ram_colors.magic = COLORS_MAGIC;
+        to_rgb16(&m_ram_data.last_state, &m_ram_colors.last_state);
+        for (int i = 0; i < MAX_SAVED_COLORS; i++) {
+            to_rgb16(&m_ram_data.saved_colors[i].color, &m_ram_colors.saved_colors[i]);
+        }
+    }
 }
 
-void storage_save_current_hsv(const hsv_color_t *hsv) {
-    if (memcmp(&m_ram_data.last_state, hsv, sizeof(hsv_color_t)) != 0) {
-        m_ram_data.last_state = *hsv;
+void storage_save_calibration(const color_calib_t *p_calib) {
+    if (memcmp(&m_ram_calib.calib, p_calib, sizeof(color_calib_t)) != 0) {
+        m_ram_calib.calib = *p_calib;
         flash_sync();
     }
 }
 
-bool storage_get_last_hsv(hsv_color_t *hsv) {
+void storage_get_calibration(color_calib_t *p_calib) {
+    *p_calib = m_ram_calib.calib;
+}
+
+void storage_save_current(const rgb16_t *p_rgb, const hsv_color_t *p_hsv) {
+    if (memcmp(&m_ram_colors.last_state, p_rgb, sizeof(rgb16_t)) != 0 ||
+        memcmp(&m_ram_data.last_state, p_hsv, sizeof(hsv_color_t)) != 0) {
+        m_ram_colors.last_state = *p_rgb;
+        m_ram_data.last_state = *p_hsv;
+        flash_sync();
+    }
+}
+
+bool storage_get_last(rgb16_t *p_rgb, hsv_color_t *p_hsv) {
     flash_data_t *p_flash = (flash_data_t *)FLASH_STORAGE_ADDR;
     if (p_flash->magic != STORAGE_MAGIC) {
         return false;
     }
-    *hsv = m_ram_data.last_state;
+    *p_rgb = m_ram_colors.last_state;
+    *p_hsv = m_ram_data.last_state;
     return true;
 }
 
 
-bool storage_add_color(const char *name, const hsv_color_t *hsv) {
+bool storage_add_color(const char *name, const rgb16_t *p_rgb, const hsv_color_t *p_hsv) {
     int empty_idx = -1;
     
     for (int i = 0; i < MAX_SAVED_COLORS; i++) {
         if (m_ram_data.saved_colors[i].valid) {
             if (strcmp(m_ram_data.saved_colors[i].name, name) == 0) {
-                m_ram_data.saved_colors[i].color = *hsv;
+                m_ram_data.saved_colors[i].color = *p_hsv;
+                m_ram_colors.saved_colors[i] = *p_rgb;
                 flash_sync();
                 return true;
             }
@@ -80,7 +155,8 @@ bool storage_add_color(const char *name, const hsv_color_t *hsv) {
     if (empty_idx != -1) {
         strncpy(m_ram_data.saved_colors[empty_idx].name, name, COLOR_NAME_MAX_LEN - 1);
         m_ram_data.saved_colors[empty_idx].name[COLOR_NAME_MAX_LEN - 1] = '\0'; 
-        m_ram_data.saved_colors[empty_idx].color = *hsv;
+        m_ram_data.saved_colors[empty_idx].color = *p_hsv;
+        m_ram_colors.saved_colors[empty_idx] = *p_rgb;
         m_ram_data.saved_colors[empty_idx].valid = 1;
         flash_sync();
         return true;
@@ -102,27 +178,28 @@ bool storage_del_color(const char *name) {
     return false;
 }
 
-bool storage_get_color(const char *name, hsv_color_t *hsv) {
+bool storage_get_color(const char *name, rgb16_t *p_rgb, hsv_color_t *p_hsv) {
     for (int i = 0; i < MAX_SAVED_COLORS; i++) {
         if (m_ram_data.saved_colors[i].valid && 
             strcmp(m_ram_data.saved_colors[i].name, name) == 0) {
             
-            *hsv = m_ram_data.saved_colors[i].color;
+            *p_rgb = m_ram_colors.saved_colors[i];
+            *p_hsv = m_ram_data.saved_colors[i].color;
             return true;
         }
     }
     return false;
 }
 
-void storage_list_colors(void (*print_func)(const char *fmt, ...)) {
+void storage_list_colors(bool (*print_func)(const char *fmt, ...)) {
     bool found = false;
-    print_func("\r\nSaved Colors:\r\n");
+    if (!print_func("\r\nSaved Colors:\r\n")) return;
     
     for (int i = 0; i < MAX_SAVED_COLORS; i++) {
         if (m_ram_data.saved_colors[i].valid) {
             hsv_color_t *c = &m_ram_data.saved_colors[i].color;
-            print_func("  [%d] %s: H=%d S=%d V=%d\r\n", 
-                    i, m_ram_data.saved_colors[i].name, c->h, c->s, c->v);
+            if (!print_func("  [%d] %s: H=%d S=%d V=%d\r\n", 
+                    i, m_ram_data.saved_colors[i].name, c->h, c->s, c->v)) return;
             found = true;
         }
     }
@@ -130,4 +207,43 @@ void storage_list_colors(void (*print_func)(const char *fmt, ...)) {
     if (!found) {
         print_func("  (Empty)\r\n");
     }
-}
\ No newline at end of file
+}
+
+bool storage_process(void) {
+    switch (m_sync_state) {
+        case SYNC_IDLE:
+            if (!m_dirty) {
+                return false;
+            }
+            m_dirty = false;
+            memcpy(&m_write_image.data, &m_ram_data, sizeof(flash_data_t));
+            memcpy(&m_write_image.calib, &m_ram_calib, sizeof(calib_record_t));
+            memcpy(&m_write_image.colors, &m_ram_colors, sizeof(colors_record_t));
+            nrfx_nvmc_page_partial_erase_init(FLASH_STORAGE_ADDR, ERASE_SLICE_MS);
+            m_sync_state = SYNC_ERASE;
+            return true;
+
+        case SYNC_ERASE:
+            if (nrfx_nvmc_page_partial_erase_continue()) {
+                m_write_offset = 0;
+                m_sync_state = SYNC_WRITE;
+            }
+            return true;
+
+        case SYNC_WRITE:
+        {
+            uint32_t words = MIN(WRITE_CHUNK_WORDS, FLASH_IMAGE_WORDS - m_write_offset);
+            nrfx_nvmc_words_write(FLASH_STORAGE_ADDR + m_write_offset * 4,
+                                  (uint32_t *)&m_write_image + m_write_offset, words);
+            while (!nrfx_nvmc_write_done_check()) {}
+
+            m_write_offset += words;
+            if (m_write_offset >= FLASH_IMAGE_WORDS) {
+                m_sync_state = SYNC_IDLE;
+                return m_dirty;
+            }
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,175 @@
+#include "stream.h"
+
+#include <string.h>
+
+static uint8_t m_frame[STREAM_MAX_FRAME];
+static uint8_t m_len;
+static uint8_t m_code;
+static uint8_t m_code_left;
+static bool m_overflow;
+
+static bool m_seq_valid;
+static uint16_t m_seq_next;
+
+static stream_stats_t m_stats;
+
+static uint16_t get_u16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get_u32(const uint8_t *p)
+{
+    return get_u16(p) | ((uint32_t)get_u16(&p[2]) << 16);
+}
+
+static bool rgb_parse(const uint8_t *p, stream_frame_t *p_frame)
+{
+    p_frame->rgb.r = get_u16(&p[0]);
+    p_frame->rgb.g = get_u16(&p[2]);
+    p_frame->rgb.b = get_u16(&p[4]);
+    return p_frame->rgb.r <= PWM_TOP_VALUE && p_frame->rgb.g <= PWM_TOP_VALUE &&
+           p_frame->rgb.b <= PWM_TOP_VALUE;
+}
+
+uint16_t stream_crc16(const uint8_t *p_data, size_t len)
+{
+    uint16_t crc = 0xFFFF;
+    while (len--) {
+        crc ^= (uint16_t)(*p_data++ << 8);
+        for (int i = 0; i < 8; i++) {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+static void decoder_clear(void)
+{
+    m_len = 0;
+    m_code = 0;
+    m_code_left = 0;
+    m_overflow = false;
+}
+
+void stream_reset(void)
+{
+    decoder_clear();
+    m_seq_valid = false;
+}
+
+static void append(uint8_t byte)
+{
+    if (m_len < sizeof(m_frame)) {
+        m_frame[m_len++] = byte;
+    } else {
+        m_overflow = true;
+    }
+}
+
+static bool frame_parse(stream_frame_t *p_frame)
+{
+    const uint8_t *p = m_frame;
+    uint8_t payload_len = m_len - 5;
+
+    p_frame->type = (stream_frame_type_t)p[0];
+    p_frame->seq = get_u16(&p[1]);
+
+    switch (p_frame->type) {
+        case STREAM_FRAME_RGB:
+            if (payload_len != 6) return false;
+            return rgb_parse(&p[3], p_frame);
+
+        case STREAM_FRAME_RGB_AT:
+            if (payload_len != 10) return false;
+            p_frame->pts = get_u32(&p[3]);
+            return rgb_parse(&p[7], p_frame);
+
+        case STREAM_FRAME_HSV:
+            if (payload_len != 4) return false;
+            p_frame->hsv.h = get_u16(&p[3]);
+            p_frame->hsv.s = p[5];
+            p_frame->hsv.v = p[6];
+            return p_frame->hsv.h <= 360 && p_frame->hsv.s <= 100 && p_frame->hsv.v <= 100;
+
+        case STREAM_FRAME_EXIT:
+            return payload_len == 0;
+
+        default:
+            return false;
+    }
+}
+
+/* Lost frames show up as a forward jump in seq; a frame from behind the
+ * expected number is stale and is dropped. */
+static bool sequence_check(uint16_t seq)
+{
+    if (m_seq_valid) {
+        int16_t delta = (int16_t)(seq - m_seq_next);
+        if (delta < 0) {
+            m_stats.out_of_order++;
+            return false;
+        }
+        m_stats.lost += (uint16_t)delta;
+    }
+    m_seq_valid = true;
+    m_seq_next = seq + 1;
+    return true;
+}
+
+static bool frame_end(stream_frame_t *p_frame)
+{
+    if (m_len == 0 && m_code == 0) {
+        return false;
+    }
+    if (m_overflow || m_code_left != 0 || m_len < 5) {
+        m_stats.malformed++;
+        return false;
+    }
+    if (stream_crc16(m_frame, m_len - 2) != get_u16(&m_frame[m_len - 2])) {
+        m_stats.crc_errors++;
+        return false;
+    }
+    if (!frame_parse(p_frame)) {
+        m_stats.malformed++;
+        return false;
+    }
+    if (p_frame->type != STREAM_FRAME_EXIT && !sequence_check(p_frame->seq)) {
+        return false;
+    }
+    m_stats.frames++;
+    return true;
+}
+
+bool stream_rx_byte(uint8_t byte, stream_frame_t *p_frame)
+{
+    if (byte == 0) {
+        bool valid = frame_end(p_frame);
+        decoder_clear();
+        return valid;
+    }
+
+    if (m_code_left == 0) {
+        /* A code byte; the block before it ended in an implicit zero
+         * unless it was a full 254-byte run. */
+        if (m_code != 0 && m_code != 0xFF) {
+            append(0);
+        }
+        m_code = byte;
+        m_code_left = byte - 1;
+    } else {
+        append(byte);
+        m_code_left--;
+    }
+    return false;
+}
+
+void stream_stats_get(stream_stats_t *p_stats)
+{
+    *p_stats = m_stats;
+}
+
+void stream_stats_reset(void)
+{
+    memset(&m_stats, 0, sizeof(m_stats));
+}
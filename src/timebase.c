@@ -0,0 +1,103 @@
+#include "timebase.h"
+#include "isr_stats.h"
+#include "nrf.h"
+#include "nrfx_rtc.h"
+
+#define TIMEBASE_RTC_FREQ       32768
+#define TIMEBASE_COUNTER_BITS   24
+#define TIMEBASE_COUNTER_MASK   ((1UL << TIMEBASE_COUNTER_BITS) - 1)
+#define TIMEBASE_WAKE_CC        0
+#define TIMEBASE_MIN_CC_DELTA   2
+#define TIMEBASE_MAX_CC_DELTA   (TIMEBASE_COUNTER_MASK >> 1)
+
+static const nrfx_rtc_t m_rtc = NRFX_RTC_INSTANCE(1);
+static volatile uint32_t m_overflows = 0;
+
+static uint64_t ticks_get(void)
+{
+    uint32_t overflows;
+    uint32_t counter;
+
+    do {
+        overflows = m_overflows;
+        counter = nrfx_rtc_counter_get(&m_rtc);
+    } while (overflows != m_overflows);
+
+    /* Called from an ISR that blocks the RTC one, the wrap may not be
+     * accounted for yet. */
+    if (nrf_rtc_event_check(m_rtc.p_reg, NRF_RTC_EVENT_OVERFLOW) &&
+        counter < (TIMEBASE_COUNTER_MASK >> 1)) {
+        overflows++;
+    }
+
+    return ((uint64_t)overflows << TIMEBASE_COUNTER_BITS) | counter;
+}
+
+static uint64_t ms_to_ticks(uint64_t ms)
+{
+    return (ms * TIMEBASE_RTC_FREQ + 999) / 1000;
+}
+
+static uint64_t ticks_to_ms(uint64_t ticks)
+{
+    return (ticks * 1000) / TIMEBASE_RTC_FREQ;
+}
+
+static void rtc_handler(nrfx_rtc_int_type_t int_type)
+{
+    uint32_t start = isr_stats_begin();
+    if (int_type == NRFX_RTC_INT_OVERFLOW) {
+        m_overflows++;
+    }
+    isr_stats_end(ISR_STATS_RTC, start);
+}
+
+void timebase_init(void)
+{
+    nrfx_rtc_config_t config = NRFX_RTC_DEFAULT_CONFIG;
+    config.prescaler = RTC_FREQ_TO_PRESCALER(TIMEBASE_RTC_FREQ);
+
+    nrfx_rtc_init(&m_rtc, &config, rtc_handler);
+    nrfx_rtc_overflow_enable(&m_rtc, true);
+    nrfx_rtc_enable(&m_rtc);
+}
+
+uint32_t timebase_millis(void)
+{
+    return (uint32_t)ticks_to_ms(ticks_get());
+}
+
+static void wait_for_event(void)
+{
+    __WFE();
+    __SEV();
+    __WFE();
+}
+
+void timebase_sleep(void)
+{
+    nrfx_rtc_cc_disable(&m_rtc, TIMEBASE_WAKE_CC);
+    wait_for_event();
+}
+
+/* Sleeps until the deadline or any other interrupt. Deadlines beyond half
+ * the counter span wake early; the caller simply goes back to sleep. */
+void timebase_sleep_until(uint32_t deadline_ms)
+{
+    uint64_t now = ticks_get();
+    uint32_t now_ms = (uint32_t)ticks_to_ms(now);
+    int32_t remaining_ms = (int32_t)(deadline_ms - now_ms);
+
+    if (remaining_ms <= 0) {
+        return;
+    }
+
+    uint64_t target = ms_to_ticks(ticks_to_ms(now) + (uint32_t)remaining_ms);
+    if (target < now + TIMEBASE_MIN_CC_DELTA) {
+        target = now + TIMEBASE_MIN_CC_DELTA;
+    } else if (target > now + TIMEBASE_MAX_CC_DELTA) {
+        target = now + TIMEBASE_MAX_CC_DELTA;
+    }
+    nrfx_rtc_cc_set(&m_rtc, TIMEBASE_WAKE_CC, (uint32_t)(target & TIMEBASE_COUNTER_MASK), true);
+    wait_for_event();
+}
@@ -6,21 +6,23 @@
 #include "app_usbd_core.h"
 #include "hsv.h"
 #include "pwm_leds.h"
-#include "nrf_delay.h"
+#include "curve.h"
+#include "color_state.h"
 #include "storage.h"
+#include "isr_stats.h"
+#include "timebase.h"
+#include "spsc_ring.h"
+#include "stream.h"
+#include "playout.h"
 
 #include <stdio.h>
 #include <string.h>
-#include <stdlib.h>
 #include <strings.h>
 #include <stdbool.h>
 #include <stdarg.h>
 
 bool app_usbd_event_queue_process(void);
 
-extern void update_hsv_state(hsv_color_t new_hsv);
-extern hsv_color_t current_hsv;
-
 static void cdc_acm_user_ev_handler(app_usbd_class_inst_t const * p_inst,
                                     app_usbd_cdc_acm_user_event_t event);
 
@@ -39,56 +41,353 @@ APP_USBD_CDC_ACM_GLOBAL_DEF(m_app_cdc_acm,
                             CDC_ACM_DATA_EPOUT,
                             APP_USBD_CDC_COMM_PROTOCOL_AT_V250);
 
-#define RX_BUF_SIZE 256
-static char m_fifo_buffer[RX_BUF_SIZE];
-static volatile uint16_t m_fifo_head = 0;
-static volatile uint16_t m_fifo_tail = 0;
+#define RX_BUF_SIZE 1024
+SPSC_RING_DEF(m_rx_fifo, char, RX_BUF_SIZE);
+
+static char m_rx_packet[NRF_DRV_USBD_EPSIZE];
+static bool m_rx_armed = false;
+/* PORT_OPEN/PORT_CLOSE follow the DTR line set by the terminal. */
+static bool m_port_open = false;
+static bool m_usb_suspended = false;
+static char m_line_buffer[256];
+static uint16_t m_line_idx = 0;
+static bool m_line_overflow = false;
+
+/* While set, RX bytes go to the binary frame decoder instead of the line
+ * editor. */
+static bool m_stream_mode = false;
+/* Quiet mode: no echo, no prompt, one status line per command. */
+static bool m_quiet = false;
+static bool m_stream_skip_lf = false;
+static bool m_stream_rgb_pending = false;
+static uint16_t m_stream_rgb[3];
+
+/* Room for the longest reply a single command produces, checked at build
+ * time against the help text. Each command, pipelined ones included, only
+ * runs while this much TX space is free; RX is read no further meanwhile. */
+#define TX_BUF_SIZE      2048
+#define TX_CMD_RESERVE   1280
+/* A terminal that is open but has not taken a packet for this long is
+ * treated as gone until the endpoint moves again. */
+#define TX_STALL_MS      100
+
+SPSC_RING_DEF(m_tx_ring, char, TX_BUF_SIZE);
+static char m_tx_packet[NRF_DRV_USBD_EPSIZE];
+static bool m_tx_busy = false;
+static bool m_tx_stalled = false;
+static uint32_t m_tx_progress_ms = 0;
+/* Output thrown away by the consumer side; producer-side overflow is
+ * counted by the ring itself. */
+static uint32_t m_tx_discarded = 0;
+/* Set once a write of the current command did not fit; the rest of its
+ * output is dropped too, so the terminal never sees a reply with a hole in
+ * the middle. m_tx_truncated counts the commands cut short. */
+static bool m_tx_cut = false;
+static uint32_t m_tx_truncated = 0;
+/* usb_stats asks the RX producer to restart its counters. */
+static bool m_rx_stats_reset = false;
+
+static void rx_store(size_t size) {
+    if (m_rx_stats_reset) {
+        m_rx_stats_reset = false;
+        spsc_ring_stats_reset(&m_rx_fifo);
+    }
+    spsc_ring_put(&m_rx_fifo, m_rx_packet, size);
+}
+
+/* Reads whole packets straight into the FIFO. A read is only armed while a
+ * full packet still fits, otherwise the endpoint NAKs and the host waits
+ * until cli_process() has made room. */
+static void rx_start(void) {
+    m_rx_armed = false;
+    while (m_port_open && spsc_ring_free(&m_rx_fifo) >= sizeof(m_rx_packet)) {
+        ret_code_t ret = app_usbd_cdc_acm_read_any(&m_app_cdc_acm, m_rx_packet, sizeof(m_rx_packet));
+        if (ret == NRF_SUCCESS) {
+            rx_store(app_usbd_cdc_acm_rx_size(&m_app_cdc_acm));
+        } else {
+            m_rx_armed = (ret == NRF_ERROR_IO_PENDING);
+            return;
+        }
+    }
+}
+
+static void tx_discard(void) {
+    m_tx_discarded += spsc_ring_skip(&m_tx_ring, spsc_ring_used(&m_tx_ring));
+}
+
+static void tx_reset(void) {
+    tx_discard();
+    m_tx_busy = false;
+    m_tx_stalled = false;
+}
+
+static bool tx_listening(void) {
+    return m_port_open && !m_usb_suspended && !m_tx_stalled;
+}
+
+/* Output for nobody is dropped anyway, so only a listener needs room. */
+static bool tx_has_room(void) {
+    return !tx_listening() || spsc_ring_free(&m_tx_ring) >= TX_CMD_RESERVE;
+}
+
+/* Starts the next IN transfer if the endpoint is idle. Everything queued
+ * since the last transfer goes out together, up to one full packet. */
+static void tx_kick(void) {
+    if (m_tx_busy || !m_port_open || m_usb_suspended) return;
 
-static char m_usb_rx_char;
-static char m_line_buffer[128];
-static uint8_t m_line_idx = 0;
-static char m_tx_buffer[512];
+    uint32_t len = spsc_ring_peek(&m_tx_ring, m_tx_packet, sizeof(m_tx_packet));
+    if (len == 0) return;
 
-static void fifo_put(char c) {
-    uint16_t next_head = (m_fifo_head + 1) % RX_BUF_SIZE;
-    if (next_head != m_fifo_tail) {
-        m_fifo_buffer[m_fifo_head] = c;
-        m_fifo_head = next_head;
+    if (app_usbd_cdc_acm_write(&m_app_cdc_acm, m_tx_packet, len) == NRF_SUCCESS) {
+        spsc_ring_skip(&m_tx_ring, len);
+        m_tx_busy = true;
+        m_tx_stalled = false;
     }
 }
 
-static bool fifo_get(char *c) {
-    if (m_fifo_head == m_fifo_tail) {
+/* Output owed to the host that has not moved for TX_STALL_MS is thrown
+ * away; later output keeps queuing in the ring, bounded by its size, and is
+ * flushed if the host starts reading again. A suspended bus is not a stall:
+ * the ring is kept for the resume. */
+static void tx_watchdog(uint32_t now) {
+    if ((!m_tx_busy && spsc_ring_is_empty(&m_tx_ring)) || m_usb_suspended) {
+        m_tx_progress_ms = now;
+    } else if (!m_tx_stalled && now - m_tx_progress_ms >= TX_STALL_MS) {
+        m_tx_stalled = true;
+        tx_discard();
+    }
+}
+
+/* Queues output without waiting for the host. A write goes in whole or not
+ * at all; once one is refused, the output that follows is dropped as well
+ * until tx_begin(). Returns false for dropped output, which is counted. */
+static bool usb_write(const char *data, size_t len) {
+    if (!m_port_open) {
+        m_tx_discarded += len;
+        return false;
+    }
+    if (m_tx_cut) {
+        m_tx_ring.dropped += len;
+        return false;
+    }
+    if (!spsc_ring_put_all(&m_tx_ring, data, len)) {
+        m_tx_cut = true;
         return false;
     }
-    *c = m_fifo_buffer[m_fifo_tail];
-    m_fifo_tail = (m_fifo_tail + 1) % RX_BUF_SIZE;
     return true;
 }
 
-static void usb_send_blocking(const char *data, size_t len) {
-    if (len == 0) return;
-    if (len > sizeof(m_tx_buffer)) len = sizeof(m_tx_buffer);
-    
-    memcpy(m_tx_buffer, data, len);
-    
-    ret_code_t ret;
-    int timeout = 100000;
-    
-    do {
-        ret = app_usbd_cdc_acm_write(&m_app_cdc_acm, m_tx_buffer, len);
-        if (ret == NRF_ERROR_BUSY) {
-            nrf_delay_us(50); 
-            timeout--;
+/* Starts a new unit of output: a command's reply or an echoed character. */
+static void tx_begin(void) {
+    m_tx_cut = false;
+}
+
+static bool usb_print(const char *msg) {
+    return usb_write(msg, strlen(msg));
+}
+
+static bool usb_printf(const char *fmt, ...) {
+    char buf[128];
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(buf, sizeof(buf), fmt, args);
+    va_end(args);
+    return usb_print(buf);
+}
+
+typedef enum {
+    CLI_OK = 0,
+    CLI_ERR_UNKNOWN,
+    CLI_ERR_USAGE,
+    CLI_ERR_NOT_FOUND,
+    CLI_ERR_FULL,
+    CLI_ERR_TOO_LONG
+} cli_status_t;
+
+typedef enum {
+    CLI_ARG_INT,
+    CLI_ARG_NAME
+} cli_arg_type_t;
+
+typedef struct {
+    cli_arg_type_t type;
+    int32_t min;
+    int32_t max;
+    bool optional;
+} cli_arg_spec_t;
+
+typedef union {
+    int32_t num;
+    const char *str;
+} cli_arg_t;
+
+#define CLI_MAX_ARGS 4
+
+#define ARG_INT(_min, _max) { CLI_ARG_INT, (_min), (_max), false }
+#define ARG_NAME            { CLI_ARG_NAME, 1, COLOR_NAME_MAX_LEN - 1, false }
+/* Trailing arguments that may be left out; they read as 0. */
+#define ARG_OPT_INT(_min, _max) { CLI_ARG_INT, (_min), (_max), true }
+#define ARG_FADE_MS         ARG_OPT_INT(0, PWM_FADE_MAX_MS)
+
+static const cli_arg_spec_t m_args_rgb[]      = { ARG_INT(0, 1000), ARG_INT(0, 1000), ARG_INT(0, 1000), ARG_FADE_MS };
+static const cli_arg_spec_t m_args_hsv[]      = { ARG_INT(0, 360), ARG_INT(0, 100), ARG_INT(0, 100), ARG_FADE_MS };
+static const cli_arg_spec_t m_args_rgb_name[] = { ARG_INT(0, 1000), ARG_INT(0, 1000), ARG_INT(0, 1000), ARG_NAME };
+static const cli_arg_spec_t m_args_hsv_name[] = { ARG_INT(0, 360), ARG_INT(0, 100), ARG_INT(0, 100), ARG_NAME };
+static const cli_arg_spec_t m_args_name[]     = { ARG_NAME };
+static const cli_arg_spec_t m_args_name_fade[] = { ARG_NAME, ARG_FADE_MS };
+static const cli_arg_spec_t m_args_flag[]     = { ARG_INT(0, 1) };
+static const cli_arg_spec_t m_args_curve[]    = { ARG_INT(0, CURVE_COUNT - 1) };
+static const cli_arg_spec_t m_args_cal_gain[] = { ARG_INT(0, 1000), ARG_INT(0, 1000), ARG_INT(0, 1000) };
+static const cli_arg_spec_t m_args_cal_row[]  = { ARG_INT(0, 2), ARG_INT(-1000, 1000), ARG_INT(-1000, 1000), ARG_INT(-1000, 1000) };
+
+#define CLI_ARGS(_specs)  (_specs), (sizeof(_specs) / sizeof((_specs)[0]))
+#define CLI_NO_ARGS       NULL, 0
+
+/* Every command, in the order help lists them: name, argument schema,
+ * usage and help text. Each one is handled by cmd_<name>(). */
+#define CLI_COMMANDS(X)                                                                        \
+    X(help,              CLI_NO_ARGS,                 "",                        "This list")         \
+    X(RGB,               CLI_ARGS(m_args_rgb),        "<r> <g> <b> [ms]",        "Set RGB")           \
+    X(HSV,               CLI_ARGS(m_args_hsv),        "<h> <s> <v> [ms]",        "Set HSV")           \
+    X(add_rgb_color,     CLI_ARGS(m_args_rgb_name),   "<r> <g> <b> <name>",      "Save RGB")          \
+    X(add_hsv_color,     CLI_ARGS(m_args_hsv_name),   "<h> <s> <v> <name>",      "Save HSV")          \
+    X(add_current_color, CLI_ARGS(m_args_name),       "<name>",                  "Save current")      \
+    X(del_color,         CLI_ARGS(m_args_name),       "<name>",                  "Delete")            \
+    X(apply_color,       CLI_ARGS(m_args_name_fade),  "<name> [ms]",             "Load")              \
+    X(list_colors,       CLI_NO_ARGS,                 "",                        "Show saved")        \
+    X(isr_stats,         CLI_NO_ARGS,                 "",                        "Worst ISR times")   \
+    X(usb_stats,         CLI_NO_ARGS,                 "",                        "USB buffer usage")  \
+    X(stream,            CLI_NO_ARGS,                 "",                        "Binary color stream") \
+    X(stream_stats,      CLI_NO_ARGS,                 "",                        "Stream frame counters") \
+    X(curve,             CLI_ARGS(m_args_curve),      "<0|1|2>",                 "Brightness curve")  \
+    X(cal_gain,          CLI_ARGS(m_args_cal_gain),   "<r> <g> <b>",             "LD2 gains, 1/1000") \
+    X(cal_matrix,        CLI_ARGS(m_args_cal_row),    "<row> <r> <g> <b>",       "LD2 matrix row")    \
+    X(cal_show,          CLI_NO_ARGS,                 "",                        "Show calibration")  \
+    X(cal_reset,         CLI_NO_ARGS,                 "",                        "Clear calibration") \
+    X(dither,            CLI_ARGS(m_args_flag),       "<0|1>",                   "Sub-count PWM")     \
+    X(quiet,             CLI_ARGS(m_args_flag),       "<0|1>",                   "Status codes only")
+
+typedef struct {
+    const char *name;
+    cli_status_t (*handler)(const cli_arg_t *p_args);
+    const cli_arg_spec_t *p_args;
+    uint8_t arg_count;
+    const char *usage;
+    const char *help;
+} cli_command_t;
+
+#define CLI_DECLARE_HANDLER(_name, _args, _usage, _help) \
+    static cli_status_t cmd_##_name(const cli_arg_t *p_args);
+CLI_COMMANDS(CLI_DECLARE_HANDLER)
+
+#define CLI_TABLE_ENTRY(_name, _args, _usage, _help) \
+    { #_name, cmd_##_name, _args, _usage, _help },
+static const cli_command_t m_commands[] = {
+    CLI_COMMANDS(CLI_TABLE_ENTRY)
+};
+
+#define CLI_COMMAND_COUNT (sizeof(m_commands) / sizeof(m_commands[0]))
+
+/* help prints a header and a line per command: the name and usage padded
+ * to 34 characters but cut at 39, then the help text. */
+#define CLI_HELP_LINE_SIZE(_name, _args, _usage, _help) + (2 + 39 + 1 + sizeof(_help) - 1 + 2)
+enum { CLI_HELP_SIZE = sizeof("\r\nCommands:\r\n") - 1 CLI_COMMANDS(CLI_HELP_LINE_SIZE) };
+_Static_assert(CLI_HELP_SIZE + sizeof("ERR 99\r\n\r\n> ") <= TX_CMD_RESERVE,
+               "TX_CMD_RESERVE must hold the help text");
+_Static_assert(TX_CMD_RESERVE <= TX_BUF_SIZE, "TX ring smaller than one reply");
+
+/* Indices into m_commands sorted by name, filled once by cli_init(). */
+static uint8_t m_command_order[CLI_COMMAND_COUNT];
+
+static void command_order_init(void) {
+    for (uint8_t i = 0; i < CLI_COMMAND_COUNT; i++) {
+        uint8_t j = i;
+        while (j > 0 && strcasecmp(m_commands[m_command_order[j - 1]].name, m_commands[i].name) > 0) {
+            m_command_order[j] = m_command_order[j - 1];
+            j--;
         }
-    } while (ret == NRF_ERROR_BUSY && timeout > 0);
+        m_command_order[j] = i;
+    }
+}
+
+static const cli_command_t *command_find(const char *name) {
+    uint8_t lo = 0;
+    uint8_t hi = CLI_COMMAND_COUNT;
+    while (lo < hi) {
+        uint8_t mid = (lo + hi) / 2;
+        const cli_command_t *p_cmd = &m_commands[m_command_order[mid]];
+        int cmp = strcasecmp(name, p_cmd->name);
+        if (cmp == 0) return p_cmd;
+        if (cmp < 0) hi = mid;
+        else lo = mid + 1;
+    }
+    return NULL;
+}
+
+/* Splits the line in place: separators are overwritten with '\0' and the
+ * tokens point into the line. Returns -1 if there are more than max, in
+ * which case the first max tokens are still filled in. */
+static int tokenize(char *line, char **p_tokens, int max) {
+    int count = 0;
+    for (;;) {
+        while (*line == ' ' || *line == '\t') line++;
+        if (*line == '\0') return count;
+        if (count == max) return -1;
+        p_tokens[count++] = line;
+        while (*line != '\0' && *line != ' ' && *line != '\t') line++;
+        if (*line != '\0') *line++ = '\0';
+    }
+}
+
+/* Plain decimal only: a minus sign only where min is negative, no trailing
+ * characters, range checked. */
+static bool parse_int(const char *str, int32_t min, int32_t max, int32_t *p_value) {
+    int32_t value = 0;
+    bool negative = (*str == '-' && min < 0);
+    if (negative) str++;
+    if (*str == '\0') return false;
+    for (; *str != '\0'; str++) {
+        if (*str < '0' || *str > '9') return false;
+        int32_t digit = *str - '0';
+        if (value > (INT32_MAX - digit) / 10) return false;
+        value = value * 10 + digit;
+    }
+    if (negative) value = -value;
+    if (value < min || value > max) return false;
+    *p_value = value;
+    return true;
 }
 
-static void usb_print(const char *msg) {
-    usb_send_blocking(msg, strlen(msg));
+static bool parse_args(const cli_command_t *p_cmd, char **p_tokens, int count, cli_arg_t *p_args) {
+    if (count > p_cmd->arg_count) return false;
+
+    for (int i = 0; i < p_cmd->arg_count; i++) {
+        const cli_arg_spec_t *p_spec = &p_cmd->p_args[i];
+        if (i >= count) {
+            if (!p_spec->optional) return false;
+            p_args[i].num = 0;
+        } else if (p_spec->type == CLI_ARG_INT) {
+            if (!parse_int(p_tokens[i], p_spec->min, p_spec->max, &p_args[i].num)) return false;
+        } else {
+            size_t len = strlen(p_tokens[i]);
+            if (len < (size_t)p_spec->min || len > (size_t)p_spec->max) return false;
+            p_args[i].str = p_tokens[i];
+        }
+    }
+    return true;
 }
 
-static void usb_printf(const char *fmt, ...) {
+static void prompt(void) {
+    if (!m_quiet && !m_stream_mode) {
+        usb_print("> ");
+    }
+}
+
+/* Human-readable confirmations; quiet mode replaces them with the status
+ * line printed by process_command(). */
+static void reply(const char *fmt, ...) {
+    if (m_quiet) return;
+
     char buf[128];
     va_list args;
     va_start(args, fmt);
@@ -97,157 +396,397 @@ static void usb_printf(const char *fmt, ...) {
     usb_print(buf);
 }
 
+static void report(cli_status_t status) {
+    if (!m_quiet) return;
+
+    if (status == CLI_OK) usb_print("OK\r\n");
+    else usb_printf("ERR %d\r\n", (int)status);
+}
+
 static void process_command(char *cmd) {
-    char *token = strtok(cmd, " \r\n");
+    char *tokens[1 + CLI_MAX_ARGS];
+    int count = tokenize(cmd, tokens, 1 + CLI_MAX_ARGS);
 
-    if (token == NULL) {
-        usb_print("\r\n> ");
+    if (count == 0) {
         return;
     }
 
-    if (strcasecmp(token, "help") == 0) {
-        usb_print("\r\nCommands:\r\n"
-                  "  RGB <r> <g> <b>                    Set RGB\r\n"
-                  "  HSV <h> <s> <v>                    Set HSV\r\n"
-                  "  add_rgb_color <r> <g> <b> <name>   Save RGB\r\n"
-                  "  add_hsv_color <h> <s> <v> <name>   Save HSV\r\n"
-                  "  add_current_color <name>           Save current\r\n"
-                  "  del_color <name>                   Delete\r\n"
-                  "  apply_color <name>                 Load\r\n"
-                  "  list_colors                        Show saved\r\n");
-    } 
-    else if (strcasecmp(token, "RGB") == 0) {
-        int r = -1, g = -1, b = -1;
-        char *arg1 = strtok(NULL, " "); 
-        char *arg2 = strtok(NULL, " "); 
-        char *arg3 = strtok(NULL, " ");
-        
-        if (arg1) r = atoi(arg1); 
-        if (arg2) g = atoi(arg2); 
-        if (arg3) b = atoi(arg3);
-
-        if (r >= 0 && r <= 1000 && g >= 0 && g <= 1000 && b >= 0 && b <= 1000) {
-            hsv_color_t hsv;
-            rgb_to_hsv_simple(r, g, b, &hsv.h, &hsv.s, &hsv.v);
-            update_hsv_state(hsv);
-            usb_printf("\r\nSet RGB: %d %d %d\r\n", r, g, b);
-        } else usb_print("\r\nInvalid RGB\r\n");
-    }
-    else if (strcasecmp(token, "HSV") == 0) {
-        int h = -1, s = -1, v = -1;
-        char *arg1 = strtok(NULL, " "); 
-        char *arg2 = strtok(NULL, " "); 
-        char *arg3 = strtok(NULL, " ");
-        
-        if (arg1) h = atoi(arg1); 
-        if (arg2) s = atoi(arg2); 
-        if (arg3) v = atoi(arg3);
-
-        if (h >= 0 && h <= 360 && s >= 0 && s <= 100 && v >= 0 && v <= 100) {
-            hsv_color_t hsv = { (uint16_t)h, (uint8_t)s, (uint8_t)v };
-            update_hsv_state(hsv);
-            usb_printf("\r\nSet HSV: %d %d %d\r\n", h, s, v);
-        } else usb_print("\r\nInvalid HSV\r\n");
-    }
-    else if (strcasecmp(token, "add_rgb_color") == 0) {
-        int r = -1, g = -1, b = -1;
-        char *arg1 = strtok(NULL, " "); 
-        char *arg2 = strtok(NULL, " "); 
-        char *arg3 = strtok(NULL, " "); 
-        char *name = strtok(NULL, " ");
-        
-        if (arg1) r = atoi(arg1); 
-        if (arg2) g = atoi(arg2); 
-        if (arg3) b = atoi(arg3);
-
-        if (r >= 0 && r <= 1000 && g >= 0 && g <= 1000 && b >= 0 && b <= 1000 && name) {
-            hsv_color_t hsv;
-            rgb_to_hsv_simple(r, g, b, &hsv.h, &hsv.s, &hsv.v);
-            storage_save_current_hsv(&current_hsv);
-            if(storage_add_color(name, &hsv)) usb_print("\r\nSaved.\r\n");
-            else usb_print("\r\nFailed (Full?)\r\n");
-        } else usb_print("\r\nUsage: add_rgb_color <r> <g> <b> <name>\r\n");
-    }
-    else if (strcasecmp(token, "add_hsv_color") == 0) {
-        int h = -1, s = -1, v = -1;
-        char *arg1 = strtok(NULL, " "); 
-        char *arg2 = strtok(NULL, " "); 
-        char *arg3 = strtok(NULL, " "); 
-        char *name = strtok(NULL, " ");
-        
-        if (arg1) h = atoi(arg1); 
-        if (arg2) s = atoi(arg2); 
-        if (arg3) v = atoi(arg3);
-
-        if (h >= 0 && h <= 360 && s >= 0 && s <= 100 && v >= 0 && v <= 100 && name) {
-            hsv_color_t hsv = { (uint16_t)h, (uint8_t)s, (uint8_t)v };
-            storage_save_current_hsv(&current_hsv);
-            if(storage_add_color(name, &hsv)) usb_print("\r\nSaved.\r\n");
-            else usb_print("\r\nFailed (Full?)\r\n");
-        } else usb_print("\r\nUsage: add_hsv_color <h> <s> <v> <name>\r\n");
-    }
-    else if (strcasecmp(token, "add_current_color") == 0) {
-        char *name = strtok(NULL, " ");
-        if (name) {
-            storage_save_current_hsv(&current_hsv);
-            if(storage_add_color(name, &current_hsv)) usb_print("\r\nSaved current.\r\n");
-            else usb_print("\r\nFailed (Full?)\r\n");
-        } else usb_print("\r\nUsage: add_current_color <name>\r\n");
-    }
-    else if (strcasecmp(token, "del_color") == 0) {
-        char *name = strtok(NULL, " ");
-        if (name) {
-            if(storage_del_color(name)) usb_print("\r\nDeleted.\r\n");
-            else usb_print("\r\nNot found.\r\n");
-        } else usb_print("\r\nUsage: del_color <name>\r\n");
-    }
-    else if (strcasecmp(token, "apply_color") == 0) {
-        char *name = strtok(NULL, " ");
-        hsv_color_t hsv;
-        if (name) {
-            if(storage_get_color(name, &hsv)) {
-                update_hsv_state(hsv);
-                storage_save_current_hsv(&current_hsv);
-                usb_print("\r\nApplied.\r\n");
-            } else usb_print("\r\nNot found.\r\n");
-        } else usb_print("\r\nUsage: apply_color <name>\r\n");
-    }
-    else if (strcasecmp(token, "list_colors") == 0) {
-        storage_list_colors(usb_printf);
-    }
-    else {
-        usb_print("\r\nUnknown command\r\n");
-    }
-    
-    usb_print("> ");
+    tx_begin();
+    const cli_command_t *p_cmd = command_find(tokens[0]);
+    cli_arg_t args[CLI_MAX_ARGS];
+    cli_status_t status;
+
+    if (p_cmd == NULL) {
+        reply("\r\nUnknown command\r\n");
+        status = CLI_ERR_UNKNOWN;
+    } else if (!parse_args(p_cmd, &tokens[1], count - 1, args)) {
+        reply("\r\nUsage: %s %s\r\n", p_cmd->name, p_cmd->usage);
+        status = CLI_ERR_USAGE;
+    } else {
+        status = p_cmd->handler(args);
+    }
+
+    report(status);
+    if (m_tx_cut) {
+        m_tx_truncated++;
+    }
+}
+
+/* Rest of a line whose commands wait for TX space; points into
+ * m_line_buffer, which is left alone until the line is done. */
+static char *m_line_rest = NULL;
+
+/* A line may carry several commands separated by ';'. Once a command
+ * switches to stream mode the rest of the line is ignored, since what
+ * follows on the wire is binary. A command that would not find room for
+ * its reply is held back with the rest of the line, and cli_process()
+ * resumes it once the host has taken enough output. */
+static void process_line(char *line) {
+    while (line != NULL && !m_stream_mode) {
+        if (!tx_has_room()) {
+            m_line_rest = line;
+            return;
+        }
+        char *next = strchr(line, ';');
+        if (next != NULL) *next++ = '\0';
+        process_command(line);
+        line = next;
+    }
+    m_line_rest = NULL;
+    prompt();
+}
+
+static cli_status_t cmd_help(const cli_arg_t *p_args) {
+    usb_print("\r\nCommands:\r\n");
+    for (uint8_t i = 0; i < CLI_COMMAND_COUNT; i++) {
+        const cli_command_t *p_cmd = &m_commands[i];
+        char line[40];
+        snprintf(line, sizeof(line), "%s %s", p_cmd->name, p_cmd->usage);
+        if (!usb_printf("  %-34s %s\r\n", line, p_cmd->help)) break;
+    }
+    return CLI_OK;
+}
+
+static void args_to_rgb16(const cli_arg_t *p_args, rgb16_t *p_rgb) {
+    p_rgb->r = color_from_counts((uint16_t)p_args[0].num);
+    p_rgb->g = color_from_counts((uint16_t)p_args[1].num);
+    p_rgb->b = color_from_counts((uint16_t)p_args[2].num);
+}
+
+static cli_status_t cmd_RGB(const cli_arg_t *p_args) {
+    rgb16_t rgb;
+    args_to_rgb16(p_args, &rgb);
+    color_state_set_rgb16(&rgb, p_args[3].num);
+    reply("\r\nSet RGB: %ld %ld %ld\r\n", (long)p_args[0].num, (long)p_args[1].num, (long)p_args[2].num);
+    return CLI_OK;
+}
+
+static cli_status_t cmd_HSV(const cli_arg_t *p_args) {
+    hsv_color_t hsv = { (uint16_t)p_args[0].num, (uint8_t)p_args[1].num, (uint8_t)p_args[2].num };
+    color_state_set_hsv(&hsv, p_args[3].num);
+    reply("\r\nSet HSV: %ld %ld %ld\r\n", (long)p_args[0].num, (long)p_args[1].num, (long)p_args[2].num);
+    return CLI_OK;
+}
+
+static void save_current(void) {
+    rgb16_t rgb;
+    hsv_color_t hsv;
+    color_state_get_rgb16(&rgb);
+    color_state_get_hsv(&hsv);
+    storage_save_current(&rgb, &hsv);
+}
+
+static cli_status_t save_color(const char *name, const rgb16_t *p_rgb, const hsv_color_t *p_hsv,
+                               const char *ok_msg) {
+    save_current();
+    if (!storage_add_color(name, p_rgb, p_hsv)) {
+        reply("\r\nFailed (Full?)\r\n");
+        return CLI_ERR_FULL;
+    }
+    reply(ok_msg);
+    return CLI_OK;
+}
+
+/* The two views saved together are what the state would derive from either
+ * one, so applying the color later needs no conversion either way. */
+static cli_status_t cmd_add_rgb_color(const cli_arg_t *p_args) {
+    rgb16_t rgb;
+    hsv_color_t hsv;
+    args_to_rgb16(p_args, &rgb);
+    color_to_hsv(&rgb, &hsv);
+    return save_color(p_args[3].str, &rgb, &hsv, "\r\nSaved.\r\n");
+}
+
+static cli_status_t cmd_add_hsv_color(const cli_arg_t *p_args) {
+    hsv_color_t hsv = { (uint16_t)p_args[0].num, (uint8_t)p_args[1].num, (uint8_t)p_args[2].num };
+    rgb16_t rgb;
+    color_from_hsv(&hsv, &rgb);
+    return save_color(p_args[3].str, &rgb, &hsv, "\r\nSaved.\r\n");
+}
+
+static cli_status_t cmd_add_current_color(const cli_arg_t *p_args) {
+    rgb16_t rgb;
+    hsv_color_t hsv;
+    color_state_get_rgb16(&rgb);
+    color_state_get_hsv(&hsv);
+    return save_color(p_args[0].str, &rgb, &hsv, "\r\nSaved current.\r\n");
+}
+
+static cli_status_t cmd_del_color(const cli_arg_t *p_args) {
+    if (!storage_del_color(p_args[0].str)) {
+        reply("\r\nNot found.\r\n");
+        return CLI_ERR_NOT_FOUND;
+    }
+    reply("\r\nDeleted.\r\n");
+    return CLI_OK;
+}
+
+static cli_status_t cmd_apply_color(const cli_arg_t *p_args) {
+    rgb16_t rgb;
+    hsv_color_t hsv;
+    if (!storage_get_color(p_args[0].str, &rgb, &hsv)) {
+        reply("\r\nNot found.\r\n");
+        return CLI_ERR_NOT_FOUND;
+    }
+    color_state_restore(&rgb, &hsv, p_args[1].num);
+    storage_save_current(&rgb, &hsv);
+    reply("\r\nApplied.\r\n");
+    return CLI_OK;
+}
+
+static cli_status_t cmd_list_colors(const cli_arg_t *p_args) {
+    storage_list_colors(usb_printf);
+    return CLI_OK;
+}
+
+static cli_status_t cmd_isr_stats(const cli_arg_t *p_args) {
+    static const char * const names[ISR_STATS_SOURCE_COUNT] = { "GPIOTE", "RTC", "PWM", "USBD" };
+    usb_print("\r\n");
+    for (int i = 0; i < ISR_STATS_SOURCE_COUNT; i++) {
+        isr_stats_t stats;
+        isr_stats_get((isr_stats_source_t)i, &stats);
+        usb_printf("  %-8s count=%lu max=%lu us\r\n", names[i],
+                   (unsigned long)stats.count,
+                   (unsigned long)isr_stats_cycles_to_us(stats.max_cycles));
+    }
+    isr_stats_reset();
+    return CLI_OK;
+}
+
+/* RGB frames go straight to the PWM and bypass the color state; the last one
+ * is folded back in on exit so the button and storage carry on from what
+ * the LED shows. */
+static void stream_leave(void) {
+    if (m_stream_mode && playout_stop(m_stream_rgb)) {
+        m_stream_rgb_pending = true;
+    }
+    if (m_stream_mode && m_stream_rgb_pending) {
+        rgb16_t rgb = { color_from_counts(m_stream_rgb[0]), color_from_counts(m_stream_rgb[1]),
+                        color_from_counts(m_stream_rgb[2]) };
+        color_state_set_rgb16(&rgb, 0);
+    }
+    m_stream_mode = false;
+    m_stream_rgb_pending = false;
+}
+
+static void stream_apply(const stream_frame_t *p_frame) {
+    switch (p_frame->type) {
+        case STREAM_FRAME_RGB:
+            pwm_set_rgb_values(p_frame->rgb.r, p_frame->rgb.g, p_frame->rgb.b);
+            m_stream_rgb[0] = p_frame->rgb.r;
+            m_stream_rgb[1] = p_frame->rgb.g;
+            m_stream_rgb[2] = p_frame->rgb.b;
+            m_stream_rgb_pending = true;
+            break;
+
+        case STREAM_FRAME_RGB_AT: {
+            uint16_t rgb[3] = { p_frame->rgb.r, p_frame->rgb.g, p_frame->rgb.b };
+            playout_push(p_frame->pts, rgb, timebase_millis());
+            break;
+        }
+
+        case STREAM_FRAME_HSV:
+            color_state_set_hsv(&p_frame->hsv, 0);
+            m_stream_rgb_pending = false;
+            break;
+
+        case STREAM_FRAME_EXIT:
+            stream_leave();
+            if (!m_quiet) usb_print("\r\n");
+            prompt();
+            break;
+    }
+}
+
+static cli_status_t cmd_stream(const cli_arg_t *p_args) {
+    reply("\r\nStreaming, send an EXIT frame to return\r\n");
+    stream_reset();
+    playout_start();
+    m_stream_mode = true;
+    m_stream_skip_lf = true;
+    return CLI_OK;
+}
+
+static cli_status_t cmd_stream_stats(const cli_arg_t *p_args) {
+    stream_stats_t stats;
+    stream_stats_get(&stats);
+    usb_printf("\r\nframes=%lu lost=%lu out_of_order=%lu crc=%lu malformed=%lu\r\n",
+               (unsigned long)stats.frames, (unsigned long)stats.lost,
+               (unsigned long)stats.out_of_order, (unsigned long)stats.crc_errors,
+               (unsigned long)stats.malformed);
+    stream_stats_reset();
+
+    playout_stats_t playout;
+    playout_stats_get(&playout);
+    usb_printf("played=%lu late=%lu underruns=%lu overflows=%lu drift=%ld ms\r\n",
+               (unsigned long)playout.played, (unsigned long)playout.late,
+               (unsigned long)playout.underruns, (unsigned long)playout.overflows,
+               (long)playout.drift_ms);
+    playout_stats_reset();
+    return CLI_OK;
+}
+
+static cli_status_t cmd_usb_stats(const cli_arg_t *p_args) {
+    usb_printf("\r\nRX peak %lu/%lu dropped %lu\r\n",
+               (unsigned long)m_rx_fifo.high_water, (unsigned long)RX_BUF_SIZE,
+               (unsigned long)m_rx_fifo.dropped);
+    usb_printf("TX peak %lu/%lu dropped %lu truncated %lu\r\n",
+               (unsigned long)m_tx_ring.high_water, (unsigned long)TX_BUF_SIZE,
+               (unsigned long)(m_tx_ring.dropped + m_tx_discarded),
+               (unsigned long)m_tx_truncated);
+    /* This command is the TX producer; the RX one restarts its counters
+     * with the next packet. */
+    spsc_ring_stats_reset(&m_tx_ring);
+    m_tx_discarded = 0;
+    m_tx_truncated = 0;
+    m_rx_stats_reset = true;
+    return CLI_OK;
+}
+
+static cli_status_t cmd_curve(const cli_arg_t *p_args) {
+    static const char * const names[CURVE_COUNT] = { "linear", "gamma 2.2", "CIE L*" };
+    curve_select((curve_t)p_args[0].num);
+    color_state_refresh();
+    reply("\r\nCurve: %s\r\n", names[curve_selected()]);
+    return CLI_OK;
+}
+
+/* Calibration is entered in thousandths and kept in Q15. */
+static int16_t permille_to_q15(int32_t permille) {
+    int32_t q15 = (permille * 32768 + (permille < 0 ? -500 : 500)) / 1000;
+    return (int16_t)MIN(q15, COLOR_Q15_ONE);
+}
+
+static long q15_to_permille(int16_t q15) {
+    return ((long)q15 * 1000 + (q15 < 0 ? -16384 : 16384)) / 32768;
+}
+
+static void apply_calibration(const color_calib_t *p_calib) {
+    color_correct_set(p_calib);
+    storage_save_calibration(p_calib);
+    color_state_refresh();
+}
+
+static cli_status_t cmd_cal_gain(const cli_arg_t *p_args) {
+    color_calib_t calib;
+    color_correct_get(&calib);
+    for (uint8_t i = 0; i < 3; i++) {
+        calib.gain[i] = permille_to_q15(p_args[i].num);
+    }
+    apply_calibration(&calib);
+    reply("\r\nGains set\r\n");
+    return CLI_OK;
+}
+
+static cli_status_t cmd_cal_matrix(const cli_arg_t *p_args) {
+    color_calib_t calib;
+    color_correct_get(&calib);
+    for (uint8_t i = 0; i < 3; i++) {
+        calib.matrix[p_args[0].num][i] = permille_to_q15(p_args[1 + i].num);
+    }
+    apply_calibration(&calib);
+    reply("\r\nMatrix row %ld set\r\n", (long)p_args[0].num);
+    return CLI_OK;
+}
+
+static cli_status_t cmd_cal_show(const cli_arg_t *p_args) {
+    static const char channels[3] = { 'R', 'G', 'B' };
+    color_calib_t calib;
+    color_correct_get(&calib);
+    usb_printf("\r\nCalibration (1/1000):\r\n");
+    for (uint8_t i = 0; i < 3; i++) {
+        if (!usb_printf("  %c: gain %ld, matrix %ld %ld %ld\r\n", channels[i],
+                        q15_to_permille(calib.gain[i]), q15_to_permille(calib.matrix[i][0]),
+                        q15_to_permille(calib.matrix[i][1]), q15_to_permille(calib.matrix[i][2]))) break;
+    }
+    return CLI_OK;
+}
+
+static cli_status_t cmd_cal_reset(const cli_arg_t *p_args) {
+    color_calib_t calib;
+    color_correct_default(&calib);
+    apply_calibration(&calib);
+    reply("\r\nCalibration cleared\r\n");
+    return CLI_OK;
+}
+
+static cli_status_t cmd_dither(const cli_arg_t *p_args) {
+    pwm_set_dither(p_args[0].num != 0);
+    reply("\r\nDither %s\r\n", pwm_dither_enabled() ? "on" : "off");
+    return CLI_OK;
+}
+
+static cli_status_t cmd_quiet(const cli_arg_t *p_args) {
+    if (!m_quiet && p_args[0].num != 0) {
+        usb_print("\r\n");
+    }
+    m_quiet = (p_args[0].num != 0);
+    reply("\r\nVerbose\r\n");
+    return CLI_OK;
 }
 
 static void cdc_acm_user_ev_handler(app_usbd_class_inst_t const * p_inst,
                                     app_usbd_cdc_acm_user_event_t event)
 {
+    uint32_t start = isr_stats_begin();
+
     switch (event) {
         case APP_USBD_CDC_ACM_USER_EVT_PORT_OPEN:
-            app_usbd_cdc_acm_read(&m_app_cdc_acm, &m_usb_rx_char, 1);
+            m_port_open = true;
+            rx_start();
             pwm_set_rgb_values(0, 0, 1000);
             break;
             
         case APP_USBD_CDC_ACM_USER_EVT_PORT_CLOSE:
+            m_port_open = false;
+            stream_leave();
+            m_rx_armed = false;
+            tx_reset();
             pwm_set_rgb_values(0, 0, 0);
             break;
             
         case APP_USBD_CDC_ACM_USER_EVT_RX_DONE:
-        {
-            fifo_put(m_usb_rx_char);
-            app_usbd_cdc_acm_read(&m_app_cdc_acm, &m_usb_rx_char, 1);
+            rx_store(app_usbd_cdc_acm_rx_size(&m_app_cdc_acm));
+            rx_start();
             break;
-        }
+
+        case APP_USBD_CDC_ACM_USER_EVT_TX_DONE:
+            m_tx_busy = false;
+            m_tx_stalled = false;
+            m_tx_progress_ms = timebase_millis();
+            tx_kick();
+            break;
+
         default:
             break;
     }
+    isr_stats_end(ISR_STATS_USBD, start);
 }
 
 static void usbd_user_ev_handler(app_usbd_event_type_t event)
 {
+    uint32_t start = isr_stats_begin();
+
     switch (event) {
         case APP_USBD_EVT_STOPPED:
             app_usbd_disable();
@@ -258,14 +797,26 @@ static void usbd_user_ev_handler(app_usbd_event_type_t event)
             }
             break;
         case APP_USBD_EVT_POWER_REMOVED:
+            m_port_open = false;
+            stream_leave();
+            m_rx_armed = false;
+            tx_reset();
             app_usbd_stop();
             break;
+        case APP_USBD_EVT_DRV_SUSPEND:
+            m_usb_suspended = true;
+            break;
+        case APP_USBD_EVT_DRV_RESUME:
+            m_usb_suspended = false;
+            m_tx_progress_ms = timebase_millis();
+            break;
         case APP_USBD_EVT_POWER_READY:
             app_usbd_start();
             break;
         default:
             break;
     }
+    isr_stats_end(ISR_STATS_USBD, start);
 }
 
 void cli_init(void)
@@ -274,6 +825,8 @@ void cli_init(void)
         .ev_state_proc = usbd_user_ev_handler
     };
 
+    command_order_init();
+
     app_usbd_serial_num_generate();
     app_usbd_init(&usbd_config);
     app_usbd_class_append(app_usbd_cdc_acm_class_inst_get(&m_app_cdc_acm));
@@ -286,32 +839,61 @@ void cli_process(void)
     while (app_usbd_event_queue_process()) {
     }
 
+    tx_watchdog(timebase_millis());
+
+    if (m_line_rest != NULL) {
+        process_line(m_line_rest);
+    }
+
     char c;
-    while (fifo_get(&c)) {
+    while (m_line_rest == NULL && tx_has_room() && spsc_ring_get(&m_rx_fifo, &c, 1)) {
+
+        if (m_stream_mode) {
+            stream_frame_t frame;
+            bool skip = m_stream_skip_lf && c == '\n';
+            m_stream_skip_lf = false;
+            if (!skip && stream_rx_byte((uint8_t)c, &frame)) {
+                stream_apply(&frame);
+            }
+            continue;
+        }
         
-        if (c != '\r' && c != '\n') {
-             usb_send_blocking(&c, 1);
+        if (c != '\r' && c != '\n' && !m_quiet) {
+            tx_begin();
+            usb_write(&c, 1);
         }
 
         if (c == '\r' || c == '\n') {
             m_line_buffer[m_line_idx] = 0; 
-            if (m_line_idx > 0) {
-                process_command(m_line_buffer);
-            } else {
+            if (m_line_overflow) {
+                reply("\r\nLine too long\r\n");
+                report(CLI_ERR_TOO_LONG);
+                prompt();
+            } else if (m_line_idx > 0) {
+                process_line(m_line_buffer);
+            } else if (!m_quiet) {
                 usb_print("\r\n> ");
             }
             m_line_idx = 0;
+            m_line_overflow = false;
         } 
         else if (c == 127 || c == 8) {
             if (m_line_idx > 0) {
                 m_line_idx--;
-                usb_print("\b \b");
+                if (!m_quiet) usb_print("\b \b");
             }
         }
         else if (c >= ' ' && c <= '~') {
             if (m_line_idx < sizeof(m_line_buffer) - 1) {
                 m_line_buffer[m_line_idx++] = c;
+            } else {
+                m_line_overflow = true;
             }
         }
     }
+
+    if (!m_rx_armed) {
+        rx_start();
+    }
+    tx_kick();
 }
\ No newline at end of file